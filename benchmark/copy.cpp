@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+#include <memory_resource>
+#include "../src/components/document/document.hpp"
+#include "../components/generaty/generaty.hpp"
+
+using components::document::document_t;
+
+void clone_into(benchmark::State &state) {
+  auto allocator = std::pmr::unsynchronized_pool_resource();
+  auto doc = gen_doc(1000, &allocator);
+
+  for (auto _: state) {
+    for (int i = 0; i < state.range(0); ++i) {
+      auto target = std::pmr::unsynchronized_pool_resource();
+      benchmark::DoNotOptimize(doc->clone_into(&target));
+    }
+  }
+}
+BENCHMARK(clone_into)->Arg(1000);
+
+void json_round_trip(benchmark::State &state) {
+  auto allocator = std::pmr::unsynchronized_pool_resource();
+  auto doc = gen_doc(1000, &allocator);
+
+  for (auto _: state) {
+    for (int i = 0; i < state.range(0); ++i) {
+      auto target = std::pmr::unsynchronized_pool_resource();
+      auto json = doc->to_json();
+      benchmark::DoNotOptimize(document_t::document_from_json(std::string(json), &target));
+    }
+  }
+}
+BENCHMARK(json_round_trip)->Arg(1000);
+
+void project_set(benchmark::State &state) {
+  auto allocator = std::pmr::unsynchronized_pool_resource();
+  auto doc = gen_doc(1000, &allocator);
+
+  for (auto _: state) {
+    for (int i = 0; i < state.range(0); ++i) {
+      auto res = components::document::make_document(&allocator);
+      res->set("/_id", std::string_view(doc->get_string("/_id")));
+      res->set("/count", doc->get_int("/count"));
+      res->set("/countStr", std::string_view(doc->get_string("/countStr")));
+      res->set_dict("/countDict");
+      res->set("/countDict/odd", doc->get_bool("/countDict/odd"));
+      benchmark::DoNotOptimize(res);
+    }
+  }
+}
+BENCHMARK(project_set)->Arg(1000);
+
+void project(benchmark::State &state) {
+  auto allocator = std::pmr::unsynchronized_pool_resource();
+  auto doc = gen_doc(1000, &allocator);
+  std::pmr::vector<std::string_view> json_pointers({"/_id", "/count", "/countStr", "/countDict/odd"}, &allocator);
+
+  for (auto _: state) {
+    for (int i = 0; i < state.range(0); ++i) {
+      benchmark::DoNotOptimize(document_t::project(doc, json_pointers, &allocator));
+    }
+  }
+}
+BENCHMARK(project)->Arg(1000);
@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+#include <memory_resource>
+#include "../src/components/document/document_predicate.hpp"
+#include "../components/generaty/generaty.hpp"
+
+using components::document::compare_op_t;
+using components::document::document_ptr;
+using components::document::predicate_t;
+using components::document::selection_t;
+using components::document::value_type_t;
+
+// (count > 500 && countBool) || (countStr in ["1", "10", "100"] && countDouble is a number)
+void filter_get(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+  selection_t selection(&allocator);
+
+  for (auto _: state) {
+    selection.reset(docs.size());
+    for (std::size_t i = 0; i < docs.size(); ++i) {
+      const auto &doc = docs[i];
+      auto is_selected = doc->is_exists("/count") && doc->get_long("/count") > 500 && doc->get_bool("/countBool");
+      if (!is_selected && doc->is_string("/countStr")) {
+        auto str = doc->get_string("/countStr");
+        is_selected = (str == "1" || str == "10" || str == "100") &&
+                      (doc->is_float("/countDouble") || doc->is_double("/countDouble"));
+      }
+      if (is_selected) {
+        selection.set(i);
+      }
+    }
+    benchmark::DoNotOptimize(selection.count());
+  }
+}
+BENCHMARK(filter_get)->Arg(10000)->Arg(100000);
+
+void filter_predicate(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+  selection_t selection(&allocator);
+  predicate_t predicate(&allocator);
+  predicate.compile(predicate.logical_or({
+          predicate.logical_and({
+                  predicate.compare("/count", compare_op_t::MORE, 500),
+                  predicate.compare("/countBool", compare_op_t::EQUALS, true)
+          }),
+          predicate.logical_and({
+                  predicate.in("/countStr", boost::json::array{"1", "10", "100"}),
+                  predicate.is_type("/countDouble", value_type_t::NUMBER)
+          })
+  }));
+
+  for (auto _: state) {
+    predicate.filter(docs, selection);
+    benchmark::DoNotOptimize(selection.count());
+  }
+}
+BENCHMARK(filter_predicate)->Arg(10000)->Arg(100000);
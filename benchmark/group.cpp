@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+#include <absl/container/flat_hash_map.h>
+#include <limits>
+#include <memory_resource>
+#include "../src/components/document/document_group.hpp"
+#include "../components/generaty/generaty.hpp"
+
+using components::document::document_ptr;
+
+void group_map(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+  struct group_t {
+    std::size_t size = 0;
+    int64_t sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+  };
+
+  for (auto _: state) {
+    absl::flat_hash_map<std::string, group_t> groups;
+    for (const auto &doc : docs) {
+      std::string key(doc->get_string("/countStr"));
+      key.push_back(doc->get_bool("/countBool") ? '1' : '0');
+      auto &group = groups[key];
+      ++group.size;
+      group.sum += doc->get_long("/count");
+      group.min = std::min(group.min, doc->get_double("/countDouble"));
+      group.max = std::max(group.max, doc->get_double("/countDouble"));
+    }
+    benchmark::DoNotOptimize(groups.size());
+  }
+}
+BENCHMARK(group_map)->Arg(10000)->Arg(100000);
+
+void group_documents(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+  std::pmr::vector<std::string_view> group_by({"/countStr", "/countBool"}, &allocator);
+  std::pmr::vector<std::string_view> aggregated({"/count", "/countDouble"}, &allocator);
+
+  for (auto _: state) {
+    benchmark::DoNotOptimize(components::document::group_documents(docs, group_by, aggregated).size());
+  }
+}
+BENCHMARK(group_documents)->Arg(10000)->Arg(100000);
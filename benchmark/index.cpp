@@ -0,0 +1,94 @@
+#include <benchmark/benchmark.h>
+#include <memory_resource>
+#include <random>
+#include "../src/components/document/document_index.hpp"
+#include "../components/generaty/generaty.hpp"
+
+using components::document::document_index_t;
+using components::document::document_ptr;
+
+static std::pmr::vector<document_ptr> gen_ordered_docs(int count, std::pmr::memory_resource *allocator) {
+  std::pmr::vector<document_ptr> docs(allocator);
+  for (int i = 0; i < count; ++i) {
+    docs.push_back(gen_doc(i, allocator));
+  }
+  return docs;
+}
+
+void index_scan(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_ordered_docs(int(state.range(0)), &allocator);
+  std::mt19937 random(42);
+
+  for (auto _: state) {
+    auto id = gen_id(int(random() % docs.size()));
+    std::size_t count = 0;
+    for (const auto &doc : docs) {
+      count += doc->get_string("/_id") == std::string_view(id);
+    }
+    benchmark::DoNotOptimize(count);
+  }
+}
+BENCHMARK(index_scan)->Arg(10000)->Arg(100000);
+
+void index_find(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_ordered_docs(int(state.range(0)), &allocator);
+  document_index_t index(&allocator, "/_id");
+  index.build(docs);
+  std::mt19937 random(42);
+  std::pmr::vector<document_index_t::id_t> ids(&allocator);
+
+  for (auto _: state) {
+    auto id = gen_id(int(random() % docs.size()));
+    ids.clear();
+    index.find(boost::json::value(std::string_view(id)), ids);
+    benchmark::DoNotOptimize(ids.size());
+  }
+}
+BENCHMARK(index_find)->Arg(10000)->Arg(100000);
+
+void index_find_range(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_ordered_docs(int(state.range(0)), &allocator);
+  document_index_t index(&allocator, "/count");
+  index.build(docs);
+  std::mt19937 random(42);
+  std::pmr::vector<document_index_t::id_t> ids(&allocator);
+
+  for (auto _: state) {
+    boost::json::value lower = int64_t(random() % docs.size());
+    boost::json::value upper = lower.get_int64() + 100;
+    ids.clear();
+    index.find_range(&lower, true, &upper, false, ids);
+    benchmark::DoNotOptimize(ids.size());
+  }
+}
+BENCHMARK(index_find_range)->Arg(100000);
+
+void index_insert(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_ordered_docs(int(state.range(0)), &allocator);
+  std::mt19937 random(42);
+
+  for (auto _: state) {
+    document_index_t index(&allocator, "/count");
+    for (std::size_t i = 0; i < docs.size(); ++i) {
+      index.insert(i, *docs[random() % docs.size()]);
+    }
+    benchmark::DoNotOptimize(index.size());
+  }
+}
+BENCHMARK(index_insert)->Arg(100000);
+
+void index_build(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_ordered_docs(int(state.range(0)), &allocator);
+
+  for (auto _: state) {
+    document_index_t index(&allocator, "/_id");
+    index.build(docs);
+    benchmark::DoNotOptimize(index.size());
+  }
+}
+BENCHMARK(index_build)->Arg(100000);
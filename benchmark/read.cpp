@@ -31,6 +31,36 @@ void read_wrong(benchmark::State &state) {
 }
 BENCHMARK(read_wrong)->Arg(100000);
 
+// The second argument builds a path filter.
+void read_missing(benchmark::State &state) {
+  auto allocator = std::pmr::unsynchronized_pool_resource();
+  auto doc = gen_doc(1000, &allocator);
+  if (state.range(1) != 0) {
+    doc->build_path_filter();
+  }
+  std::string_view key_missing{"/countMissing"};
+  std::string_view key_dict_missing{"/countDict/missing"};
+
+  auto f = [&doc, key_missing, key_dict_missing]() {
+    doc->is_exists(key_missing);
+    doc->is_long(key_missing);
+    doc->get_long(key_missing);
+    doc->get_string(key_missing);
+    doc->get_dict(key_missing);
+
+    doc->is_exists(key_dict_missing);
+    doc->get_bool(key_dict_missing);
+  };
+
+  for (auto _: state) {
+    for (int i = 0; i < state.range(0); ++i) {
+      f();
+    }
+  }
+  state.counters["filter_bytes"] = double(doc->path_filter_bytes());
+}
+BENCHMARK(read_missing)->Args({100000, 0})->Args({100000, 1});
+
 void read(benchmark::State &state) {
   auto allocator = std::pmr::unsynchronized_pool_resource();
   auto doc = gen_doc(1000, &allocator);
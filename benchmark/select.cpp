@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include <limits>
+#include <memory_resource>
+#include "../src/components/document/document_column.hpp"
+#include "../components/generaty/generaty.hpp"
+
+using components::document::compare_op_t;
+using components::document::compare_t;
+using components::document::document_ptr;
+using components::document::selection_t;
+
+void select_compare_loop(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+  auto other = gen_doc(500, &allocator);
+
+  for (auto _: state) {
+    std::size_t count = 0;
+    for (const auto &doc : docs) {
+      count += doc->compare(*other, "/count") == compare_t::more;
+    }
+    benchmark::DoNotOptimize(count);
+  }
+}
+BENCHMARK(select_compare_loop)->Arg(10000)->Arg(100000);
+
+void select_compare(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+  auto other = gen_doc(500, &allocator);
+  selection_t selection(&allocator);
+
+  for (auto _: state) {
+    components::document::select_compare(docs, *other, "/count", compare_op_t::MORE, selection);
+    benchmark::DoNotOptimize(selection.count());
+  }
+}
+BENCHMARK(select_compare)->Arg(10000)->Arg(100000);
+
+void select_column(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+  components::document::document_column_t<int64_t> column(&allocator);
+  components::document::gather_column(docs, "/count", column);
+  selection_t selection(&allocator);
+
+  for (auto _: state) {
+    components::document::select(column, compare_op_t::MORE, int64_t(500), selection);
+    benchmark::DoNotOptimize(selection.count());
+  }
+}
+BENCHMARK(select_column)->Arg(10000)->Arg(100000);
+
+void aggregate_loop(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+
+  for (auto _: state) {
+    __int128_t sum = 0;
+    auto min = std::numeric_limits<int64_t>::max();
+    auto max = std::numeric_limits<int64_t>::min();
+    for (const auto &doc : docs) {
+      auto value = doc->get_long("/count");
+      sum += value;
+      min = std::min(min, value);
+      max = std::max(max, value);
+    }
+    benchmark::DoNotOptimize(sum);
+    benchmark::DoNotOptimize(min);
+    benchmark::DoNotOptimize(max);
+  }
+}
+BENCHMARK(aggregate_loop)->Arg(10000)->Arg(100000);
+
+void aggregate(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+
+  for (auto _: state) {
+    benchmark::DoNotOptimize(components::document::aggregate(docs, "/count"));
+  }
+}
+BENCHMARK(aggregate)->Arg(10000)->Arg(100000);
@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+#include <memory_resource>
+#include "../src/components/document/document_shredder.hpp"
+#include "../components/generaty/generaty.hpp"
+
+using components::document::document_ptr;
+using components::document::shredded_batch_t;
+using components::document::shredded_column_t;
+
+static const shredded_column_t &count_column(const shredded_batch_t &batch) {
+  for (const auto &column : batch.columns) {
+    if (column.path.size() == 1 && column.path.front().key == "count") {
+      return column;
+    }
+  }
+  return batch.columns.front();
+}
+
+void scan_documents(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+
+  for (auto _: state) {
+    int64_t sum = 0;
+    for (const auto &doc : docs) {
+      sum += doc->get_long("/count");
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+BENCHMARK(scan_documents)->Arg(1000)->Arg(10000);
+
+void scan_column(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+  shredded_batch_t batch(&allocator);
+  components::document::shred_documents(docs, batch);
+  const auto &column = count_column(batch);
+
+  for (auto _: state) {
+    int64_t sum = 0;
+    for (auto value : column.values) {
+      sum += static_cast<int64_t>(value);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+BENCHMARK(scan_column)->Arg(1000)->Arg(10000);
+
+void shred(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+
+  for (auto _: state) {
+    shredded_batch_t batch(&allocator);
+    components::document::shred_documents(docs, batch);
+    benchmark::DoNotOptimize(batch.columns.size());
+  }
+}
+BENCHMARK(shred)->Arg(1000);
+
+void assemble(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+  shredded_batch_t batch(&allocator);
+  components::document::shred_documents(docs, batch);
+
+  for (auto _: state) {
+    benchmark::DoNotOptimize(components::document::assemble_documents(batch, &allocator).size());
+  }
+}
+BENCHMARK(assemble)->Arg(1000);
@@ -0,0 +1,37 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <memory_resource>
+#include "../src/components/document/document_sorter.hpp"
+#include "../components/generaty/generaty.hpp"
+
+using components::document::compare_t;
+using components::document::document_ptr;
+using components::document::sort_column_t;
+
+void sort_compare(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+
+  for (auto _: state) {
+    auto copy = docs;
+    std::sort(copy.begin(), copy.end(), [](const document_ptr &doc1, const document_ptr &doc2) {
+      auto res = doc1->compare(*doc2, "/countBool");
+      return res == compare_t::less || (res == compare_t::equals && doc1->compare(*doc2, "/count") == compare_t::less);
+    });
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(sort_compare)->Arg(10000)->Arg(100000);
+
+void sort_documents(benchmark::State &state) {
+  auto allocator = std::pmr::synchronized_pool_resource();
+  auto docs = gen_docs(int(state.range(0)), &allocator);
+  std::pmr::vector<sort_column_t> columns({{"/countBool"}, {"/count"}}, &allocator);
+
+  for (auto _: state) {
+    auto copy = docs;
+    components::document::sort_documents(copy, columns, std::size_t(state.range(1)));
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(sort_documents)->Args({10000, 1})->Args({100000, 1})->Args({100000, 0});
@@ -1,4 +1,5 @@
 #include "generaty.hpp"
+#include <random>
 
 void gen_array(int num, const document_ptr& array) {
   for (int i = 0; i < 5; ++i) {
@@ -57,3 +58,12 @@ document_ptr gen_doc(int num, document_t::allocator_type *allocator) {
   doc->set_null("/null");
   return doc;
 }
+
+std::pmr::vector<document_ptr> gen_docs(int count, document_t::allocator_type *allocator) {
+  std::pmr::vector<document_ptr> docs(allocator);
+  std::mt19937 random(42);
+  for (int i = 0; i < count; ++i) {
+    docs.push_back(gen_doc(int(random() % 1000), allocator));
+  }
+  return docs;
+}
@@ -8,3 +8,5 @@ void gen_array(int num, const document_ptr& array);
 void gen_dict(int num, const document_ptr& dict);
 std::string gen_id(int num);
 document_ptr gen_doc(int num, document_t::allocator_type *allocator);
+// count documents of gen_doc with numbers below 1000 from a fixed seed
+std::pmr::vector<document_ptr> gen_docs(int count, document_t::allocator_type *allocator);
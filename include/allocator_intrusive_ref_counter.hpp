@@ -19,6 +19,10 @@ public:
 
   allocator_intrusive_ref_counter& operator=(allocator_intrusive_ref_counter &&) noexcept = delete;
 
+  std::size_t use_count() const noexcept {
+    return ref_count_.load(std::memory_order_relaxed);
+  }
+
   friend void intrusive_ptr_add_ref(allocator_intrusive_ref_counter<T> *p) {
     p->ref_count_.fetch_add(1, std::memory_order_relaxed);
   }
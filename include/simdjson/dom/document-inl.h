@@ -74,6 +74,11 @@ element<T> document<T>::next_element() const noexcept {
   return {internal::tape_ref(this, size())};
 }
 
+template<typename T>
+element<T> document<T>::get_element(size_t json_index) const noexcept {
+  return {internal::tape_ref(this, json_index)};
+}
+
 template<typename T>
 inline bool document<T>::dump_raw_tape(std::ostream &os) const noexcept {
   uint32_t string_length;
@@ -281,6 +286,15 @@ inline size_t mutable_document::size_impl() const noexcept {
   return tape.size();
 }
 
+inline size_t mutable_document::string_buf_size() const noexcept {
+  return string_buf.size();
+}
+
+inline void mutable_document::reserve(size_t tape_capacity, size_t string_buf_capacity) {
+  tape.reserve(tape_capacity);
+  string_buf.reserve(string_buf_capacity);
+}
+
 template<typename T>
 std::unique_ptr<T[], array_deleter<T>> allocator_make_unique_ptr(std::pmr::memory_resource *allocator, size_t n) {
   T* array = new(allocator->allocate(n * sizeof(T))) T[n];
@@ -48,6 +48,9 @@ public:
   size_t size() const noexcept;
 
   element<T> next_element() const noexcept;
+
+  /** The element starting at json_index on the tape. */
+  element<T> get_element(size_t json_index) const noexcept;
   /**
  * @private Dump the raw tape for debugging.
  *
@@ -154,6 +157,10 @@ public:
 
   size_t size_impl() const noexcept;
 
+  size_t string_buf_size() const noexcept;
+
+  void reserve(size_t tape_capacity, size_t string_buf_capacity);
+
 private:
   std::pmr::vector<uint64_t> tape{};
   std::pmr::vector<uint8_t> string_buf{};
@@ -534,6 +534,11 @@ inline bool element<K>::dump_raw_tape(std::ostream &out) const noexcept {
   return tape.doc->dump_raw_tape(out);
 }
 
+template<typename K>
+simdjson_inline const internal::tape_ref<K> &element<K>::get_tape_ref() const noexcept {
+  return tape;
+}
+
 
 inline std::ostream& operator<<(std::ostream& out, element_type type) {
   switch (type) {
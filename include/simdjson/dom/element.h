@@ -362,6 +362,9 @@ public:
   /** @private for debugging. Prints out the root element. */
   inline bool dump_raw_tape(std::ostream &out) const noexcept;
 
+  /** @private The document and the tape index this element points to. */
+  simdjson_inline const internal::tape_ref<K> &get_tape_ref() const noexcept;
+
 private:
   simdjson_inline element(const internal::tape_ref<K> &tape) noexcept;
   internal::tape_ref<K> tape;
@@ -0,0 +1,455 @@
+#pragma once
+
+#include <components/document/base.hpp>
+#include <allocator_intrusive_ref_counter.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Persistent hash array mapped trie with string keys.
+//
+// Copying a map shares the whole trie. A write copies only the trie nodes on
+// the path to the changed entry that are still shared with another map (one
+// node per hash_bits_ / bits_ levels at most), unshared nodes are updated in place.
+// Leaves and sub-tries are kept in separate arrays of every node (CHAMP layout),
+// iteration visits the leaves of a node before its sub-tries.
+template<typename T>
+class hamt_map {
+  struct node;
+
+public:
+  using allocator_type = std::pmr::memory_resource;
+  using key_type = std::pmr::string;
+  using mapped_type = T;
+  using value_type = std::pair<std::pmr::string, T>;
+  using size_type = std::size_t;
+
+  class iterator;
+  class const_iterator;
+
+  explicit hamt_map(allocator_type *allocator) noexcept;
+
+  ~hamt_map() = default;
+
+  hamt_map(hamt_map &&) noexcept;
+
+  hamt_map(const hamt_map &) noexcept = default;
+
+  hamt_map &operator=(hamt_map &&) noexcept;
+
+  hamt_map &operator=(const hamt_map &) noexcept = default;
+
+  const_iterator find(std::string_view key) const;
+
+  iterator find(std::string_view key);
+
+  T &operator[](std::string_view key);
+
+  bool emplace(std::string_view key, T value);
+
+  bool emplace(const value_type &value);
+
+  size_type erase(std::string_view key);
+
+  size_type size() const noexcept;
+
+  bool empty() const noexcept;
+
+  void reserve(size_type) noexcept {}
+
+  const_iterator begin() const;
+
+  const_iterator end() const noexcept;
+
+  std::pmr::polymorphic_allocator<value_type> get_allocator() const noexcept;
+
+private:
+  static constexpr unsigned bits_ = 5;
+  static constexpr unsigned hash_bits_ = sizeof(std::size_t) * 8;
+  static constexpr unsigned max_depth_ = hash_bits_ / bits_ + 2;
+
+  struct node : public allocator_intrusive_ref_counter<node> {
+    explicit node(allocator_type *allocator, bool collision) noexcept
+            : allocator_(allocator),
+              leaves(allocator),
+              children(allocator),
+              collision(collision) {}
+
+    allocator_type *allocator_;
+    std::pmr::vector<value_type> leaves;
+    std::pmr::vector<boost::intrusive_ptr<node>> children;
+    uint32_t leaf_map = 0;
+    uint32_t child_map = 0;
+    bool collision;
+
+  protected:
+    allocator_type *get_allocator() override { return allocator_; }
+  };
+
+  class iterator_base {
+  public:
+    friend bool operator==(const iterator_base &a, const iterator_base &b) noexcept {
+      return a.leaf_() == b.leaf_();
+    }
+
+    friend bool operator!=(const iterator_base &a, const iterator_base &b) noexcept {
+      return !(a == b);
+    }
+
+  protected:
+    struct frame {
+      node *n;
+      uint32_t leaf;
+      uint32_t child;
+    };
+
+    frame stack_[max_depth_];
+    uint32_t depth_ = 0;
+
+    value_type *leaf_() const noexcept {
+      return depth_ == 0 ? nullptr : &stack_[depth_ - 1].n->leaves[stack_[depth_ - 1].leaf];
+    }
+
+    void push_(node *n, uint32_t leaf, uint32_t child) noexcept {
+      stack_[depth_++] = {n, leaf, child};
+    }
+
+    void settle_() noexcept {
+      while (depth_ > 0) {
+        auto &top = stack_[depth_ - 1];
+        if (top.leaf < top.n->leaves.size()) {
+          return;
+        }
+        if (top.child < top.n->children.size()) {
+          auto *next = top.n->children[top.child++].get();
+          push_(next, 0, 0);
+        } else {
+          --depth_;
+        }
+      }
+    }
+
+    void next_() noexcept {
+      ++stack_[depth_ - 1].leaf;
+      settle_();
+    }
+
+    friend class hamt_map;
+  };
+
+public:
+  class iterator : public iterator_base {
+  public:
+    value_type &operator*() const noexcept { return *this->leaf_(); }
+
+    value_type *operator->() const noexcept { return this->leaf_(); }
+
+    iterator &operator++() noexcept {
+      this->next_();
+      return *this;
+    }
+  };
+
+  class const_iterator : public iterator_base {
+  public:
+    const_iterator() noexcept = default;
+
+    const_iterator(const iterator &other) noexcept : iterator_base(other) {}
+
+    const value_type &operator*() const noexcept { return *this->leaf_(); }
+
+    const value_type *operator->() const noexcept { return this->leaf_(); }
+
+    const_iterator &operator++() noexcept {
+      this->next_();
+      return *this;
+    }
+  };
+
+private:
+  allocator_type *allocator_;
+  boost::intrusive_ptr<node> root_;
+  size_type size_;
+
+  static std::size_t hash_(std::string_view key) noexcept;
+
+  static uint32_t index_(uint32_t map, uint32_t bit) noexcept;
+
+  node *make_node_(bool collision) const;
+
+  void make_unique_(boost::intrusive_ptr<node> &slot) const;
+
+  template<typename Iterator>
+  bool find_(std::string_view key, Iterator &it, bool for_write);
+
+  T *assign_(boost::intrusive_ptr<node> &slot, std::size_t hash, std::string_view key, unsigned shift, bool &inserted);
+
+  bool erase_(boost::intrusive_ptr<node> &slot, std::size_t hash, std::string_view key, unsigned shift);
+};
+
+template<typename T>
+hamt_map<T>::hamt_map(allocator_type *allocator) noexcept
+        : allocator_(allocator),
+          root_(nullptr),
+          size_(0) {}
+
+template<typename T>
+hamt_map<T>::hamt_map(hamt_map &&other) noexcept
+        : allocator_(other.allocator_),
+          root_(std::move(other.root_)),
+          size_(other.size_) {
+  other.size_ = 0;
+}
+
+template<typename T>
+hamt_map<T> &hamt_map<T>::operator=(hamt_map &&other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  allocator_ = other.allocator_;
+  root_ = std::move(other.root_);
+  size_ = other.size_;
+  other.size_ = 0;
+  return *this;
+}
+
+template<typename T>
+std::size_t hamt_map<T>::hash_(std::string_view key) noexcept {
+  return std::hash<std::string_view>{}(key);
+}
+
+template<typename T>
+uint32_t hamt_map<T>::index_(uint32_t map, uint32_t bit) noexcept {
+  return static_cast<uint32_t>(__builtin_popcount(map & (bit - 1)));
+}
+
+template<typename T>
+typename hamt_map<T>::node *hamt_map<T>::make_node_(bool collision) const {
+  return new(allocator_->allocate(sizeof(node))) node(allocator_, collision);
+}
+
+template<typename T>
+void hamt_map<T>::make_unique_(boost::intrusive_ptr<node> &slot) const {
+  if (slot->use_count() == 1) {
+    return;
+  }
+  auto copy = make_node_(slot->collision);
+  copy->leaves = slot->leaves;
+  copy->children = slot->children;
+  copy->leaf_map = slot->leaf_map;
+  copy->child_map = slot->child_map;
+  slot = copy;
+}
+
+template<typename T>
+template<typename Iterator>
+bool hamt_map<T>::find_(std::string_view key, Iterator &it, bool for_write) {
+  if (root_ == nullptr) {
+    return false;
+  }
+  auto hash = hash_(key);
+  auto *slot = &root_;
+  for (unsigned shift = 0;; shift += bits_) {
+    if (for_write) {
+      make_unique_(*slot);
+    }
+    auto *n = slot->get();
+    if (n->collision) {
+      for (uint32_t i = 0; i < n->leaves.size(); ++i) {
+        if (n->leaves[i].first == key) {
+          it.push_(n, i, 0);
+          return true;
+        }
+      }
+      return false;
+    }
+    auto bit = uint32_t(1) << ((hash >> shift) & 31);
+    if (n->leaf_map & bit) {
+      auto pos = index_(n->leaf_map, bit);
+      if (n->leaves[pos].first != key) {
+        return false;
+      }
+      it.push_(n, pos, 0);
+      return true;
+    }
+    if (!(n->child_map & bit)) {
+      return false;
+    }
+    auto pos = index_(n->child_map, bit);
+    it.push_(n, static_cast<uint32_t>(n->leaves.size()), pos + 1);
+    slot = &n->children[pos];
+  }
+}
+
+template<typename T>
+typename hamt_map<T>::const_iterator hamt_map<T>::find(std::string_view key) const {
+  const_iterator it;
+  if (!const_cast<hamt_map *>(this)->find_(key, it, false)) {
+    return end();
+  }
+  return it;
+}
+
+template<typename T>
+typename hamt_map<T>::iterator hamt_map<T>::find(std::string_view key) {
+  iterator it;
+  if (!find_(key, it, false)) {
+    return {};
+  }
+  // the entry exists, take the path to it out of the structure shared with other maps
+  it = iterator();
+  find_(key, it, true);
+  return it;
+}
+
+template<typename T>
+T &hamt_map<T>::operator[](std::string_view key) {
+  if (root_ == nullptr) {
+    root_ = make_node_(false);
+  }
+  bool inserted = false;
+  auto res = assign_(root_, hash_(key), key, 0, inserted);
+  if (inserted) {
+    ++size_;
+  }
+  return *res;
+}
+
+template<typename T>
+bool hamt_map<T>::emplace(std::string_view key, T value) {
+  if (std::as_const(*this).find(key) != end()) {
+    return false;
+  }
+  (*this)[key] = std::move(value);
+  return true;
+}
+
+template<typename T>
+bool hamt_map<T>::emplace(const value_type &value) {
+  return emplace(value.first, value.second);
+}
+
+template<typename T>
+T *hamt_map<T>::assign_(
+        boost::intrusive_ptr<node> &slot,
+        std::size_t hash,
+        std::string_view key,
+        unsigned shift,
+        bool &inserted
+) {
+  make_unique_(slot);
+  auto *n = slot.get();
+  if (n->collision) {
+    for (auto &leaf : n->leaves) {
+      if (leaf.first == key) {
+        return &leaf.second;
+      }
+    }
+    inserted = true;
+    n->leaves.emplace_back(key_type(key, allocator_), T());
+    return &n->leaves.back().second;
+  }
+  auto bit = uint32_t(1) << ((hash >> shift) & 31);
+  if (n->child_map & bit) {
+    return assign_(n->children[index_(n->child_map, bit)], hash, key, shift + bits_, inserted);
+  }
+  auto pos = index_(n->leaf_map, bit);
+  if (!(n->leaf_map & bit)) {
+    inserted = true;
+    n->leaf_map |= bit;
+    n->leaves.emplace(n->leaves.begin() + pos, key_type(key, allocator_), T());
+    return &n->leaves[pos].second;
+  }
+  if (n->leaves[pos].first == key) {
+    return &n->leaves[pos].second;
+  }
+  // two keys share the hash bits of this level, push both one level down
+  auto moved = std::move(n->leaves[pos]);
+  n->leaves.erase(n->leaves.begin() + pos);
+  n->leaf_map ^= bit;
+  auto child_pos = index_(n->child_map, bit);
+  n->child_map |= bit;
+  n->children.emplace(n->children.begin() + child_pos, make_node_(shift + bits_ >= hash_bits_));
+  auto &child = n->children[child_pos];
+  bool ignored = false;
+  *assign_(child, hash_(moved.first), moved.first, shift + bits_, ignored) = std::move(moved.second);
+  return assign_(child, hash, key, shift + bits_, inserted);
+}
+
+template<typename T>
+typename hamt_map<T>::size_type hamt_map<T>::erase(std::string_view key) {
+  if (std::as_const(*this).find(key) == end()) {
+    return 0;
+  }
+  erase_(root_, hash_(key), key, 0);
+  --size_;
+  return 1;
+}
+
+template<typename T>
+bool hamt_map<T>::erase_(boost::intrusive_ptr<node> &slot, std::size_t hash, std::string_view key, unsigned shift) {
+  make_unique_(slot);
+  auto *n = slot.get();
+  if (n->collision) {
+    for (auto it = n->leaves.begin(); it != n->leaves.end(); ++it) {
+      if (it->first == key) {
+        n->leaves.erase(it);
+        return true;
+      }
+    }
+    return false;
+  }
+  auto bit = uint32_t(1) << ((hash >> shift) & 31);
+  if (n->leaf_map & bit) {
+    n->leaves.erase(n->leaves.begin() + index_(n->leaf_map, bit));
+    n->leaf_map ^= bit;
+    return true;
+  }
+  auto child_pos = index_(n->child_map, bit);
+  auto &child = n->children[child_pos];
+  if (!erase_(child, hash, key, shift + bits_)) {
+    return false;
+  }
+  if (!child->children.empty() || child->leaves.size() > 1) {
+    return true;
+  }
+  // keep the trie canonical: a sub-trie left with a single leaf is inlined into its parent
+  if (child->leaves.size() == 1) {
+    auto leaf = std::move(child->leaves.front());
+    n->leaves.emplace(n->leaves.begin() + index_(n->leaf_map, bit), std::move(leaf));
+    n->leaf_map |= bit;
+  }
+  n->children.erase(n->children.begin() + child_pos);
+  n->child_map ^= bit;
+  return true;
+}
+
+template<typename T>
+typename hamt_map<T>::size_type hamt_map<T>::size() const noexcept {
+  return size_;
+}
+
+template<typename T>
+bool hamt_map<T>::empty() const noexcept {
+  return size_ == 0;
+}
+
+template<typename T>
+typename hamt_map<T>::const_iterator hamt_map<T>::begin() const {
+  const_iterator it;
+  if (root_ != nullptr) {
+    it.push_(root_.get(), 0, 0);
+    it.settle_();
+  }
+  return it;
+}
+
+template<typename T>
+typename hamt_map<T>::const_iterator hamt_map<T>::end() const noexcept {
+  return {};
+}
+
+template<typename T>
+std::pmr::polymorphic_allocator<typename hamt_map<T>::value_type> hamt_map<T>::get_allocator() const noexcept {
+  return {allocator_};
+}
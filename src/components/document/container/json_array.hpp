@@ -1,11 +1,15 @@
 #pragma once
 
 #include <components/document/base.hpp>
+#include <algorithm>
 
 template<typename FirstType, typename SecondType>
 class json_array {
+  using storage_type = std::pmr::vector<boost::intrusive_ptr<json_trie_node<FirstType, SecondType>>>;
+
 public:
   using allocator_type = std::pmr::memory_resource;
+  using const_iterator = typename storage_type::const_iterator;
 
   explicit json_array(allocator_type *allocator) noexcept;
 
@@ -21,15 +25,27 @@ public:
 
   const json_trie_node<FirstType, SecondType> *get(uint32_t index) const;
 
+  json_trie_node<FirstType, SecondType> *get_unique(uint32_t index);
+
   void set(uint32_t index, json_trie_node<FirstType, SecondType> *value);
 
   void set(uint32_t index, boost::intrusive_ptr<json_trie_node<FirstType, SecondType>> &&value);
 
+  void insert(uint32_t index, boost::intrusive_ptr<json_trie_node<FirstType, SecondType>> &&value);
+
   boost::intrusive_ptr<json_trie_node<FirstType, SecondType>> remove(uint32_t index);
 
   uint32_t size() const noexcept;
 
-  json_array<FirstType, SecondType> *make_deep_copy() const;
+  void reserve(uint32_t size);
+
+  const_iterator begin() const;
+
+  const_iterator end() const;
+
+  json_array<FirstType, SecondType> make_copy() const;
+
+  json_array<FirstType, SecondType> make_deep_copy() const;
 
   std::pmr::string to_json(
           std::pmr::string (*)(const FirstType *, std::pmr::memory_resource *),
@@ -44,7 +60,7 @@ public:
   ) const;
 
 private:
-  std::pmr::vector<boost::intrusive_ptr<json_trie_node<FirstType, SecondType>>> items_;
+  storage_type items_;
 };
 
 template<typename FirstType, typename SecondType>
@@ -59,6 +75,15 @@ const json_trie_node<FirstType, SecondType> *json_array<FirstType, SecondType>::
   return items_[index].get();
 }
 
+template<typename FirstType, typename SecondType>
+json_trie_node<FirstType, SecondType> *json_array<FirstType, SecondType>::get_unique(uint32_t index) {
+  if (index >= size()) {
+    return nullptr;
+  }
+  json_trie_node<FirstType, SecondType>::make_unique(items_[index]);
+  return items_[index].get();
+}
+
 template<typename FirstType, typename SecondType>
 void json_array<FirstType, SecondType>::set(uint32_t index, json_trie_node<FirstType, SecondType> *value) {
   if (index >= size()) {
@@ -78,6 +103,12 @@ json_array<FirstType, SecondType>::set(uint32_t index, boost::intrusive_ptr<json
   }
 }
 
+template<typename FirstType, typename SecondType>
+void
+json_array<FirstType, SecondType>::insert(uint32_t index, boost::intrusive_ptr<json_trie_node<FirstType, SecondType>> &&value) {
+  items_.insert(items_.begin() + std::min(index, size()), std::move(value));
+}
+
 template<typename FirstType, typename SecondType>
 boost::intrusive_ptr<json_trie_node<FirstType, SecondType>> json_array<FirstType, SecondType>::remove(uint32_t index) {
   if (index >= size()) {
@@ -94,10 +125,33 @@ uint32_t json_array<FirstType, SecondType>::size() const noexcept {
 }
 
 template<typename FirstType, typename SecondType>
-json_array<FirstType, SecondType> *json_array<FirstType, SecondType>::make_deep_copy() const {
-  auto copy = new(items_.get_allocator().resource()->allocate(sizeof(json_array<FirstType, SecondType>))) json_array(items_.get_allocator().resource());
-  for (uint32_t i = 0; i < items_.size(); ++i) {
-    copy->items_[i] = items_[i]->make_deep_copy();
+void json_array<FirstType, SecondType>::reserve(uint32_t size) {
+  items_.reserve(size);
+}
+
+template<typename FirstType, typename SecondType>
+typename json_array<FirstType, SecondType>::const_iterator json_array<FirstType, SecondType>::begin() const {
+  return items_.begin();
+}
+
+template<typename FirstType, typename SecondType>
+typename json_array<FirstType, SecondType>::const_iterator json_array<FirstType, SecondType>::end() const {
+  return items_.end();
+}
+
+template<typename FirstType, typename SecondType>
+json_array<FirstType, SecondType> json_array<FirstType, SecondType>::make_copy() const {
+  json_array copy(items_.get_allocator().resource());
+  copy.items_ = items_;
+  return copy;
+}
+
+template<typename FirstType, typename SecondType>
+json_array<FirstType, SecondType> json_array<FirstType, SecondType>::make_deep_copy() const {
+  json_array copy(items_.get_allocator().resource());
+  copy.items_.reserve(items_.size());
+  for (auto &it : items_) {
+    copy.items_.emplace_back(it->make_deep_copy());
   }
   return copy;
 }
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <components/document/base.hpp>
+#ifdef DOCUMENT_HAMT_OBJECTS
+#include <components/document/container/hamt_map.hpp>
+#else
 #include <absl/container/flat_hash_map.h>
+#endif
 
 struct string_view_hash {
   using is_transparent = void;
@@ -33,8 +37,25 @@ struct string_view_eq {
 
 template<typename FirstType, typename SecondType>
 class json_object {
+#ifdef DOCUMENT_HAMT_OBJECTS
+  using storage_type = hamt_map<boost::intrusive_ptr<json_trie_node<FirstType, SecondType>>>;
+#else
+  using storage_type = absl::flat_hash_map<
+          std::pmr::string,
+          boost::intrusive_ptr<json_trie_node<FirstType, SecondType>>,
+          string_view_hash, string_view_eq,
+          std::pmr::polymorphic_allocator<
+                  std::pair<
+                          const std::pmr::string,
+                          boost::intrusive_ptr<json_trie_node<FirstType, SecondType>>
+                  >
+          >
+  >;
+#endif
+
 public:
   using allocator_type = std::pmr::memory_resource;
+  using const_iterator = typename storage_type::const_iterator;
 
   explicit json_object(allocator_type *allocator) noexcept;
 
@@ -50,6 +71,8 @@ public:
 
   const json_trie_node<FirstType, SecondType> *get(std::string_view key) const;
 
+  json_trie_node<FirstType, SecondType> *get_unique(std::string_view key);
+
   void set(std::string_view key, json_trie_node<FirstType, SecondType> *value);
 
   void set(std::string_view key, boost::intrusive_ptr<json_trie_node<FirstType, SecondType>> &&value);
@@ -58,7 +81,15 @@ public:
 
   size_t size() const noexcept;
 
-  json_object<FirstType, SecondType> *make_deep_copy() const;
+  void reserve(size_t size);
+
+  const_iterator begin() const;
+
+  const_iterator end() const;
+
+  json_object<FirstType, SecondType> make_copy() const;
+
+  json_object<FirstType, SecondType> make_deep_copy() const;
 
   std::pmr::string to_json(
           std::pmr::string (*)(const FirstType *, std::pmr::memory_resource *),
@@ -72,26 +103,22 @@ public:
           bool (*)(const FirstType *, const SecondType *)
   ) const;
 
-  json_object<FirstType, SecondType> *make_copy_except_deleter(allocator_type *allocator) const;
+  json_object<FirstType, SecondType> make_copy_except_deleter(allocator_type *allocator) const;
 
-  static json_object<FirstType, SecondType> *merge(
-          json_object<FirstType, SecondType> &object1,
-          json_object<FirstType, SecondType> &object2,
+  static json_object<FirstType, SecondType> merge(
+          const json_object<FirstType, SecondType> &object1,
+          const json_object<FirstType, SecondType> &object2,
+          allocator_type *allocator
+  );
+
+  static json_object<FirstType, SecondType> merge(
+          const json_object<FirstType, SecondType> *base,
+          const std::pmr::vector<const json_object<FirstType, SecondType> *> &layers,
           allocator_type *allocator
   );
 
 private:
-  absl::flat_hash_map<
-          std::pmr::string,
-          boost::intrusive_ptr<json_trie_node<FirstType, SecondType>>,
-          string_view_hash, string_view_eq,
-          std::pmr::polymorphic_allocator<
-                  std::pair<
-                          const std::pmr::string,
-                          boost::intrusive_ptr<json_trie_node<FirstType, SecondType>>
-                  >
-          >
-  > map_;
+  storage_type map_;
 };
 
 template<typename FirstType, typename SecondType>
@@ -107,6 +134,16 @@ const json_trie_node<FirstType, SecondType> *json_object<FirstType, SecondType>:
   return res->second.get();
 }
 
+template<typename FirstType, typename SecondType>
+json_trie_node<FirstType, SecondType> *json_object<FirstType, SecondType>::get_unique(std::string_view key) {
+  auto res = map_.find(key);
+  if (res == map_.end()) {
+    return nullptr;
+  }
+  json_trie_node<FirstType, SecondType>::make_unique(res->second);
+  return res->second.get();
+}
+
 template<typename FirstType, typename SecondType>
 void json_object<FirstType, SecondType>::set(std::string_view key, json_trie_node<FirstType, SecondType> *value) {
   map_[key] = value;
@@ -128,7 +165,7 @@ json_object<FirstType, SecondType>::remove(std::string_view key) {
     return nullptr;
   }
   auto copy = found->second;
-  map_.erase(found);
+  map_.erase(key);
   return copy;
 }
 
@@ -138,12 +175,33 @@ size_t json_object<FirstType, SecondType>::size() const noexcept {
 }
 
 template<typename FirstType, typename SecondType>
-json_object<FirstType, SecondType> *
-json_object<FirstType, SecondType>::make_deep_copy() const {
-  auto copy = new(map_.get_allocator().resource()->allocate(sizeof(json_object<FirstType, SecondType>)))
-          json_object(map_.get_allocator().resource());
+void json_object<FirstType, SecondType>::reserve(size_t size) {
+  map_.reserve(size);
+}
+
+template<typename FirstType, typename SecondType>
+typename json_object<FirstType, SecondType>::const_iterator json_object<FirstType, SecondType>::begin() const {
+  return map_.begin();
+}
+
+template<typename FirstType, typename SecondType>
+typename json_object<FirstType, SecondType>::const_iterator json_object<FirstType, SecondType>::end() const {
+  return map_.end();
+}
+
+template<typename FirstType, typename SecondType>
+json_object<FirstType, SecondType> json_object<FirstType, SecondType>::make_copy() const {
+  json_object copy(map_.get_allocator().resource());
+  copy.map_ = map_;
+  return copy;
+}
+
+template<typename FirstType, typename SecondType>
+json_object<FirstType, SecondType> json_object<FirstType, SecondType>::make_deep_copy() const {
+  json_object copy(map_.get_allocator().resource());
+  copy.map_.reserve(map_.size());
   for (auto &it : map_) {
-    copy->map_.emplace(it.first, it.second->make_deep_copy());
+    copy.map_.emplace(it.first, it.second->make_deep_copy());
   }
   return copy;
 }
@@ -194,40 +252,95 @@ json_object<FirstType, SecondType>::equals(
 }
 
 template<typename FirstType, typename SecondType>
-json_object<FirstType, SecondType> *
+json_object<FirstType, SecondType>
 json_object<FirstType, SecondType>::make_copy_except_deleter(allocator_type *allocator) const {
-  auto copy = new(allocator->allocate(sizeof(json_object))) json_object(allocator);
+  json_object copy(allocator);
   for (auto &it : map_) {
     if (it.second->is_deleter()) {
       continue;
     }
-    copy->map_.emplace(it);
+    copy.map_.emplace(it);
   }
   return copy;
 }
 
 template<typename FirstType, typename SecondType>
-json_object<FirstType, SecondType> *json_object<FirstType, SecondType>::merge(
-        json_object<FirstType, SecondType> &object1,
-        json_object<FirstType, SecondType> &object2,
+json_object<FirstType, SecondType> json_object<FirstType, SecondType>::merge(
+        const json_object<FirstType, SecondType> &object1,
+        const json_object<FirstType, SecondType> &object2,
         json_object::allocator_type *allocator
 ) {
-  auto res = new(allocator->allocate(sizeof(json_object))) json_object(allocator);
+  json_object res(allocator);
   for (auto &it : object2.map_) {
     if (it.second->is_deleter()) {
       continue;
     }
     auto next = object1.map_.find(it.first);
     if (next == object1.map_.end()) {
-      res->map_.emplace(it);
+      res.map_.emplace(it);
     } else {
-      res->map_.emplace(it.first, json_trie_node<FirstType, SecondType>::merge(next->second.get(), it.second.get(), allocator));
+      res.map_.emplace(it.first, json_trie_node<FirstType, SecondType>::merge(next->second.get(), it.second.get(), allocator));
     }
   }
   for (auto &it : object1.map_) {
     if (object2.map_.find(it.first) == object2.map_.end()) {
-      res->map_.emplace(it);
+      res.map_.emplace(it);
     }
   }
   return res;
-}
\ No newline at end of file
+}
+
+// Every key is resolved once, by the last layer that has it, from the values all
+// layers hold for it.
+template<typename FirstType, typename SecondType>
+json_object<FirstType, SecondType> json_object<FirstType, SecondType>::merge(
+        const json_object<FirstType, SecondType> *base,
+        const std::pmr::vector<const json_object<FirstType, SecondType> *> &layers,
+        json_object::allocator_type *allocator
+) {
+  json_object res(allocator);
+  std::pmr::vector<json_trie_node<FirstType, SecondType> *> values(allocator);
+  values.reserve(layers.size());
+  auto is_in_layers = [&layers](std::string_view key, size_t from) {
+    for (auto i = from; i < layers.size(); ++i) {
+      if (layers[i]->map_.find(key) != layers[i]->map_.end()) {
+        return true;
+      }
+    }
+    return false;
+  };
+  for (size_t i = layers.size(); i-- > 0;) {
+    for (auto &it : layers[i]->map_) {
+      if (is_in_layers(it.first, i + 1)) {
+        continue;
+      }
+      values.clear();
+      for (size_t j = 0; j < i; ++j) {
+        auto next = layers[j]->map_.find(it.first);
+        if (next != layers[j]->map_.end()) {
+          values.push_back(next->second.get());
+        }
+      }
+      values.push_back(it.second.get());
+      json_trie_node<FirstType, SecondType> *value = nullptr;
+      if (base != nullptr) {
+        auto next = base->map_.find(it.first);
+        if (next != base->map_.end()) {
+          value = next->second.get();
+        }
+      }
+      value = json_trie_node<FirstType, SecondType>::merge(value, values, allocator);
+      if (value != nullptr) {
+        res.map_.emplace(it.first, value);
+      }
+    }
+  }
+  if (base != nullptr) {
+    for (auto &it : base->map_) {
+      if (!is_in_layers(it.first, 0)) {
+        res.map_.emplace(it);
+      }
+    }
+  }
+  return res;
+}
@@ -1,9 +1,15 @@
 #include "document.hpp"
 #include <utility>
 #include <charconv>
+#include <cmath>
+#include <cstring>
 #include <components/document/varint.hpp>
+#include <components/document/hash.hpp>
 #include <components/document/string_splitter.hpp>
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 #include <boost/json/src.hpp>
+#include <boost/json/basic_parser_impl.hpp>
 
 namespace components::document {
 
@@ -15,6 +21,9 @@ document_t::document_t()
           is_root_(false) {}
 
 document_t::~document_t() {
+  if (owner_ != nullptr) {
+    element_ind_->unpin();
+  }
   if (is_root_) {
     mr_delete(allocator_, mut_src_);
     mr_delete(allocator_, immut_src_);
@@ -27,8 +36,21 @@ document_t::document_t(document_t &&other) noexcept
           mut_src_(other.mut_src_),
           builder_(std::move(other.builder_)),
           element_ind_(std::move(other.element_ind_)),
+          base_ind_(std::move(other.base_ind_)),
+          patch_ind_(std::move(other.patch_ind_)),
           ancestors_(std::move(other.ancestors_)),
-          is_root_(other.is_root_) {
+          owner_(std::move(other.owner_)),
+          view_path_(std::move(other.view_path_)),
+          generation_(other.generation_),
+          view_generation_(other.view_generation_),
+          is_root_(other.is_root_),
+          dead_bytes_(other.dead_bytes_),
+          compaction_threshold_(other.compaction_threshold_),
+          consolidation_factor_(other.consolidation_factor_),
+          pinned_bytes_(other.pinned_bytes_),
+          pinned_documents_(std::move(other.pinned_documents_)),
+          next_consolidation_check_(other.next_consolidation_check_),
+          path_filter_(std::move(other.path_filter_)) {
   other.allocator_ = nullptr;
   other.mut_src_ = nullptr;
   other.immut_src_ = nullptr;
@@ -41,7 +63,9 @@ document_t::document_t(document_t::allocator_type *allocator, bool is_root)
           mut_src_(is_root ? new(allocator_->allocate(sizeof(simdjson::dom::mutable_document))) simdjson::dom::mutable_document(allocator_) : nullptr),
           element_ind_(is_root ? json_trie_node_element::create_object(allocator_) : nullptr),
           ancestors_(allocator_),
-          is_root_(is_root) {
+          view_path_(allocator_),
+          is_root_(is_root),
+          path_filter_(allocator_) {
   if (is_root) {
     builder_ = simdjson::tape_builder<simdjson::dom::tape_writer_to_mutable>(allocator_, *mut_src_);
   }
@@ -148,19 +172,23 @@ std::pmr::string document_t::get_string(std::string_view json_pointer) const {
 }
 
 document_t::ptr document_t::get_array(std::string_view json_pointer) {
-  const auto node_ptr = find_node(json_pointer).first;
+  // a lookup, the writes of the view copy the path and drop the path filter
+  const auto node_ptr = find_node_const(json_pointer).first;
   if (node_ptr == nullptr || !node_ptr->is_array()) {
     return nullptr; // temporarily
   }
-  return new(allocator_->allocate(sizeof(document_t))) document_t({this}, allocator_, node_ptr);
+  auto *node = const_cast<json_trie_node_element *>(node_ptr);
+  return new(allocator_->allocate(sizeof(document_t))) document_t({this}, allocator_, node, json_pointer);
 }
 
 document_t::ptr document_t::get_dict(std::string_view json_pointer) {
-  const auto node_ptr = find_node(json_pointer).first;
+  // a lookup, the writes of the view copy the path and drop the path filter
+  const auto node_ptr = find_node_const(json_pointer).first;
   if (node_ptr == nullptr || !node_ptr->is_object()) {
     return nullptr; // temporarily
   }
-  return new(allocator_->allocate(sizeof(document_t))) document_t({this}, allocator_, node_ptr);
+  auto *node = const_cast<json_trie_node_element *>(node_ptr);
+  return new(allocator_->allocate(sizeof(document_t))) document_t({this}, allocator_, node, json_pointer);
 }
 
 template<class T, typename FirstType, typename SecondType>
@@ -222,6 +250,167 @@ compare_t compare_(
   return compare_t::equals;
 }
 
+static void append_sort_key_tag_(std::pmr::string &key, sort_key_tag_t tag) {
+  key.push_back(static_cast<char>(tag));
+}
+
+template<typename T>
+void append_big_endian_(std::pmr::string &key, T value) {
+  for (int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8) {
+    key.push_back(static_cast<char>(static_cast<unsigned char>(value >> shift)));
+  }
+}
+
+// A number is the order-preserving bits of its double value, followed by its exact
+// value as int128 to order the integers that round to the same double.
+static void append_number_sort_key_(std::pmr::string &key, double value, __int128_t exact) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  // -0.0 sorts as 0.0
+  if ((bits << 1) == 0) {
+    bits = 0;
+  }
+  bits = (bits >> 63) ? ~bits : bits | (std::uint64_t(1) << 63);
+  append_sort_key_tag_(key, sort_key_tag_t::NUMBER);
+  append_big_endian_(key, bits);
+  append_big_endian_(key, static_cast<__uint128_t>(exact) ^ (static_cast<__uint128_t>(1) << 127));
+}
+
+static void append_number_sort_key_(std::pmr::string &key, double value) {
+  constexpr double limit = 170141183460469231731687303715884105728.0; // 2^127
+  __int128_t exact;
+  if (std::isnan(value) || value >= limit) {
+    exact = ~(static_cast<__int128_t>(1) << 127);
+  } else if (value < -limit) {
+    exact = static_cast<__int128_t>(1) << 127;
+  } else {
+    exact = static_cast<__int128_t>(value);
+  }
+  append_number_sort_key_(key, value, exact);
+}
+
+static void append_string_sort_key_(std::pmr::string &key, std::string_view value) {
+  // 0x00 is escaped as 0x00 0xff, 0x00 0x00 terminates
+  append_sort_key_tag_(key, sort_key_tag_t::STRING);
+  for (auto c : value) {
+    key.push_back(c);
+    if (c == '\0') {
+      key.push_back(static_cast<char>(0xff));
+    }
+  }
+  key.append(2, '\0');
+}
+
+template<typename K>
+void append_sort_key_(std::pmr::string &key, const simdjson::dom::element<K> &element) {
+  using simdjson::dom::element_type;
+
+  switch (element.type()) {
+    case element_type::INT8:
+    case element_type::INT16:
+    case element_type::INT32:
+    case element_type::INT64: {
+      auto value = element.get_int64().value();
+      append_number_sort_key_(key, static_cast<double>(value), value);
+      break;
+    }
+    case element_type::INT128: {
+      auto value = element.get_int128().value();
+      append_number_sort_key_(key, static_cast<double>(value), value);
+      break;
+    }
+    case element_type::UINT8:
+    case element_type::UINT16:
+    case element_type::UINT32:
+    case element_type::UINT64: {
+      auto value = element.get_uint64().value();
+      append_number_sort_key_(key, static_cast<double>(value), value);
+      break;
+    }
+    case element_type::FLOAT:
+      append_number_sort_key_(key, element.get_float().value());
+      break;
+    case element_type::DOUBLE:
+      append_number_sort_key_(key, element.get_double().value());
+      break;
+    case element_type::STRING:
+      append_string_sort_key_(key, element.get_string().value());
+      break;
+    case element_type::BOOL:
+      append_sort_key_tag_(key, element.get_bool().value() ? sort_key_tag_t::TRUE_VALUE : sort_key_tag_t::FALSE_VALUE);
+      break;
+    case element_type::NULL_VALUE:
+      append_sort_key_tag_(key, sort_key_tag_t::NULL_VALUE);
+      break;
+  }
+}
+
+template<typename Node>
+void append_sort_key_(std::pmr::string &key, const Node *node) {
+  if (node == nullptr || node->is_deleter()) {
+    append_sort_key_tag_(key, sort_key_tag_t::MISSING);
+  } else if (node->is_first()) {
+    append_sort_key_(key, *node->get_first());
+  } else if (node->is_second()) {
+    append_sort_key_(key, *node->get_second());
+  } else if (node->is_array()) {
+    append_sort_key_tag_(key, sort_key_tag_t::ARRAY);
+    for (const auto &it : *node->get_array()) {
+      append_sort_key_(key, it.get());
+    }
+    key.push_back('\0');
+  } else {
+    append_sort_key_tag_(key, sort_key_tag_t::OBJECT);
+  }
+}
+
+void append_sort_key(const boost::json::value &value, std::pmr::string &key) {
+  switch (value.kind()) {
+    case boost::json::kind::null:
+      append_sort_key_tag_(key, sort_key_tag_t::NULL_VALUE);
+      break;
+    case boost::json::kind::bool_:
+      append_sort_key_tag_(key, value.get_bool() ? sort_key_tag_t::TRUE_VALUE : sort_key_tag_t::FALSE_VALUE);
+      break;
+    case boost::json::kind::int64:
+      append_number_sort_key_(key, static_cast<double>(value.get_int64()), value.get_int64());
+      break;
+    case boost::json::kind::uint64:
+      append_number_sort_key_(key, static_cast<double>(value.get_uint64()), value.get_uint64());
+      break;
+    case boost::json::kind::double_:
+      append_number_sort_key_(key, value.get_double());
+      break;
+    case boost::json::kind::string:
+      append_string_sort_key_(key, value.get_string());
+      break;
+    case boost::json::kind::array:
+      append_sort_key_tag_(key, sort_key_tag_t::ARRAY);
+      for (const auto &it : value.get_array()) {
+        append_sort_key(it, key);
+      }
+      key.push_back('\0');
+      break;
+    case boost::json::kind::object:
+      append_sort_key_tag_(key, sort_key_tag_t::OBJECT);
+      break;
+  }
+}
+
+std::pmr::string document_t::sort_key(std::string_view json_pointer) const {
+  std::pmr::string key(allocator_);
+  append_sort_key(json_pointer, key);
+  return key;
+}
+
+void document_t::append_sort_key(std::string_view json_pointer, std::pmr::string &key) const {
+  append_sort_key_(key, find_node_const(json_pointer).first);
+}
+
+void document_t::append_node_sort_key_(const json_trie_node_element *node, std::pmr::string &key) {
+  append_sort_key_(key, node);
+}
+
 compare_t document_t::compare(const document_t& other, std::string_view json_pointer) const {
   if (is_valid() && !other.is_valid())
     return compare_t::less;
@@ -253,14 +442,237 @@ compare_t document_t::compare(const document_t& other, std::string_view json_poi
   }
 }
 
-document_t::document_t(ptr ancestor, allocator_type *allocator, json_trie_node_element* index)
+document_t::document_t(ptr owner, allocator_type *allocator, json_trie_node_element* index, std::string_view json_pointer)
         : allocator_(allocator),
           immut_src_(nullptr),
-          mut_src_(ancestor->mut_src_),
+          mut_src_(owner->mut_src_),
           builder_(allocator_, *mut_src_),
           element_ind_(index),
-          ancestors_(std::pmr::vector<ptr>({std::move(ancestor)}, allocator_)),
-          is_root_(false) {}
+          ancestors_(std::pmr::vector<ptr>({owner}, allocator_)),
+          owner_(std::move(owner)),
+          view_path_(json_pointer, allocator_),
+          is_root_(false) {
+  element_ind_->pin();
+  view_generation_ = top_owner_()->generation_;
+}
+
+// Bytes an element takes on the tape and in the string buffer.
+template<typename K>
+std::pair<std::size_t, std::size_t> element_size_(const simdjson::dom::element<K> &element) {
+  using simdjson::internal::tape_type;
+
+  const auto &tape = element.get_tape_ref();
+  switch (tape.tape_ref_type()) {
+    case tape_type::STRING:
+      return {sizeof(uint64_t), sizeof(uint32_t) + tape.get_string_length() + 1};
+    case tape_type::INT64:
+    case tape_type::UINT64:
+    case tape_type::DOUBLE:
+      return {2 * sizeof(uint64_t), 0};
+    case tape_type::INT128:
+      return {3 * sizeof(uint64_t), 0};
+    default:
+      return {sizeof(uint64_t), 0};
+  }
+}
+
+template<typename T, typename K>
+void copy_element_(simdjson::tape_builder<T> &builder, const simdjson::dom::element<K> &element) {
+  using simdjson::dom::element_type;
+
+  switch (element.type()) {
+    case element_type::INT8:
+      builder.build(element.get_int8().value());
+      break;
+    case element_type::INT16:
+      builder.build(element.get_int16().value());
+      break;
+    case element_type::INT32:
+      builder.build(element.get_int32().value());
+      break;
+    case element_type::INT64:
+      builder.build(element.get_int64().value());
+      break;
+    case element_type::INT128:
+      builder.build(element.get_int128().value());
+      break;
+    case element_type::UINT8:
+      builder.build(element.get_uint8().value());
+      break;
+    case element_type::UINT16:
+      builder.build(element.get_uint16().value());
+      break;
+    case element_type::UINT32:
+      builder.build(element.get_uint32().value());
+      break;
+    case element_type::UINT64:
+      builder.build(element.get_uint64().value());
+      break;
+    case element_type::FLOAT:
+      builder.build(element.get_float().value());
+      break;
+    case element_type::DOUBLE:
+      builder.build(element.get_double().value());
+      break;
+    case element_type::STRING:
+      builder.build(element.get_string().value());
+      break;
+    case element_type::BOOL:
+      builder.build(element.get_bool().value());
+      break;
+    case element_type::NULL_VALUE:
+      builder.visit_null_atom();
+      break;
+  }
+}
+
+// Calls visitor once for every value leaf reachable from node, subtrees shared within the trie are walked once.
+template<typename Node, typename Visitor>
+void for_each_leaf_(Node *node, absl::flat_hash_set<const Node *> &visited, Visitor &visitor) {
+  if (node->is_shared() && !visited.insert(node).second) {
+    return;
+  }
+  if (node->is_object()) {
+    for (auto &it : *node->get_object()) {
+      for_each_leaf_<Node>(it.second.get(), visited, visitor);
+    }
+  } else if (node->is_array()) {
+    for (auto &it : *node->get_array()) {
+      for_each_leaf_<Node>(it.get(), visited, visitor);
+    }
+  } else if (node->is_first() || node->is_second()) {
+    visitor(node);
+  }
+}
+
+// Returns node with every leaf for which relocate gives a replacement swapped out.
+// Subtrees without such leaves are returned as they are, containers on the way to
+// a replaced leaf are updated in place unless shared, in which case they are copied once.
+template<typename Node, typename Relocate>
+boost::intrusive_ptr<Node> rebuild_(
+        Node *node,
+        absl::flat_hash_map<const Node *, boost::intrusive_ptr<Node>> &rebuilt,
+        Relocate &relocate,
+        std::pmr::memory_resource *allocator
+) {
+  auto is_shared = node->is_shared();
+  if (is_shared) {
+    auto found = rebuilt.find(node);
+    if (found != rebuilt.end()) {
+      return found->second;
+    }
+  }
+  boost::intrusive_ptr<Node> res(node);
+  if (node->is_object()) {
+    std::pmr::vector<std::pair<std::pmr::string, boost::intrusive_ptr<Node>>> changed(allocator);
+    for (auto &it : *node->get_object()) {
+      auto child = rebuild_(it.second.get(), rebuilt, relocate, allocator);
+      if (child != it.second) {
+        changed.emplace_back(it.first, std::move(child));
+      }
+    }
+    if (!changed.empty()) {
+      if (is_shared) {
+        res = node->make_shallow_copy();
+      }
+      for (auto &it : changed) {
+        res->as_object()->set(it.first, std::move(it.second));
+      }
+    }
+  } else if (node->is_array()) {
+    std::pmr::vector<std::pair<uint32_t, boost::intrusive_ptr<Node>>> changed(allocator);
+    uint32_t index = 0;
+    for (auto &it : *node->get_array()) {
+      auto child = rebuild_(it.get(), rebuilt, relocate, allocator);
+      if (child != it) {
+        changed.emplace_back(index, std::move(child));
+      }
+      ++index;
+    }
+    if (!changed.empty()) {
+      if (is_shared) {
+        res = node->make_shallow_copy();
+      }
+      for (auto &it : changed) {
+        res->as_array()->set(it.first, std::move(it.second));
+      }
+    }
+  } else if (node->is_first() || node->is_second()) {
+    auto relocated = relocate(node);
+    if (relocated != nullptr) {
+      res = std::move(relocated);
+    }
+  }
+  if (is_shared) {
+    rebuilt.emplace(node, res);
+  }
+  return res;
+}
+
+// Copies the trie under node into allocator, leaves are copied by copy_leaf.
+// Subtrees shared within the trie stay shared in the copy.
+template<typename Node, typename CopyLeaf>
+boost::intrusive_ptr<Node> clone_(
+        const Node *node,
+        absl::flat_hash_map<const Node *, boost::intrusive_ptr<Node>> &cloned,
+        CopyLeaf &copy_leaf,
+        std::pmr::memory_resource *allocator
+) {
+  auto is_shared = node->is_shared();
+  if (is_shared) {
+    auto found = cloned.find(node);
+    if (found != cloned.end()) {
+      return found->second;
+    }
+  }
+  boost::intrusive_ptr<Node> res;
+  if (node->is_object()) {
+    res = Node::create_object(allocator);
+    auto obj = res->as_object();
+    obj->reserve(node->get_object()->size());
+    for (auto &it : *node->get_object()) {
+      obj->set(it.first, clone_(it.second.get(), cloned, copy_leaf, allocator));
+    }
+  } else if (node->is_array()) {
+    res = Node::create_array(allocator);
+    auto arr = res->as_array();
+    arr->reserve(node->get_array()->size());
+    uint32_t index = 0;
+    for (auto &it : *node->get_array()) {
+      arr->set(index++, clone_(it.get(), cloned, copy_leaf, allocator));
+    }
+  } else if (node->is_deleter()) {
+    res = Node::create_deleter(allocator);
+  } else {
+    res = copy_leaf(node);
+  }
+  if (is_shared) {
+    cloned.emplace(node, res);
+  }
+  return res;
+}
+
+// Bytes of src that become unreachable once node is dropped. Shared subtrees stay alive elsewhere.
+template<typename Node>
+std::size_t unreachable_bytes_(const Node *node, const simdjson::dom::mutable_document *src) {
+  if (node->is_shared()) {
+    return 0;
+  }
+  std::size_t res = 0;
+  if (node->is_object()) {
+    for (auto &it : *node->get_object()) {
+      res += unreachable_bytes_(it.second.get(), src);
+    }
+  } else if (node->is_array()) {
+    for (auto &it : *node->get_array()) {
+      res += unreachable_bytes_(it.get(), src);
+    }
+  } else if (node->is_second() && node->get_second()->get_tape_ref().doc == src) {
+    auto size = element_size_(*node->get_second());
+    res += size.first + size.second;
+  }
+  return res;
+}
 
 error_code_t document_t::set_array(std::string_view json_pointer) {
   return set_(json_pointer, special_type::ARRAY);
@@ -281,8 +693,13 @@ error_code_t document_t::set_null(std::string_view json_pointer) {
 }
 
 error_code_t document_t::remove(std::string_view json_pointer) {
-  boost::intrusive_ptr<json_trie_node_element> ignored;
-  return remove_(json_pointer, ignored);
+  boost::intrusive_ptr<json_trie_node_element> removed;
+  auto res = remove_(json_pointer, removed);
+  if (res == error_code_t::SUCCESS) {
+    add_dead_bytes_(removed.get());
+    compact_if_needed_();
+  }
+  return res;
 }
 
 error_code_t document_t::move(std::string_view json_pointer_from, std::string_view json_pointer_to) {
@@ -295,22 +712,16 @@ error_code_t document_t::move(std::string_view json_pointer_from, std::string_vi
 }
 
 error_code_t document_t::copy(std::string_view json_pointer_from, std::string_view json_pointer_to) {
-  json_trie_node_element *container;
-  bool is_view_key;
-  std::pmr::string key;
-  std::string_view view_key;
-  uint32_t index;
-  auto res = find_container_key(json_pointer_from, container, is_view_key, key, view_key, index);
-  if (res != error_code_t::SUCCESS) {
-    return res;
+  if (json_pointer_from.empty()) {
+    return error_code_t::INVALID_JSON_POINTER;
   }
-  auto node = container->is_object()
-              ? container->get_object()->get(is_view_key ? view_key : key)
-              : container->get_array()->get(index);
-  if (node == nullptr) {
-    return error_code_t::NO_SUCH_ELEMENT;
+  auto node_error = find_node_const(json_pointer_from);
+  if (node_error.second != error_code_t::SUCCESS) {
+    return node_error.second;
   }
-  return set_(json_pointer_to, node->make_deep_copy());
+  // the subtree is shared, both sides clone lazily along the path they write to
+  boost::intrusive_ptr<json_trie_node_element> node(const_cast<json_trie_node_element *>(node_error.first));
+  return set_(json_pointer_to, std::move(node));
 }
 
 error_code_t document_t::set_(std::string_view json_pointer, const element_from_mutable &value) {
@@ -323,11 +734,17 @@ error_code_t document_t::set_(std::string_view json_pointer, const element_from_
   if (res == error_code_t::SUCCESS) {
     auto node = json_trie_node_element::create(value, allocator_);
     if (container->is_object()) {
+      add_dead_bytes_(container->get_object()->get(is_view_key ? view_key : key));
       container->as_object()->set(is_view_key ? view_key : key, node);
     } else {
+      add_dead_bytes_(container->get_array()->get(index));
       container->as_array()->set(index, node);
     }
+  } else {
+    auto size = element_size_(value);
+    dead_bytes_ += size.first + size.second;
   }
+  compact_if_needed_();
   return res;
 }
 
@@ -340,13 +757,16 @@ error_code_t document_t::set_(std::string_view json_pointer, boost::intrusive_pt
   auto res = find_container_key(json_pointer, container, is_view_key, key, view_key, index);
   if (res == error_code_t::SUCCESS) {
     if (container->is_object()) {
+      add_dead_bytes_(container->get_object()->get(is_view_key ? view_key : key));
       container->as_object()->set(
               is_view_key ? view_key : key,
               std::move(value)
       );
     } else {
+      add_dead_bytes_(container->get_array()->get(index));
       container->as_array()->set(index, std::move(value));
     }
+    compact_if_needed_();
   }
   return res;
 }
@@ -361,10 +781,13 @@ error_code_t document_t::set_(std::string_view json_pointer, special_type value)
   if (res == error_code_t::SUCCESS) {
     auto node = creators[static_cast<int>(value)](allocator_);
     if (container->is_object()) {
+      add_dead_bytes_(container->get_object()->get(is_view_key ? view_key : key));
       container->as_object()->set(is_view_key ? view_key : key, node);
     } else {
+      add_dead_bytes_(container->get_array()->get(index));
       container->as_array()->set(index, node);
     }
+    compact_if_needed_();
   }
   return res;
 }
@@ -389,11 +812,59 @@ error_code_t document_t::remove_(std::string_view json_pointer, boost::intrusive
 }
 
 std::pair<document_t::json_trie_node_element *, error_code_t> document_t::find_node(std::string_view json_pointer) {
-  auto node_error = find_node_const(json_pointer);
-  return {const_cast<json_trie_node_element *>(node_error.first), node_error.second};
+  materialize();
+  // the node is about to be written, here or by a view
+  drop_path_filter_();
+  auto *current = unique_root_();
+  if (_usually_false(json_pointer.empty())) {
+    return {current, error_code_t::SUCCESS};
+  }
+  if (_usually_false(json_pointer[0] != '/')) {
+    return {nullptr, error_code_t::INVALID_JSON_POINTER};
+  }
+  json_pointer.remove_prefix(1);
+  for (auto key: string_splitter(json_pointer, '/')) {
+    auto error = error_code_t::SUCCESS;
+    current = find_child_unique_(current, key, error);
+    if (current == nullptr) {
+      return {nullptr, error};
+    }
+  }
+  return {current, error_code_t::SUCCESS};
+}
+
+document_t::json_trie_node_element *
+document_t::find_child_unique_(json_trie_node_element *node, std::string_view key, error_code_t &error) {
+  json_trie_node_element *res = nullptr;
+  if (node->is_object()) {
+    std::pmr::string unescaped_key;
+    bool is_unescaped;
+    error = unescape_key_(key, is_unescaped, unescaped_key, allocator_);
+    if (error != error_code_t::SUCCESS) {
+      return nullptr;
+    }
+    res = node->as_object()->get_unique(is_unescaped ? unescaped_key : key);
+  } else if (node->is_array()) {
+    res = node->as_array()->get_unique(static_cast<uint32_t>(atol(key.data())));
+  }
+  if (res == nullptr) {
+    error = error_code_t::NO_SUCH_ELEMENT;
+  }
+  return res;
 }
 
 std::pair<const document_t::json_trie_node_element *, error_code_t> document_t::find_node_const(std::string_view json_pointer) const {
+  sync_view_();
+  if (!may_contain(json_pointer)) {
+    return {nullptr, error_code_t::NO_SUCH_ELEMENT};
+  }
+  if (patch_ind_ != nullptr) {
+    auto res = find_overlay_node_(json_pointer);
+    if (res.first != nullptr || res.second != error_code_t::SUCCESS) {
+      return res;
+    }
+    materialize_();
+  }
   const auto *current = element_ind_.get();
   if (_usually_false(json_pointer.empty())) {
     return {current, error_code_t::SUCCESS};
@@ -412,7 +883,7 @@ std::pair<const document_t::json_trie_node_element *, error_code_t> document_t::
       }
       current = current->get_object()->get(is_unescaped ? unescaped_key : key);
     } else if (current->is_array()) {
-      current = current->get_array()->get(atol(key.data()));
+      current = current->get_array()->get(static_cast<uint32_t>(atol(key.data())));
     } else {
       return {nullptr, error_code_t::NO_SUCH_ELEMENT};
     }
@@ -423,6 +894,67 @@ std::pair<const document_t::json_trie_node_element *, error_code_t> document_t::
   return {current, error_code_t::SUCCESS};
 }
 
+// Reads of a lazy merge go through the patch layer first and fall through to the base,
+// following the rules of json_trie_node::merge without building anything. Returns nullptr
+// with SUCCESS for an object both layers contribute to, that one has to be materialized.
+std::pair<const document_t::json_trie_node_element *, error_code_t> document_t::find_overlay_node_(std::string_view json_pointer) const {
+  const auto *current = base_ind_.get();
+  const auto *patch = patch_ind_.get();
+  bool skip_deleters = false;
+  if (!patch->is_object() || !current->is_object()) {
+    skip_deleters = patch->is_object();
+    current = patch;
+    patch = nullptr;
+  }
+  if (_usually_false(json_pointer.empty())) {
+    return {patch == nullptr ? current : nullptr, error_code_t::SUCCESS};
+  }
+  if (_usually_false(json_pointer[0] != '/')) {
+    return {nullptr, error_code_t::INVALID_JSON_POINTER};
+  }
+  json_pointer.remove_prefix(1);
+  for (auto key: string_splitter(json_pointer, '/')) {
+    if (current->is_object()) {
+      std::pmr::string unescaped_key;
+      bool is_unescaped;
+      auto error = unescape_key_(key, is_unescaped, unescaped_key, allocator_);
+      if (error != error_code_t::SUCCESS) {
+        return {nullptr, error};
+      }
+      std::string_view next_key = is_unescaped ? unescaped_key : key;
+      const auto *next = current->get_object()->get(next_key);
+      if (patch != nullptr) {
+        const auto *next_patch = patch->get_object()->get(next_key);
+        if (next_patch == nullptr) {
+          patch = nullptr;
+        } else if (next_patch->is_deleter()) {
+          return {nullptr, error_code_t::NO_SUCH_ELEMENT};
+        } else if (next_patch->is_object() && next != nullptr && next->is_object()) {
+          patch = next_patch;
+        } else {
+          skip_deleters = next_patch->is_object() && next != nullptr;
+          next = next_patch;
+          patch = nullptr;
+        }
+      } else if (skip_deleters) {
+        skip_deleters = false;
+        if (next != nullptr && next->is_deleter()) {
+          next = nullptr;
+        }
+      }
+      current = next;
+    } else if (current->is_array()) {
+      current = current->get_array()->get(static_cast<uint32_t>(atol(key.data())));
+    } else {
+      return {nullptr, error_code_t::NO_SUCH_ELEMENT};
+    }
+    if (current == nullptr) {
+      return {nullptr, error_code_t::NO_SUCH_ELEMENT};
+    }
+  }
+  return {patch == nullptr ? current : nullptr, error_code_t::SUCCESS};
+}
+
 error_code_t document_t::find_container_key(
         std::string_view json_pointer,
         json_trie_node_element *&container,
@@ -536,65 +1068,1270 @@ document_t::ptr document_t::document_from_json(const std::string &json, document
   return res;
 }
 
-document_t::ptr document_t::merge(document_t::ptr &document1, document_t::ptr &document2, document_t::allocator_type *allocator) {
-  auto is_root = false;
-  auto res = new(allocator->allocate(sizeof(document_t))) document_t(allocator, is_root);
-  res->ancestors_.push_back(document1);
-  res->ancestors_.push_back(document2);
-  res->element_ind_ = json_trie_node_element::merge(document1->element_ind_.get(), document2->element_ind_.get(), res->allocator_);
+document_t::ptr document_t::snapshot() {
+  materialize();
+  auto res = new(allocator_->allocate(sizeof(document_t))) document_t(allocator_);
+  res->add_ancestor_({this});
+  res->element_ind_ = element_ind_;
   return res;
 }
 
-template<typename T, typename K>
-bool is_equals_value(const simdjson::dom::element<T> *value1, const simdjson::dom::element<K> *value2) {
-  using simdjson::dom::element_type;
+compaction_stats_t document_t::compaction_stats() const {
+  if (mut_src_ == nullptr) {
+    return {};
+  }
+  materialize_();
+  if (!is_root_) {
+    return ancestors_.front()->compaction_stats();
+  }
+  compaction_stats_t stats{mut_src_->size() * sizeof(uint64_t), mut_src_->string_buf_size(), 0, 0};
+  absl::flat_hash_set<std::size_t> live;
+  absl::flat_hash_set<const json_trie_node_element *> visited;
+  std::size_t live_tape_bytes = 0;
+  std::size_t live_string_bytes = 0;
+  auto count = [&](const json_trie_node_element *leaf) {
+    if (
+            leaf->is_second() &&
+            leaf->get_second()->get_tape_ref().doc == mut_src_ &&
+            live.insert(leaf->get_second()->get_tape_ref().json_index).second
+    ) {
+      auto size = element_size_(*leaf->get_second());
+      live_tape_bytes += size.first;
+      live_string_bytes += size.second;
+    }
+  };
+  for_each_leaf_<const json_trie_node_element>(element_ind_.get(), visited, count);
+  stats.dead_tape_bytes = stats.tape_bytes - live_tape_bytes;
+  stats.dead_string_bytes = stats.string_bytes - live_string_bytes;
+  return stats;
+}
 
-  auto type1 = value1->type();
+// Values on the mutable tape are never overwritten in place, every set appends.
+// Compaction copies the values still reachable from the trie to a fresh tape and
+// points their leaves there. Views share the tape and other documents may share
+// leaves through snapshot or set, so only a root nobody else refers to is compacted.
+bool document_t::compact() {
+  if (!is_root_ || use_count() > 1) {
+    return false;
+  }
+  materialize();
+  simdjson::dom::mutable_document compacted(allocator_);
+  {
+    simdjson::tape_builder<simdjson::dom::tape_writer_to_mutable> builder(allocator_, compacted);
+    absl::flat_hash_map<std::size_t, std::size_t> moved;
+    absl::flat_hash_set<const json_trie_node_element *> visited;
+    auto relocate = [&](json_trie_node_element *leaf) {
+      if (!leaf->is_second() || leaf->get_second()->get_tape_ref().doc != mut_src_) {
+        return;
+      }
+      auto [it, inserted] = moved.try_emplace(leaf->get_second()->get_tape_ref().json_index, compacted.size());
+      if (inserted) {
+        copy_element_(builder, *leaf->get_second());
+      }
+      *leaf->as_second() = mut_src_->get_element(it->second);
+    };
+    for_each_leaf_<json_trie_node_element>(element_ind_.get(), visited, relocate);
+  }
+  *mut_src_ = std::move(compacted);
+  dead_bytes_ = 0;
+  return true;
+}
 
-  if (type1 != value2->type()) {
+void document_t::set_compaction_threshold(double dead_fraction) {
+  compaction_threshold_ = dead_fraction;
+}
+
+void document_t::add_dead_bytes_(const json_trie_node_element *node) {
+  if (node != nullptr && mut_src_ != nullptr) {
+    dead_bytes_ += unreachable_bytes_(node, mut_src_);
+  }
+}
+
+// Dead bytes are only estimated on overwrite and remove, compaction counts exactly.
+void document_t::compact_if_needed_() {
+  if (compaction_threshold_ <= 0 || dead_bytes_ < min_compaction_bytes_) {
+    return;
+  }
+  auto total = mut_src_->size() * sizeof(uint64_t) + mut_src_->string_buf_size();
+  if (static_cast<double>(dead_bytes_) >= compaction_threshold_ * static_cast<double>(total)) {
+    compact();
+  }
+}
+
+// Copies every leaf that lives on a tape of an ancestor to the own mutable tape,
+// after that the ancestors are no longer needed. A view is left alone, it writes
+// through to the document it was taken from.
+bool document_t::consolidate() {
+  if (!is_root_ && mut_src_ != nullptr) {
     return false;
   }
+  materialize();
+  make_mutable_();
+  absl::flat_hash_map<const json_trie_node_element *, boost::intrusive_ptr<json_trie_node_element>> rebuilt;
+  auto relocate = [this](const json_trie_node_element *leaf) -> boost::intrusive_ptr<json_trie_node_element> {
+    auto element = mut_src_->next_element();
+    if (leaf->is_first() && leaf->get_first()->get_tape_ref().doc != immut_src_) {
+      copy_element_(builder_, *leaf->get_first());
+    } else if (leaf->is_second() && leaf->get_second()->get_tape_ref().doc != mut_src_) {
+      copy_element_(builder_, *leaf->get_second());
+    } else {
+      return nullptr;
+    }
+    return json_trie_node_element::create(element, allocator_);
+  };
+  element_ind_ = rebuild_(element_ind_.get(), rebuilt, relocate, allocator_);
+  ++generation_;
+  ancestors_.clear();
+  pinned_bytes_ = 0;
+  pinned_documents_.clear();
+  next_consolidation_check_ = min_consolidation_bytes_;
+  return true;
+}
 
-  switch (type1) {
-    case element_type::INT8:
-      return value1->get_int8().value() == value2->get_int8().value();
-    case element_type::INT16:
-      return value1->get_int16().value() == value2->get_int16().value();
-    case element_type::INT32:
-      return value1->get_int32().value() == value2->get_int32().value();
-    case element_type::INT64:
-      return value1->get_int64().value() == value2->get_int64().value();
-    case element_type::INT128:
-      return value1->get_int128().value() == value2->get_int128().value();
-    case element_type::UINT8:
-      return value1->get_uint8().value() == value2->get_uint8().value();
-    case element_type::UINT16:
-      return value1->get_uint16().value() == value2->get_uint16().value();
-    case element_type::UINT32:
-      return value1->get_uint32().value() == value2->get_uint32().value();
-    case element_type::UINT64:
-      return value1->get_uint64().value() == value2->get_uint64().value();
-    case element_type::FLOAT:
-      return is_equals(value1->get_float().value(), value2->get_float().value());
-    case element_type::DOUBLE:
-      return is_equals(value1->get_double().value(), value2->get_double().value());
-    case element_type::STRING:
-      return value1->get_string().value() == value2->get_string().value();
-    case element_type::BOOL:
-      return value1->get_bool().value() == value2->get_bool().value();
-    case element_type::NULL_VALUE:
-      return true;
+// A merged document has no tape of its own until it writes a value.
+void document_t::make_mutable_() {
+  if (mut_src_ != nullptr) {
+    return;
   }
-  return false;
+  mut_src_ = new(allocator_->allocate(sizeof(simdjson::dom::mutable_document))) simdjson::dom::mutable_document(allocator_);
+  builder_ = simdjson::tape_builder<simdjson::dom::tape_writer_to_mutable>(allocator_, *mut_src_);
+  is_root_ = true;
 }
 
-bool document_t::is_equals_documents(const document_ptr &doc1, const document_ptr &doc2) {
-  return doc1->element_ind_->equals(
-          doc2->element_ind_.get(),
-          &is_equals_value<simdjson::dom::immutable_document, simdjson::dom::immutable_document>,
-          &is_equals_value<simdjson::dom::mutable_document, simdjson::dom::mutable_document>,
-          &is_equals_value<simdjson::dom::immutable_document, simdjson::dom::mutable_document>
-  );
+void document_t::set_consolidation_factor(double factor) {
+  consolidation_factor_ = factor;
+}
+
+// Tape bytes this document and everything it refers to keep alive, except for the
+// documents already visited: ancestors shared along several paths count once.
+std::size_t document_t::footprint_(absl::flat_hash_set<const document_t *> &visited) const {
+  if (!visited.insert(this).second) {
+    return 0;
+  }
+  std::size_t res = 0;
+  if (is_root_) {
+    res += mut_src_->size() * sizeof(uint64_t) + mut_src_->string_buf_size();
+    if (immut_src_ != nullptr) {
+      res += immut_src_->size() * sizeof(uint64_t) + immut_src_->capacity();
+    }
+  }
+  for (const auto &ancestor : ancestors_) {
+    res += ancestor->footprint_(visited);
+  }
+  return res;
+}
+
+void document_t::add_ancestor_(ptr ancestor) {
+  pinned_bytes_ += ancestor->footprint_(pinned_documents_);
+  ancestors_.push_back(std::move(ancestor));
+}
+
+void document_t::consolidate_if_needed_() {
+  if (consolidation_factor_ <= 0 || patch_ind_ != nullptr || (!is_root_ && mut_src_ != nullptr)) {
+    return;
+  }
+  // a check walks the trie, the next one waits until the pinned bytes double
+  if (pinned_bytes_ < next_consolidation_check_) {
+    return;
+  }
+  std::size_t live = 0;
+  absl::flat_hash_set<const json_trie_node_element *> visited;
+  auto count = [&live](const json_trie_node_element *leaf) {
+    auto size = leaf->is_first() ? element_size_(*leaf->get_first()) : element_size_(*leaf->get_second());
+    live += size.first + size.second;
+  };
+  for_each_leaf_<const json_trie_node_element>(element_ind_.get(), visited, count);
+  if (static_cast<double>(pinned_bytes_) > consolidation_factor_ * static_cast<double>(live)) {
+    consolidate();
+  } else {
+    next_consolidation_check_ = 2 * pinned_bytes_;
+  }
+}
+
+// A path hashes its unescaped keys in order. An array is added under a mark of its own
+// path and nothing below it is, an index has many spellings a pointer may use.
+static std::size_t path_hash_(std::size_t parent, std::string_view key) {
+  return hash_combine(parent, hash_bytes(key));
+}
+
+static std::size_t array_mark_(std::size_t path) {
+  return hash_mix(path ^ 0x5bd1e9955bd1e995ULL);
+}
+
+// Blocked Bloom filter, a hash sets 4 bits of a single word.
+static uint64_t path_filter_bits_(std::size_t hash) {
+  return (uint64_t(1) << (hash & 63)) |
+         (uint64_t(1) << ((hash >> 6) & 63)) |
+         (uint64_t(1) << ((hash >> 12) & 63)) |
+         (uint64_t(1) << ((hash >> 18) & 63));
+}
+
+static bool path_filter_test_(const std::pmr::vector<uint64_t> &words, std::size_t hash) {
+  auto bits = path_filter_bits_(hash);
+  return (words[(hash >> 24) & (words.size() - 1)] & bits) == bits;
+}
+
+template<typename Node, typename Function>
+void for_each_filter_path_(const Node *node, std::size_t path, Function &function) {
+  if (node->is_array()) {
+    function(array_mark_(path));
+  } else if (node->is_object()) {
+    for (const auto &it : *node->get_object()) {
+      auto child = path_hash_(path, it.first);
+      function(child);
+      for_each_filter_path_(it.second.get(), child, function);
+    }
+  }
+}
+
+void document_t::build_path_filter(std::size_t bits_per_path) {
+  materialize();
+  if (element_ind_ == nullptr) {
+    return;
+  }
+  std::size_t paths = 0;
+  auto count = [&paths](std::size_t) {
+    ++paths;
+  };
+  for_each_filter_path_(element_ind_.get(), 0, count);
+  std::size_t words = 1;
+  while (words * 64 < paths * bits_per_path) {
+    words *= 2;
+  }
+  path_filter_.assign(words, 0);
+  auto add = [this](std::size_t hash) {
+    path_filter_[(hash >> 24) & (path_filter_.size() - 1)] |= path_filter_bits_(hash);
+  };
+  for_each_filter_path_(element_ind_.get(), 0, add);
+}
+
+// Invalid pointers and paths through arrays pass, the trie reports them.
+bool document_t::may_contain(std::string_view json_pointer) const {
+  if (path_filter_.empty() || json_pointer.empty() || json_pointer[0] != '/') {
+    return true;
+  }
+  json_pointer.remove_prefix(1);
+  std::size_t path = 0;
+  for (auto key: string_splitter(json_pointer, '/')) {
+    if (path_filter_test_(path_filter_, array_mark_(path))) {
+      return true;
+    }
+    std::pmr::string unescaped_key;
+    bool is_unescaped;
+    if (unescape_key_(key, is_unescaped, unescaped_key, allocator_) != error_code_t::SUCCESS) {
+      return true;
+    }
+    path = path_hash_(path, is_unescaped ? unescaped_key : key);
+  }
+  return path_filter_test_(path_filter_, path);
+}
+
+std::size_t document_t::path_filter_bytes() const {
+  return path_filter_.capacity() * sizeof(uint64_t);
+}
+
+void document_t::drop_path_filter_() {
+  if (!path_filter_.empty()) {
+    path_filter_.clear();
+    path_filter_.shrink_to_fit();
+  }
+}
+
+// The copy owns a single mutable tape holding exactly the values reachable from
+// this document, sized up front by a walk over the trie, and no ancestors.
+document_t::ptr document_t::clone_into(allocator_type *allocator) const {
+  materialize_();
+  std::size_t tape_bytes = 0;
+  std::size_t string_bytes = 0;
+  absl::flat_hash_set<const json_trie_node_element *> visited;
+  auto count = [&](const json_trie_node_element *leaf) {
+    auto size = leaf->is_first() ? element_size_(*leaf->get_first()) : element_size_(*leaf->get_second());
+    tape_bytes += size.first;
+    string_bytes += size.second;
+  };
+  for_each_leaf_<const json_trie_node_element>(element_ind_.get(), visited, count);
+
+  ptr res = new(allocator->allocate(sizeof(document_t))) document_t(allocator);
+  res->mut_src_->reserve(tape_bytes / sizeof(uint64_t), string_bytes);
+  absl::flat_hash_map<const json_trie_node_element *, boost::intrusive_ptr<json_trie_node_element>> cloned;
+  auto copy_leaf = [&res, allocator](const json_trie_node_element *leaf) -> boost::intrusive_ptr<json_trie_node_element> {
+    auto element = res->mut_src_->next_element();
+    if (leaf->is_first()) {
+      copy_element_(res->builder_, *leaf->get_first());
+    } else {
+      copy_element_(res->builder_, *leaf->get_second());
+    }
+    return json_trie_node_element::create(element, allocator);
+  };
+  res->element_ind_ = clone_(element_ind_.get(), cloned, copy_leaf, allocator);
+  return res;
+}
+
+// A lazy merge keeps both roots and resolves reads through them, the merged trie is
+// built on the first write or on a read that needs a merged object.
+document_t::ptr document_t::merge(
+        document_t::ptr &document1,
+        document_t::ptr &document2,
+        document_t::allocator_type *allocator,
+        merge_mode_t mode
+) {
+  document1->materialize();
+  document2->materialize();
+  auto is_root = false;
+  auto res = new(allocator->allocate(sizeof(document_t))) document_t(allocator, is_root);
+  res->add_ancestor_(document1);
+  res->add_ancestor_(document2);
+  if (mode == merge_mode_t::LAZY) {
+    res->base_ind_ = document1->element_ind_;
+    res->patch_ind_ = document2->element_ind_;
+    return res;
+  }
+  res->element_ind_ = json_trie_node_element::merge(document1->element_ind_.get(), document2->element_ind_.get(), res->allocator_);
+  res->consolidate_if_needed_();
+  return res;
+}
+
+// Folds the documents in order in a single traversal, allocating only the result.
+document_t::ptr document_t::merge(const std::pmr::vector<ptr> &documents, document_t::allocator_type *allocator) {
+  auto is_root = false;
+  auto res = new(allocator->allocate(sizeof(document_t))) document_t(allocator, is_root);
+  std::pmr::vector<json_trie_node_element *> layers(allocator);
+  layers.reserve(documents.size());
+  for (const auto &document : documents) {
+    document->materialize();
+    res->add_ancestor_(document);
+    layers.push_back(document->element_ind_.get());
+  }
+  json_trie_node_element *base = nullptr;
+  if (!layers.empty()) {
+    base = layers.front();
+    layers.erase(layers.begin());
+  }
+  res->element_ind_ = json_trie_node_element::merge(base, layers, allocator);
+  if (res->element_ind_ == nullptr) {
+    res->element_ind_ = json_trie_node_element::create_object(allocator);
+  }
+  res->consolidate_if_needed_();
+  return res;
+}
+
+template<typename Node>
+static bool is_same_container_(const Node *node1, const Node *node2) {
+  return node1->is_object() == node2->is_object() && node1->is_array() == node2->is_array();
+}
+
+// Writes copy the path from the root off anything sharing it. A view takes its node
+// through the owner, which copies the path to the view off the snapshots, copies and
+// projections of the owner; a view whose path is gone from the owner copies the node.
+document_t::json_trie_node_element *document_t::unique_root_() {
+  if (owner_ == nullptr) {
+    json_trie_node_element::make_unique(element_ind_);
+    ++generation_;
+    return element_ind_.get();
+  }
+  auto *node = owner_->find_node(view_path_).first;
+  if (node == nullptr || !is_same_container_(node, element_ind_.get())) {
+    node = element_ind_->is_shared() ? element_ind_->make_shallow_copy() : element_ind_.get();
+  }
+  rebind_view_(node);
+  view_generation_ = top_owner_()->generation_;
+  return element_ind_.get();
+}
+
+void document_t::replace_root_(boost::intrusive_ptr<json_trie_node_element> &&value) {
+  if (owner_ == nullptr) {
+    element_ind_ = std::move(value);
+    ++generation_;
+    return;
+  }
+  rebind_view_(value.get());
+  if (view_path_.empty()) {
+    owner_->replace_root_(std::move(value));
+  } else {
+    owner_->set_(view_path_, std::move(value));
+  }
+  view_generation_ = top_owner_()->generation_;
+}
+
+// Every write of a view chain goes through the document at its top, a view looks for
+// its node again only after such a write.
+const document_t *document_t::top_owner_() const {
+  const auto *res = this;
+  while (res->owner_ != nullptr) {
+    res = res->owner_.get();
+  }
+  return res;
+}
+
+document_t *document_t::top_owner_() {
+  return const_cast<document_t *>(static_cast<const document_t *>(this)->top_owner_());
+}
+
+// A write through the owner may have put a copy in place of the node of a view, reads
+// follow the node at the path of the view. A view whose path is gone keeps its node.
+void document_t::sync_view_() const {
+  if (owner_ == nullptr || view_generation_ == top_owner_()->generation_) {
+    return;
+  }
+  auto *self = const_cast<document_t *>(this);
+  const auto *node = owner_->find_node_const(view_path_).first;
+  if (node != nullptr && is_same_container_(node, element_ind_.get())) {
+    self->rebind_view_(const_cast<json_trie_node_element *>(node));
+  }
+  self->view_generation_ = top_owner_()->generation_;
+}
+
+void document_t::rebind_view_(json_trie_node_element *node) {
+  if (node == element_ind_.get()) {
+    return;
+  }
+  node->pin();
+  element_ind_->unpin();
+  element_ind_ = node;
+}
+
+void document_t::materialize() {
+  sync_view_();
+  if (patch_ind_ == nullptr) {
+    return;
+  }
+  element_ind_ = json_trie_node_element::merge(base_ind_.get(), patch_ind_.get(), allocator_);
+  ++generation_;
+  base_ind_ = nullptr;
+  patch_ind_ = nullptr;
+}
+
+void document_t::materialize_() const {
+  const_cast<document_t *>(this)->materialize();
+}
+
+template<typename T, typename K>
+bool is_equals_value(const simdjson::dom::element<T> *value1, const simdjson::dom::element<K> *value2) {
+  using simdjson::dom::element_type;
+
+  auto type1 = value1->type();
+
+  if (type1 != value2->type()) {
+    return false;
+  }
+
+  switch (type1) {
+    case element_type::INT8:
+      return value1->get_int8().value() == value2->get_int8().value();
+    case element_type::INT16:
+      return value1->get_int16().value() == value2->get_int16().value();
+    case element_type::INT32:
+      return value1->get_int32().value() == value2->get_int32().value();
+    case element_type::INT64:
+      return value1->get_int64().value() == value2->get_int64().value();
+    case element_type::INT128:
+      return value1->get_int128().value() == value2->get_int128().value();
+    case element_type::UINT8:
+      return value1->get_uint8().value() == value2->get_uint8().value();
+    case element_type::UINT16:
+      return value1->get_uint16().value() == value2->get_uint16().value();
+    case element_type::UINT32:
+      return value1->get_uint32().value() == value2->get_uint32().value();
+    case element_type::UINT64:
+      return value1->get_uint64().value() == value2->get_uint64().value();
+    case element_type::FLOAT:
+      return is_equals(value1->get_float().value(), value2->get_float().value());
+    case element_type::DOUBLE:
+      return is_equals(value1->get_double().value(), value2->get_double().value());
+    case element_type::STRING:
+      return value1->get_string().value() == value2->get_string().value();
+    case element_type::BOOL:
+      return value1->get_bool().value() == value2->get_bool().value();
+    case element_type::NULL_VALUE:
+      return true;
+  }
+  return false;
+}
+
+static bool is_number_type_(simdjson::dom::element_type type) {
+  using simdjson::dom::element_type;
+
+  switch (type) {
+    case element_type::STRING:
+    case element_type::BOOL:
+    case element_type::NULL_VALUE:
+      return false;
+    default:
+      return true;
+  }
+}
+
+// JSON Patch compares numbers by value whatever their storage type, 1 equals 1.0:
+// numbers of different types are equal when their sort keys are.
+template<typename T, typename K>
+bool is_equals_json_value_(const simdjson::dom::element<T> *value1, const simdjson::dom::element<K> *value2) {
+  if (value1->type() == value2->type() || !is_number_type_(value1->type()) || !is_number_type_(value2->type())) {
+    return is_equals_value(value1, value2);
+  }
+  char buffer[128];
+  std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer));
+  std::pmr::string key1(&resource);
+  std::pmr::string key2(&resource);
+  append_sort_key_(key1, *value1);
+  append_sort_key_(key2, *value2);
+  return key1 == key2;
+}
+
+// Same hash for the same value in either storage. Floating point values compare with
+// a tolerance, they are hashed by their bits and reported as inexact.
+template<typename K>
+std::size_t hash_value(const simdjson::dom::element<K> *value, bool &is_inexact) {
+  using components::document::hash_combine;
+  using simdjson::dom::element_type;
+
+  auto type = value->type();
+  std::uint64_t bits = 0;
+  switch (type) {
+    case element_type::INT8:
+      bits = static_cast<std::uint64_t>(static_cast<int64_t>(value->get_int8().value()));
+      break;
+    case element_type::INT16:
+      bits = static_cast<std::uint64_t>(static_cast<int64_t>(value->get_int16().value()));
+      break;
+    case element_type::INT32:
+      bits = static_cast<std::uint64_t>(static_cast<int64_t>(value->get_int32().value()));
+      break;
+    case element_type::INT64:
+      bits = static_cast<std::uint64_t>(static_cast<int64_t>(value->get_int64().value()));
+      break;
+    case element_type::INT128: {
+      auto int128 = static_cast<__uint128_t>(value->get_int128().value());
+      bits = hash_combine(static_cast<std::uint64_t>(int128 >> 64), static_cast<std::uint64_t>(int128));
+      break;
+    }
+    case element_type::UINT8:
+      bits = value->get_uint8().value();
+      break;
+    case element_type::UINT16:
+      bits = value->get_uint16().value();
+      break;
+    case element_type::UINT32:
+      bits = value->get_uint32().value();
+      break;
+    case element_type::UINT64:
+      bits = value->get_uint64().value();
+      break;
+    case element_type::FLOAT: {
+      is_inexact = true;
+      // -0.0 equals 0.0 and hashes as it
+      auto float_value = value->get_float().value();
+      if (std::fpclassify(float_value) != FP_ZERO) {
+        std::uint32_t float_bits;
+        std::memcpy(&float_bits, &float_value, sizeof(float_bits));
+        bits = float_bits;
+      }
+      break;
+    }
+    case element_type::DOUBLE: {
+      is_inexact = true;
+      auto double_value = value->get_double().value();
+      if (std::fpclassify(double_value) != FP_ZERO) {
+        std::memcpy(&bits, &double_value, sizeof(bits));
+      }
+      break;
+    }
+    case element_type::STRING:
+      bits = components::document::hash_bytes(value->get_string().value());
+      break;
+    case element_type::BOOL:
+      bits = value->get_bool().value();
+      break;
+    case element_type::NULL_VALUE:
+      break;
+  }
+  return hash_combine(static_cast<std::size_t>(type), bits);
+}
+
+std::size_t document_t::hash() const {
+  materialize_();
+  return element_ind_->hash(&hash_value<simdjson::dom::immutable_document>, &hash_value<simdjson::dom::mutable_document>);
+}
+
+bool document_t::is_equals_documents(const document_ptr &doc1, const document_ptr &doc2) {
+  doc1->materialize();
+  doc2->materialize();
+  if (doc1->element_ind_ == doc2->element_ind_) {
+    return true;
+  }
+  // Cached along the trie, later calls only rehash the paths written since.
+  doc1->element_ind_->hash(&hash_value<simdjson::dom::immutable_document>, &hash_value<simdjson::dom::mutable_document>);
+  doc2->element_ind_->hash(&hash_value<simdjson::dom::immutable_document>, &hash_value<simdjson::dom::mutable_document>);
+  return doc1->element_ind_->equals(
+          doc2->element_ind_.get(),
+          &is_equals_value<simdjson::dom::immutable_document, simdjson::dom::immutable_document>,
+          &is_equals_value<simdjson::dom::mutable_document, simdjson::dom::mutable_document>,
+          &is_equals_value<simdjson::dom::immutable_document, simdjson::dom::mutable_document>
+  );
+}
+
+// Patch node turning base into target under merge, nullptr when they are equal. Arrays
+// and values are replaced as a whole, objects only carry the changed keys and
+// tombstones for the removed ones. Pointer-identical subtrees are skipped unvisited.
+template<typename Node, typename Equals>
+boost::intrusive_ptr<Node> diff_(
+        const Node *base,
+        const Node *target,
+        Equals &equals,
+        std::pmr::memory_resource *allocator
+) {
+  if (base == target) {
+    return nullptr;
+  }
+  if (!base->is_object() || !target->is_object()) {
+    if (base->is_object() || target->is_object() || !equals(base, target)) {
+      return const_cast<Node *>(target);
+    }
+    return nullptr;
+  }
+  boost::intrusive_ptr<Node> res;
+  auto set = [&res, allocator](std::string_view key, boost::intrusive_ptr<Node> &&value) {
+    if (res == nullptr) {
+      res = Node::create_object(allocator);
+    }
+    res->as_object()->set(key, std::move(value));
+  };
+  for (auto &it : *target->get_object()) {
+    auto base_value = base->get_object()->get(it.first);
+    if (base_value == nullptr) {
+      set(it.first, boost::intrusive_ptr<Node>(it.second));
+    } else if (auto changed = diff_(base_value, it.second.get(), equals, allocator); changed != nullptr) {
+      set(it.first, std::move(changed));
+    }
+  }
+  for (auto &it : *base->get_object()) {
+    if (target->get_object()->get(it.first) == nullptr) {
+      set(it.first, Node::create_deleter(allocator));
+    }
+  }
+  return res;
+}
+
+document_t::ptr document_t::diff(const ptr &base, const ptr &target, document_t::allocator_type *allocator) {
+  base->materialize();
+  target->materialize();
+  auto equals = [](const json_trie_node_element *node1, const json_trie_node_element *node2) {
+    return node1->equals(
+            node2,
+            &is_equals_value<simdjson::dom::immutable_document, simdjson::dom::immutable_document>,
+            &is_equals_value<simdjson::dom::mutable_document, simdjson::dom::mutable_document>,
+            &is_equals_value<simdjson::dom::immutable_document, simdjson::dom::mutable_document>
+    );
+  };
+  ptr res = new(allocator->allocate(sizeof(document_t))) document_t(allocator);
+  res->add_ancestor_(target);
+  auto patch = diff_(base->element_ind_.get(), target->element_ind_.get(), equals, allocator);
+  if (patch != nullptr) {
+    res->element_ind_ = std::move(patch);
+  }
+  return res;
+}
+
+// Adds the value at json_pointer in source to target, target mirrors source with
+// objects allocated by the projection or is source itself.
+template<typename Node>
+void project_(Node *target, const Node *source, std::string_view json_pointer, std::pmr::memory_resource *allocator) {
+  if (json_pointer.empty() || json_pointer[0] != '/' || target == source) {
+    return;
+  }
+  json_pointer.remove_prefix(1);
+  string_splitter keys(json_pointer, '/');
+  for (auto it = keys.begin(); it != keys.end();) {
+    if (!source->is_object()) {
+      return;
+    }
+    bool is_unescaped;
+    std::pmr::string unescaped_key(allocator);
+    if (unescape_key_(*it, is_unescaped, unescaped_key, allocator) != error_code_t::SUCCESS) {
+      return;
+    }
+    auto key = is_unescaped ? std::string_view(unescaped_key) : *it;
+    const auto *child = source->get_object()->get(key);
+    if (child == nullptr) {
+      return;
+    }
+    const auto *target_child = target->get_object()->get(key);
+    if (target_child == child) {
+      return;
+    }
+    if (++it == keys.end() || !child->is_object()) {
+      if (it != keys.end() && !child->is_array()) {
+        return;
+      }
+      target->as_object()->set(key, boost::intrusive_ptr<Node>(const_cast<Node *>(child)));
+      return;
+    }
+    if (target_child == nullptr) {
+      boost::intrusive_ptr<Node> object = Node::create_object(allocator);
+      target_child = object.get();
+      target->as_object()->set(key, std::move(object));
+    }
+    target = const_cast<Node *>(target_child);
+    source = child;
+  }
+}
+
+document_t::ptr document_t::project(
+        const ptr &document,
+        const std::pmr::vector<std::string_view> &json_pointers,
+        document_t::allocator_type *allocator
+) {
+  document->materialize();
+  ptr res = new(allocator->allocate(sizeof(document_t))) document_t(allocator);
+  res->add_ancestor_(document);
+  const auto *source = document->element_ind_.get();
+  for (auto json_pointer : json_pointers) {
+    if (json_pointer.empty() || (!source->is_object() && document->is_exists(json_pointer))) {
+      res->element_ind_ = const_cast<json_trie_node_element *>(source);
+    } else if (source->is_object()) {
+      project_(res->element_ind_.get(), source, json_pointer, allocator);
+    }
+  }
+  return res;
+}
+
+error_code_t document_t::apply_patch(std::string_view json_patch) {
+  boost::json::error_code ec;
+  auto tree = boost::json::parse(json_patch, ec);
+  if (ec) {
+    return error_code_t::INVALID_JSON;
+  }
+  auto array = tree.if_array();
+  if (array == nullptr) {
+    return error_code_t::INVALID_PATCH;
+  }
+  auto get_string = [](const boost::json::object &object, std::string_view key) -> const boost::json::string * {
+    auto found = object.find(key);
+    return found == object.end() ? nullptr : found->value().if_string();
+  };
+  std::pmr::vector<patch_operation_t> operations(allocator_);
+  operations.reserve(array->size());
+  for (const auto &it : *array) {
+    auto object = it.if_object();
+    if (object == nullptr) {
+      return error_code_t::INVALID_PATCH;
+    }
+    auto op = get_string(*object, "op");
+    auto path = get_string(*object, "path");
+    if (op == nullptr || path == nullptr) {
+      return error_code_t::INVALID_PATCH;
+    }
+    patch_operation_t operation{patch_op_t::ADD, *path, {}, nullptr};
+    std::string_view name = *op;
+    if (name == "add") {
+      operation.op = patch_op_t::ADD;
+    } else if (name == "remove") {
+      operation.op = patch_op_t::REMOVE;
+    } else if (name == "replace") {
+      operation.op = patch_op_t::REPLACE;
+    } else if (name == "move") {
+      operation.op = patch_op_t::MOVE;
+    } else if (name == "copy") {
+      operation.op = patch_op_t::COPY;
+    } else if (name == "test") {
+      operation.op = patch_op_t::TEST;
+    } else {
+      return error_code_t::INVALID_PATCH;
+    }
+    if (operation.op == patch_op_t::MOVE || operation.op == patch_op_t::COPY) {
+      auto from = get_string(*object, "from");
+      if (from == nullptr) {
+        return error_code_t::INVALID_PATCH;
+      }
+      operation.from = *from;
+    }
+    if (auto value = object->find("value"); value != object->end()) {
+      operation.value = &value->value();
+    }
+    operations.push_back(operation);
+  }
+  return apply_patch(operations);
+}
+
+// Operations are applied in order, as RFC 6902 requires, but every container an
+// operation resolves stays memoized by its json pointer, so paths sharing a parent
+// walk that parent once per batch. Writes copy the path off the saved root, a
+// failure puts the saved root back. A view writes through the document at the top of
+// its chain and saves that root, and its own node for a path gone from the owner.
+error_code_t document_t::apply_patch(const std::pmr::vector<patch_operation_t> &operations) {
+  materialize();
+  make_mutable_();
+  drop_path_filter_();
+  auto *top = top_owner_();
+  boost::intrusive_ptr<json_trie_node_element> saved = top->element_ind_;
+  boost::intrusive_ptr<json_trie_node_element> saved_view;
+  if (owner_ != nullptr) {
+    saved_view = element_ind_;
+  }
+  auto saved_dead_bytes = dead_bytes_;
+  auto saved_bytes = mut_src_->size() * sizeof(uint64_t) + mut_src_->string_buf_size();
+  patch_containers_t containers;
+  for (const auto &operation : operations) {
+    auto res = apply_operation_(operation, containers);
+    if (res != error_code_t::SUCCESS) {
+      top->replace_root_(std::move(saved));
+      if (owner_ != nullptr) {
+        rebind_view_(saved_view.get());
+      }
+      auto bytes = mut_src_->size() * sizeof(uint64_t) + mut_src_->string_buf_size();
+      dead_bytes_ = saved_dead_bytes + bytes - saved_bytes;
+      return res;
+    }
+  }
+  compact_if_needed_();
+  return error_code_t::SUCCESS;
+}
+
+// Drops the memoized containers below json_pointer, and the one at it if asked to.
+template<typename Containers>
+void erase_patch_containers_(Containers &containers, std::string_view json_pointer, bool is_inclusive) {
+  for (auto it = containers.begin(); it != containers.end();) {
+    std::string_view key = it->first;
+    if (
+            key.substr(0, json_pointer.size()) == json_pointer &&
+            (key.size() == json_pointer.size() ? is_inclusive : key[json_pointer.size()] == '/')
+    ) {
+      containers.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// RFC 6901 array indexes have no leading zeros.
+static bool parse_patch_index_(std::string_view key, uint32_t &index) {
+  if (key.empty() || (key.size() > 1 && key[0] == '0')) {
+    return false;
+  }
+  auto res = std::from_chars(key.data(), key.data() + key.size(), index);
+  return res.ec == std::errc() && res.ptr == key.data() + key.size();
+}
+
+document_t::json_trie_node_element *document_t::find_patch_container_(
+        std::string_view json_pointer,
+        patch_containers_t &containers,
+        error_code_t &error
+) {
+  if (json_pointer.empty()) {
+    return unique_root_();
+  }
+  auto found = containers.find(json_pointer);
+  if (found != containers.end()) {
+    return found->second;
+  }
+  auto pos = json_pointer.find_last_of('/');
+  if (pos == std::string_view::npos) {
+    error = error_code_t::INVALID_JSON_POINTER;
+    return nullptr;
+  }
+  auto parent = find_patch_container_(json_pointer.substr(0, pos), containers, error);
+  if (parent == nullptr) {
+    return nullptr;
+  }
+  auto res = find_child_unique_(parent, json_pointer.substr(pos + 1), error);
+  if (res != nullptr) {
+    containers.emplace(json_pointer, res);
+  }
+  return res;
+}
+
+error_code_t document_t::patch_add_(
+        std::string_view json_pointer,
+        boost::intrusive_ptr<json_trie_node_element> &&value,
+        patch_containers_t &containers,
+        bool is_replace
+) {
+  if (json_pointer.empty()) {
+    if (!value->is_object()) {
+      return error_code_t::INVALID_PATCH;
+    }
+    add_dead_bytes_(element_ind_.get());
+    replace_root_(std::move(value));
+    containers.clear();
+    return error_code_t::SUCCESS;
+  }
+  auto pos = json_pointer.find_last_of('/');
+  if (pos == std::string_view::npos) {
+    return error_code_t::INVALID_JSON_POINTER;
+  }
+  auto container_pointer = json_pointer.substr(0, pos);
+  auto key = json_pointer.substr(pos + 1);
+  auto error = error_code_t::SUCCESS;
+  auto container = find_patch_container_(container_pointer, containers, error);
+  if (container == nullptr) {
+    return error == error_code_t::NO_SUCH_ELEMENT ? error_code_t::NO_SUCH_CONTAINER : error;
+  }
+  if (container->is_object()) {
+    std::pmr::string unescaped_key;
+    bool is_unescaped;
+    error = unescape_key_(key, is_unescaped, unescaped_key, allocator_);
+    if (error != error_code_t::SUCCESS) {
+      return error;
+    }
+    if (is_unescaped) {
+      key = unescaped_key;
+    }
+    auto old = container->get_object()->get(key);
+    if (is_replace && old == nullptr) {
+      return error_code_t::NO_SUCH_ELEMENT;
+    }
+    add_dead_bytes_(old);
+    container->as_object()->set(key, std::move(value));
+    erase_patch_containers_(containers, json_pointer, true);
+    return error_code_t::SUCCESS;
+  }
+  if (container->is_array()) {
+    auto size = container->get_array()->size();
+    uint32_t index = size;
+    if ((is_replace || key != "-") && !parse_patch_index_(key, index)) {
+      return error_code_t::INVALID_INDEX;
+    }
+    if (is_replace) {
+      if (index >= size) {
+        return error_code_t::NO_SUCH_ELEMENT;
+      }
+      add_dead_bytes_(container->get_array()->get(index));
+      container->as_array()->set(index, std::move(value));
+      erase_patch_containers_(containers, json_pointer, true);
+      return error_code_t::SUCCESS;
+    }
+    if (index > size) {
+      return error_code_t::INVALID_INDEX;
+    }
+    container->as_array()->insert(index, std::move(value));
+    erase_patch_containers_(containers, container_pointer, false);
+    return error_code_t::SUCCESS;
+  }
+  return error_code_t::NO_SUCH_CONTAINER;
+}
+
+error_code_t document_t::patch_remove_(
+        std::string_view json_pointer,
+        boost::intrusive_ptr<json_trie_node_element> &node,
+        patch_containers_t &containers
+) {
+  auto pos = json_pointer.find_last_of('/');
+  if (pos == std::string_view::npos) {
+    return error_code_t::INVALID_JSON_POINTER;
+  }
+  auto container_pointer = json_pointer.substr(0, pos);
+  auto key = json_pointer.substr(pos + 1);
+  auto error = error_code_t::SUCCESS;
+  auto container = find_patch_container_(container_pointer, containers, error);
+  if (container == nullptr) {
+    return error == error_code_t::NO_SUCH_ELEMENT ? error_code_t::NO_SUCH_CONTAINER : error;
+  }
+  if (container->is_object()) {
+    std::pmr::string unescaped_key;
+    bool is_unescaped;
+    error = unescape_key_(key, is_unescaped, unescaped_key, allocator_);
+    if (error != error_code_t::SUCCESS) {
+      return error;
+    }
+    node = container->as_object()->remove(is_unescaped ? unescaped_key : key);
+    erase_patch_containers_(containers, json_pointer, true);
+  } else if (container->is_array()) {
+    uint32_t index;
+    if (!parse_patch_index_(key, index)) {
+      return error_code_t::INVALID_INDEX;
+    }
+    node = container->as_array()->remove(index);
+    erase_patch_containers_(containers, container_pointer, false);
+  } else {
+    return error_code_t::NO_SUCH_CONTAINER;
+  }
+  return node == nullptr ? error_code_t::NO_SUCH_ELEMENT : error_code_t::SUCCESS;
+}
+
+error_code_t document_t::apply_operation_(const patch_operation_t &operation, patch_containers_t &containers) {
+  const auto &path = operation.path;
+  const auto &from = operation.from;
+  switch (operation.op) {
+    case patch_op_t::ADD:
+    case patch_op_t::REPLACE:
+      if (operation.value == nullptr) {
+        return error_code_t::INVALID_PATCH;
+      }
+      return patch_add_(path, build_mutable_(*operation.value), containers, operation.op == patch_op_t::REPLACE);
+    case patch_op_t::REMOVE: {
+      boost::intrusive_ptr<json_trie_node_element> node;
+      auto res = patch_remove_(path, node, containers);
+      add_dead_bytes_(node.get());
+      return res;
+    }
+    case patch_op_t::MOVE: {
+      if (path.size() > from.size() && path.substr(0, from.size()) == from && path[from.size()] == '/') {
+        return error_code_t::INVALID_PATCH;
+      }
+      boost::intrusive_ptr<json_trie_node_element> node;
+      auto res = patch_remove_(from, node, containers);
+      if (res != error_code_t::SUCCESS) {
+        return res;
+      }
+      return patch_add_(path, std::move(node), containers, false);
+    }
+    case patch_op_t::COPY: {
+      auto error = error_code_t::SUCCESS;
+      auto found = find_patch_container_(from, containers, error);
+      if (found == nullptr) {
+        return error;
+      }
+      // the subtree is shared, except when it is copied into itself
+      boost::intrusive_ptr<json_trie_node_element> node(found);
+      if (path.substr(0, from.size()) == from) {
+        node = found->make_shallow_copy();
+      }
+      erase_patch_containers_(containers, from, true);
+      return patch_add_(path, std::move(node), containers, false);
+    }
+    case patch_op_t::TEST: {
+      if (operation.value == nullptr) {
+        return error_code_t::INVALID_PATCH;
+      }
+      auto found = find_node_const(path).first;
+      if (found == nullptr) {
+        return error_code_t::TEST_FAILED;
+      }
+      boost::intrusive_ptr<json_trie_node_element> expected(build_mutable_(*operation.value));
+      add_dead_bytes_(expected.get());
+      auto is_equals = found->equals(
+              expected.get(),
+              &is_equals_json_value_<simdjson::dom::immutable_document, simdjson::dom::immutable_document>,
+              &is_equals_json_value_<simdjson::dom::mutable_document, simdjson::dom::mutable_document>,
+              &is_equals_json_value_<simdjson::dom::immutable_document, simdjson::dom::mutable_document>
+      );
+      return is_equals ? error_code_t::SUCCESS : error_code_t::TEST_FAILED;
+    }
+  }
+  return error_code_t::INVALID_PATCH;
+}
+
+document_t::json_trie_node_element *document_t::build_mutable_(const boost::json::value &value) {
+  json_trie_node_element *res;
+  if (value.is_object()) {
+    res = json_trie_node_element::create_object(allocator_);
+    for (auto const &[key, val] : value.get_object()) {
+      res->as_object()->set(key, build_mutable_(val));
+    }
+  } else if (value.is_array()) {
+    res = json_trie_node_element::create_array(allocator_);
+    const auto &array = value.get_array();
+    res->as_array()->reserve(static_cast<uint32_t>(array.size()));
+    uint32_t i = 0;
+    for (const auto &it : array) {
+      res->as_array()->set(i++, build_mutable_(it));
+    }
+  } else {
+    auto element = mut_src_->next_element();
+    build_primitive(builder_, value);
+    res = json_trie_node_element::create(element, allocator_);
+  }
+  return res;
+}
+
+// SAX handler of apply_merge_patch. Objects of the patch are merged into the
+// objects of the document, a null removes the key. Anything else replaces the
+// target, containers are attached as soon as they begin and filled in place,
+// nulls inside them are kept as values.
+class document_t::merge_patch_handler_ {
+public:
+  constexpr static std::size_t max_object_size = std::size_t(-1);
+  constexpr static std::size_t max_array_size = std::size_t(-1);
+  constexpr static std::size_t max_key_size = std::size_t(-1);
+  constexpr static std::size_t max_string_size = std::size_t(-1);
+
+  error_code_t error = error_code_t::INVALID_JSON;
+
+  explicit merge_patch_handler_(document_t *document)
+          : document_(document),
+            frames_(document->allocator_),
+            key_(document->allocator_),
+            string_(document->allocator_) {}
+
+  bool on_document_begin(boost::json::error_code &) { return true; }
+
+  bool on_document_end(boost::json::error_code &) { return true; }
+
+  bool on_object_begin(boost::json::error_code &) {
+    if (frames_.empty()) {
+      frames_.push_back({document_->unique_root_(), true});
+      return true;
+    }
+    auto &top = frames_.back();
+    if (top.is_merge) {
+      auto target = top.node->as_object()->get_unique(key_);
+      if (target != nullptr && target->is_object()) {
+        frames_.push_back({target, true});
+        return true;
+      }
+    }
+    auto node = json_trie_node_element::create_object(document_->allocator_);
+    put_(node);
+    frames_.push_back({node, top.is_merge});
+    return true;
+  }
+
+  bool on_object_end(std::size_t, boost::json::error_code &) {
+    frames_.pop_back();
+    return true;
+  }
+
+  bool on_array_begin(boost::json::error_code &ec) {
+    if (frames_.empty()) {
+      return fail_(ec);
+    }
+    auto node = json_trie_node_element::create_array(document_->allocator_);
+    put_(node);
+    frames_.push_back({node, false});
+    return true;
+  }
+
+  bool on_array_end(std::size_t, boost::json::error_code &) {
+    frames_.pop_back();
+    return true;
+  }
+
+  bool on_key_part(boost::json::string_view part, std::size_t, boost::json::error_code &) {
+    append_key_(part);
+    return true;
+  }
+
+  bool on_key(boost::json::string_view part, std::size_t, boost::json::error_code &) {
+    append_key_(part);
+    is_key_complete_ = true;
+    return true;
+  }
+
+  bool on_string_part(boost::json::string_view part, std::size_t, boost::json::error_code &) {
+    string_.append(part.data(), part.size());
+    return true;
+  }
+
+  bool on_string(boost::json::string_view part, std::size_t, boost::json::error_code &ec) {
+    string_.append(part.data(), part.size());
+    auto res = put_value_(std::string_view(string_), ec);
+    string_.clear();
+    return res;
+  }
+
+  bool on_number_part(boost::json::string_view, boost::json::error_code &) { return true; }
+
+  bool on_int64(std::int64_t value, boost::json::string_view, boost::json::error_code &ec) {
+    return put_value_(value, ec);
+  }
+
+  bool on_uint64(std::uint64_t value, boost::json::string_view, boost::json::error_code &ec) {
+    return put_value_(value, ec);
+  }
+
+  bool on_double(double value, boost::json::string_view, boost::json::error_code &ec) {
+    return put_value_(value, ec);
+  }
+
+  bool on_bool(bool value, boost::json::error_code &ec) {
+    return put_value_(value, ec);
+  }
+
+  bool on_null(boost::json::error_code &ec) {
+    if (frames_.empty()) {
+      return fail_(ec);
+    }
+    auto &top = frames_.back();
+    if (top.is_merge) {
+      auto removed = top.node->as_object()->remove(key_);
+      document_->add_dead_bytes_(removed.get());
+      return true;
+    }
+    auto element = document_->mut_src_->next_element();
+    document_->builder_.visit_null_atom();
+    put_(json_trie_node_element::create(element, document_->allocator_));
+    return true;
+  }
+
+  bool on_comment_part(boost::json::string_view, boost::json::error_code &) { return true; }
+
+  bool on_comment(boost::json::string_view, boost::json::error_code &) { return true; }
+
+private:
+  struct frame_t {
+    json_trie_node_element *node;
+    bool is_merge;
+  };
+
+  document_t *document_;
+  std::pmr::vector<frame_t> frames_;
+  std::pmr::string key_;
+  std::pmr::string string_;
+  bool is_key_complete_ = false;
+
+  // only an object can be merged into the document
+  bool fail_(boost::json::error_code &ec) {
+    error = error_code_t::INVALID_PATCH;
+    ec = boost::system::errc::make_error_code(boost::system::errc::invalid_argument);
+    return false;
+  }
+
+  void append_key_(boost::json::string_view part) {
+    if (is_key_complete_) {
+      key_.clear();
+      is_key_complete_ = false;
+    }
+    key_.append(part.data(), part.size());
+  }
+
+  template<typename T>
+  bool put_value_(T value, boost::json::error_code &ec) {
+    if (frames_.empty()) {
+      return fail_(ec);
+    }
+    auto element = document_->mut_src_->next_element();
+    document_->builder_.build(value);
+    put_(json_trie_node_element::create(element, document_->allocator_));
+    return true;
+  }
+
+  void put_(json_trie_node_element *node) {
+    auto container = frames_.back().node;
+    if (container->is_array()) {
+      container->as_array()->set(container->get_array()->size(), node);
+      return;
+    }
+    document_->add_dead_bytes_(container->get_object()->get(key_));
+    container->as_object()->set(key_, node);
+  }
+};
+
+error_code_t document_t::apply_merge_patch(std::string_view json_merge_patch) {
+  materialize();
+  make_mutable_();
+  drop_path_filter_();
+  // saved as in apply_patch
+  auto *top = top_owner_();
+  boost::intrusive_ptr<json_trie_node_element> saved = top->element_ind_;
+  boost::intrusive_ptr<json_trie_node_element> saved_view;
+  if (owner_ != nullptr) {
+    saved_view = element_ind_;
+  }
+  auto saved_dead_bytes = dead_bytes_;
+  auto saved_bytes = mut_src_->size() * sizeof(uint64_t) + mut_src_->string_buf_size();
+  boost::json::basic_parser<merge_patch_handler_> parser(boost::json::parse_options{}, this);
+  boost::json::error_code ec;
+  parser.write_some(false, json_merge_patch.data(), json_merge_patch.size(), ec);
+  if (ec || !parser.done()) {
+    top->replace_root_(std::move(saved));
+    if (owner_ != nullptr) {
+      rebind_view_(saved_view.get());
+    }
+    auto bytes = mut_src_->size() * sizeof(uint64_t) + mut_src_->string_buf_size();
+    dead_bytes_ = saved_dead_bytes + bytes - saved_bytes;
+    return parser.handler().error;
+  }
+  compact_if_needed_();
+  return error_code_t::SUCCESS;
 }
 
 document_t::allocator_type *document_t::get_allocator() {
@@ -649,6 +2386,7 @@ std::pmr::string value_to_string(const simdjson::dom::element<T> *value, std::pm
 }
 
 std::pmr::string document_t::to_json() const {
+  materialize_();
   return element_ind_->to_json(&value_to_string<simdjson::dom::immutable_document>, &value_to_string<simdjson::dom::mutable_document>);
 }
 
@@ -10,6 +10,8 @@
 #include <simdjson/tape_builder.h>
 #include <allocator_intrusive_ref_counter.hpp>
 #include <boost/json/value.hpp>
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 
 namespace components::document {
 
@@ -21,14 +23,69 @@ enum class error_code_t {
   NO_SUCH_ELEMENT,
   INVALID_INDEX,
   INVALID_JSON_POINTER,
+  INVALID_JSON,
+  INVALID_PATCH,
+  TEST_FAILED,
 };
 
+struct compaction_stats_t {
+  std::size_t tape_bytes;
+  std::size_t string_bytes;
+  std::size_t dead_tape_bytes;
+  std::size_t dead_string_bytes;
+};
+
+enum class merge_mode_t {
+  EAGER,
+  LAZY,
+};
+
+enum class patch_op_t {
+  ADD,
+  REMOVE,
+  REPLACE,
+  MOVE,
+  COPY,
+  TEST,
+};
+
+// RFC 6902 operation, the strings and the value are not owned.
+struct patch_operation_t {
+  patch_op_t op;
+  std::string_view path;
+  std::string_view from;
+  const boost::json::value *value;
+};
+
+// Leading byte of a sort key, see document_t::sort_key.
+enum class sort_key_tag_t : unsigned char {
+  NULL_VALUE = 0x01,
+  FALSE_VALUE = 0x02,
+  TRUE_VALUE = 0x03,
+  NUMBER = 0x10,
+  STRING = 0x20,
+  ARRAY = 0x30,
+  OBJECT = 0x40,
+  MISSING = 0xff,
+};
+
+// The key document_t::append_sort_key appends for a document holding value.
+void append_sort_key(const boost::json::value &value, std::pmr::string &key);
+
+struct column_reader_t;
+
 enum class special_type {
   OBJECT,
   ARRAY,
   DELETER,
 };
 
+// Const readers are not thread-safe on every document: a lazy merge is materialized
+// by the first read that needs a merged object, the first read of a view after a
+// write to its owner follows the node at its path again, hash() caches hashes in the
+// trie. Concurrent readers of such a document need outside synchronization; after
+// materialize(), a document, views included, can be read concurrently except through
+// hash() until the next write.
 class document_t final : public allocator_intrusive_ref_counter<document_t> {
 public:
   using ptr = boost::intrusive_ptr<document_t>;
@@ -77,6 +134,15 @@ public:
 
   error_code_t copy(std::string_view json_pointer_from, std::string_view json_pointer_to);
 
+  // RFC 6902 JSON Patch. All operations or none are applied, on a view too.
+  error_code_t apply_patch(std::string_view json_patch);
+
+  error_code_t apply_patch(const std::pmr::vector<patch_operation_t> &operations);
+
+  // RFC 7386 JSON Merge Patch, applied while the text is parsed. Same atomicity
+  // as apply_patch.
+  error_code_t apply_merge_patch(std::string_view json_merge_patch);
+
 //  document_id_t id() const;
 
   bool is_valid() const;
@@ -143,6 +209,9 @@ public:
 
   std::pmr::string get_string(std::string_view json_pointer) const;
 
+  // Views of the container at json_pointer. A view reads and writes the container
+  // at that path in this document; snapshots and copies taken from this document
+  // do not see the writes of its views.
   ptr get_array(std::string_view json_pointer);
 
   ptr get_dict(std::string_view json_pointer);
@@ -182,6 +251,14 @@ public:
 
   compare_t compare(const document_t &other, std::string_view json_pointer) const;
 
+  // Order-preserving encoding of the value at json_pointer: byte-wise comparison of
+  // two keys orders the values, numbers of any width and storage compare by value.
+  // A type tag comes first, null < bool < number < string < array < object <
+  // missing; objects are not ordered among themselves.
+  std::pmr::string sort_key(std::string_view json_pointer) const;
+
+  void append_sort_key(std::string_view json_pointer, std::pmr::string &key) const;
+
   std::pmr::string to_json() const;
 
 //  ::document::retained_t<::document::impl::dict_t> to_dict() const;
@@ -206,30 +283,104 @@ public:
 //
 //  explicit operator bool() const;
 
+  ptr snapshot();
+
+  // Builds the merged trie of a lazy merge.
+  void materialize();
+
+  ptr clone_into(allocator_type *allocator) const;
+
+  compaction_stats_t compaction_stats() const;
+
+  bool compact();
+
+  void set_compaction_threshold(double dead_fraction);
+
+  bool consolidate();
+
+  void set_consolidation_factor(double factor);
+
+  // Opt-in Bloom filter over the json pointers of the document: reads of a pointer it
+  // rules out return without walking the trie. Paths below arrays are not filtered.
+  // Writes drop the filter, it is meant to be built once the document is loaded.
+  void build_path_filter(std::size_t bits_per_path = 10);
+
+  // false only if the document has no value at json_pointer
+  bool may_contain(std::string_view json_pointer) const;
+
+  // 0 without a path filter
+  std::size_t path_filter_bytes() const;
+
   static ptr document_from_json(const std::string &json, document_t::allocator_type *allocator);
 
-  static ptr merge(ptr &document1, ptr &document2, document_t::allocator_type *allocator);
+  static ptr merge(
+          ptr &document1,
+          ptr &document2,
+          document_t::allocator_type *allocator,
+          merge_mode_t mode = merge_mode_t::EAGER
+  );
+
+  static ptr merge(const std::pmr::vector<ptr> &documents, document_t::allocator_type *allocator);
+
+  // Canonical content hash: independent of key order and of the storage of the
+  // values, computed from the trie without serializing. Not thread-safe: hashes are
+  // cached in the trie and a lazy merge is materialized, so concurrent calls on one
+  // document, or on documents sharing subtrees, need outside synchronization.
+  std::size_t hash() const;
 
   static bool is_equals_documents(const ptr &doc1, const ptr &doc2);
 
+  static ptr diff(const ptr &base, const ptr &target, document_t::allocator_type *allocator);
+
+  // Document holding the values at json_pointers without copying them: subtrees are
+  // shared with document, only the objects along the paths are allocated. A path going
+  // through an array takes the whole array, missing paths are skipped.
+  static ptr project(
+          const ptr &document,
+          const std::pmr::vector<std::string_view> &json_pointers,
+          document_t::allocator_type *allocator
+  );
+
 protected:
   allocator_type *get_allocator() override;
 
 private:
+  friend struct column_reader_t;
+
   using element_from_immutable = simdjson::dom::element<simdjson::dom::immutable_document>;
   using element_from_mutable = simdjson::dom::element<simdjson::dom::mutable_document>;
   using json_trie_node_element = json_trie_node<element_from_immutable, element_from_mutable>;
   using inserter_ptr = json_trie_node_element *(*)(allocator_type *);
 
-  document_t(ptr ancestor, allocator_type *allocator, json_trie_node_element *index);
+  document_t(ptr owner, allocator_type *allocator, json_trie_node_element *index, std::string_view json_pointer);
 
   allocator_type *allocator_;
   simdjson::dom::immutable_document *immut_src_;
   simdjson::dom::mutable_document *mut_src_;
   simdjson::tape_builder<simdjson::dom::tape_writer_to_mutable> builder_{};
   boost::intrusive_ptr<json_trie_node_element> element_ind_;
+  boost::intrusive_ptr<json_trie_node_element> base_ind_;
+  boost::intrusive_ptr<json_trie_node_element> patch_ind_;
   std::pmr::vector<ptr> ancestors_{};
+  // the document a view was taken from and the path of the view in it
+  ptr owner_{};
+  std::pmr::string view_path_{};
+  // changes with each write that may move nodes, views of this document compare it
+  // with the one they last followed their path at
+  uint64_t generation_{0};
+  uint64_t view_generation_{0};
   bool is_root_;
+  std::size_t dead_bytes_{0};
+  double compaction_threshold_{0.5};
+  double consolidation_factor_{4.0};
+  // tape bytes of the ancestors, each document counted once as it was when added
+  std::size_t pinned_bytes_{0};
+  absl::flat_hash_set<const document_t *> pinned_documents_{};
+  std::size_t next_consolidation_check_{min_consolidation_bytes_};
+  std::pmr::vector<uint64_t> path_filter_{};
+
+  constexpr static std::size_t min_compaction_bytes_ = 4096;
+  constexpr static std::size_t min_consolidation_bytes_ = 1 << 16;
 
   constexpr static inserter_ptr creators[] {
           json_trie_node_element::create_object,
@@ -245,10 +396,72 @@ private:
 
   error_code_t remove_(std::string_view json_pointer, boost::intrusive_ptr<json_trie_node_element> &node);
 
+  void add_dead_bytes_(const json_trie_node_element *node);
+
+  void compact_if_needed_();
+
+  std::size_t footprint_(absl::flat_hash_set<const document_t *> &visited) const;
+
+  void add_ancestor_(ptr ancestor);
+
+  void consolidate_if_needed_();
+
+  void make_mutable_();
+
+  void drop_path_filter_();
+
+  // The root, made private to this document before a write.
+  json_trie_node_element *unique_root_();
+
+  void replace_root_(boost::intrusive_ptr<json_trie_node_element> &&value);
+
+  const document_t *top_owner_() const;
+
+  document_t *top_owner_();
+
+  void sync_view_() const;
+
+  void rebind_view_(json_trie_node_element *node);
+
+  using patch_containers_t = absl::flat_hash_map<std::string_view, json_trie_node_element *>;
+
+  class merge_patch_handler_;
+
   std::pair<json_trie_node_element *, error_code_t> find_node(std::string_view json_pointer);
 
+  json_trie_node_element *find_child_unique_(json_trie_node_element *node, std::string_view key, error_code_t &error);
+
+  json_trie_node_element *find_patch_container_(
+          std::string_view json_pointer,
+          patch_containers_t &containers,
+          error_code_t &error
+  );
+
+  error_code_t apply_operation_(const patch_operation_t &operation, patch_containers_t &containers);
+
+  error_code_t patch_add_(
+          std::string_view json_pointer,
+          boost::intrusive_ptr<json_trie_node_element> &&value,
+          patch_containers_t &containers,
+          bool is_replace
+  );
+
+  error_code_t patch_remove_(
+          std::string_view json_pointer,
+          boost::intrusive_ptr<json_trie_node_element> &node,
+          patch_containers_t &containers
+  );
+
+  json_trie_node_element *build_mutable_(const boost::json::value &value);
+
   std::pair<const json_trie_node_element *, error_code_t> find_node_const(std::string_view json_pointer) const;
 
+  std::pair<const json_trie_node_element *, error_code_t> find_overlay_node_(std::string_view json_pointer) const;
+
+  void materialize_() const;
+
+  static void append_node_sort_key_(const json_trie_node_element *node, std::pmr::string &key);
+
   error_code_t find_container_key(
           std::string_view json_pointer,
           json_trie_node_element *&container,
@@ -305,9 +518,12 @@ inline error_code_t document_t::set(std::string_view json_pointer, special_type
 
 template<>
 inline error_code_t document_t::set(std::string_view json_pointer, document_ptr value) {
-  ancestors_.push_back(value);
+  value->materialize();
+  add_ancestor_(value);
   auto copy = value->element_ind_;
-  return set_(json_pointer, std::move(copy));
+  auto res = set_(json_pointer, std::move(copy));
+  consolidate_if_needed_();
+  return res;
 }
 //
 //template<class T>
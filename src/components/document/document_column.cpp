@@ -0,0 +1,416 @@
+#include "document_column.hpp"
+#include <components/document/string_splitter.hpp>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace components::document {
+
+bool split_json_pointer(std::string_view json_pointer, std::pmr::vector<path_segment_t> &segments) {
+  if (json_pointer.empty()) {
+    return true;
+  }
+  if (json_pointer[0] != '/') {
+    return false;
+  }
+  auto *allocator = segments.get_allocator().resource();
+  json_pointer.remove_prefix(1);
+  for (auto key : string_splitter(json_pointer, '/')) {
+    bool is_unescaped;
+    std::pmr::string unescaped_key(allocator);
+    if (unescape_key_(key, is_unescaped, unescaped_key, allocator) != error_code_t::SUCCESS) {
+      return false;
+    }
+    long index = 0;
+    std::from_chars(key.data(), key.data() + key.size(), index);
+    segments.push_back({
+            std::pmr::string(is_unescaped ? std::string_view(unescaped_key) : key, allocator),
+            static_cast<uint32_t>(index)
+    });
+  }
+  return true;
+}
+
+selection_t::selection_t(allocator_type *allocator)
+        : size_(0),
+          words_(allocator) {}
+
+void selection_t::reset(std::size_t size) {
+  size_ = size;
+  words_.assign((size + 63) / 64, 0);
+}
+
+std::size_t selection_t::size() const {
+  return size_;
+}
+
+std::size_t selection_t::count() const {
+  std::size_t res = 0;
+  for (auto word : words_) {
+    res += static_cast<std::size_t>(__builtin_popcountll(word));
+  }
+  return res;
+}
+
+bool selection_t::test(std::size_t index) const {
+  return (words_[index / 64] >> (index % 64)) & 1;
+}
+
+void selection_t::set(std::size_t index) {
+  words_[index / 64] |= uint64_t(1) << (index % 64);
+}
+
+void selection_t::flip() {
+  for (auto &word : words_) {
+    word = ~word;
+  }
+  if (size_ % 64 != 0) {
+    words_.back() &= (uint64_t(1) << (size_ % 64)) - 1;
+  }
+}
+
+selection_t &selection_t::operator&=(const selection_t &other) {
+  for (std::size_t i = 0; i < words_.size(); ++i) {
+    words_[i] &= other.words_[i];
+  }
+  return *this;
+}
+
+selection_t &selection_t::operator|=(const selection_t &other) {
+  for (std::size_t i = 0; i < words_.size(); ++i) {
+    words_[i] |= other.words_[i];
+  }
+  return *this;
+}
+
+uint64_t *selection_t::words() {
+  return words_.data();
+}
+
+const uint64_t *selection_t::words() const {
+  return words_.data();
+}
+
+namespace {
+
+// For an other value no document value is compared with: the result depends only on
+// whether the document is valid and has a value at json_pointer.
+void select_fixed(
+        const std::pmr::vector<document_ptr> &documents,
+        std::string_view json_pointer,
+        compare_t if_exists,
+        compare_t if_missing,
+        compare_t if_invalid,
+        compare_op_t op,
+        selection_t &selection
+) {
+  selection.reset(documents.size());
+  for (std::size_t i = 0; i < documents.size(); ++i) {
+    const auto &document = *documents[i];
+    auto res = if_invalid;
+    if (document.is_valid()) {
+      res = document.is_exists(json_pointer) ? if_exists : if_missing;
+    }
+    if (is_accepted(op, res)) {
+      selection.set(i);
+    }
+  }
+}
+
+// compare() orders values of the same element type only, everything else is equal. Rows
+// of that type are gathered into a column for the kernel, the others are fixed.
+template<typename T, typename Element>
+void select_typed(
+        const std::pmr::vector<document_ptr> &documents,
+        std::string_view json_pointer,
+        const Element &other_element,
+        compare_op_t op,
+        selection_t &selection
+) {
+  auto allocator = documents.get_allocator().resource();
+  auto size = documents.size();
+  auto type = other_element.type();
+  auto is_equals_accepted = is_accepted(op, compare_t::equals);
+  auto is_more_accepted = is_accepted(op, compare_t::more);
+
+  document_column_t<T> column(allocator);
+  column.values.assign(size, column_storage_t<T>());
+  column.valid.reset(size);
+  selection_t fixed(allocator);
+  fixed.reset(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    const auto &document = *documents[i];
+    if (!document.is_valid()) {
+      if (is_more_accepted) {
+        fixed.set(i);
+      }
+      continue;
+    }
+    bool is_exists;
+    bool is_same_type = false;
+    column_reader_t::visit(document, json_pointer, is_exists, [&](const auto &element) {
+      if (element.type() == type) {
+        is_same_type = true;
+        column.values[i] = element.template get<T>().value();
+      }
+    });
+    if (is_same_type) {
+      column.valid.set(i);
+    } else if (is_exists ? is_equals_accepted : is_more_accepted) {
+      fixed.set(i);
+    }
+  }
+  select(column, op, other_element.template get<T>().value(), selection);
+  selection |= fixed;
+}
+
+} // namespace
+
+void select_compare(
+        const std::pmr::vector<document_ptr> &documents,
+        const document_t &other,
+        std::string_view json_pointer,
+        compare_op_t op,
+        selection_t &selection
+) {
+  using simdjson::dom::element_type;
+
+  if (!other.is_valid()) {
+    return select_fixed(documents, json_pointer, compare_t::less, compare_t::less, compare_t::equals, op, selection);
+  }
+  bool is_exists;
+  bool is_selected = true;
+  auto is_primitive = column_reader_t::visit(other, json_pointer, is_exists, [&](const auto &element) {
+    switch (element.type()) {
+      case element_type::INT8:
+        return select_typed<int8_t>(documents, json_pointer, element, op, selection);
+      case element_type::INT16:
+        return select_typed<int16_t>(documents, json_pointer, element, op, selection);
+      case element_type::INT32:
+        return select_typed<int32_t>(documents, json_pointer, element, op, selection);
+      case element_type::INT64:
+        return select_typed<int64_t>(documents, json_pointer, element, op, selection);
+      case element_type::INT128:
+        return select_typed<__int128_t>(documents, json_pointer, element, op, selection);
+      case element_type::UINT8:
+        return select_typed<uint8_t>(documents, json_pointer, element, op, selection);
+      case element_type::UINT16:
+        return select_typed<uint16_t>(documents, json_pointer, element, op, selection);
+      case element_type::UINT32:
+        return select_typed<uint32_t>(documents, json_pointer, element, op, selection);
+      case element_type::UINT64:
+        return select_typed<uint64_t>(documents, json_pointer, element, op, selection);
+      case element_type::FLOAT:
+        return select_typed<float>(documents, json_pointer, element, op, selection);
+      case element_type::DOUBLE:
+        return select_typed<double>(documents, json_pointer, element, op, selection);
+      case element_type::STRING:
+        return select_typed<std::string_view>(documents, json_pointer, element, op, selection);
+      case element_type::BOOL:
+        return select_typed<bool>(documents, json_pointer, element, op, selection);
+      case element_type::NULL_VALUE:
+        is_selected = false;
+        return;
+    }
+  });
+  if (!is_primitive || !is_selected) {
+    // a null or a container is equal to any existing value
+    select_fixed(
+            documents,
+            json_pointer,
+            is_exists ? compare_t::equals : compare_t::less,
+            is_exists ? compare_t::more : compare_t::equals,
+            compare_t::more,
+            op,
+            selection
+    );
+  }
+}
+
+double aggregate_t::sum() const {
+  return static_cast<double>(integer_sum) + float_sum;
+}
+
+double aggregate_t::avg() const {
+  return count == 0 ? std::numeric_limits<double>::quiet_NaN() : sum() / static_cast<double>(count);
+}
+
+void aggregate_state_t::add_integer(__int128_t value) {
+  ++count;
+  integer_sum += value;
+  integer_min = std::min(integer_min, value);
+  integer_max = std::max(integer_max, value);
+}
+
+void aggregate_state_t::add_double(double value) {
+  ++count;
+  float_sum += value;
+  float_min = std::min(float_min, value);
+  float_max = std::max(float_max, value);
+}
+
+void aggregate_state_t::merge(const aggregate_state_t &other) {
+  count += other.count;
+  integer_sum += other.integer_sum;
+  integer_min = std::min(integer_min, other.integer_min);
+  integer_max = std::max(integer_max, other.integer_max);
+  float_sum += other.float_sum;
+  float_min = std::min(float_min, other.float_min);
+  float_max = std::max(float_max, other.float_max);
+}
+
+aggregate_t aggregate_state_t::result() const {
+  aggregate_t res{count, integer_sum, float_sum, 0, 0};
+  if (count == 0) {
+    res.min = res.max = std::numeric_limits<double>::quiet_NaN();
+  } else {
+    res.min = float_min;
+    res.max = float_max;
+    if (integer_min <= integer_max) {
+      res.min = std::min(res.min, static_cast<double>(integer_min));
+      res.max = std::max(res.max, static_cast<double>(integer_max));
+    }
+  }
+  return res;
+}
+
+namespace {
+
+constexpr std::size_t aggregate_block = 1024;
+constexpr std::size_t lanes = 8;
+
+// Blocks are reduced over independent lanes: the inner loop has a fixed trip count and
+// floating point sums may not be reordered otherwise, so this is what gets vectorized.
+// Integers are summed as unsigned halves plus a count of negative values, none of which
+// overflows within a block, so no 128-bit arithmetic is needed per value.
+void reduce_integers(const int64_t *values, std::size_t size, aggregate_state_t &state) {
+  if (size == 0) {
+    return;
+  }
+  uint64_t highs[lanes] = {};
+  uint64_t lows[lanes] = {};
+  uint64_t negatives[lanes] = {};
+  int64_t mins[lanes];
+  int64_t maxs[lanes];
+  std::fill(std::begin(mins), std::end(mins), values[0]);
+  std::fill(std::begin(maxs), std::end(maxs), values[0]);
+  auto add = [&](std::size_t lane, int64_t value) {
+    auto bits = static_cast<uint64_t>(value);
+    highs[lane] += bits >> 32;
+    lows[lane] += bits & 0xffffffff;
+    negatives[lane] += bits >> 63;
+    mins[lane] = value < mins[lane] ? value : mins[lane];
+    maxs[lane] = value > maxs[lane] ? value : maxs[lane];
+  };
+  std::size_t i = 0;
+  for (; i + lanes <= size; i += lanes) {
+    for (std::size_t lane = 0; lane < lanes; ++lane) {
+      add(lane, values[i + lane]);
+    }
+  }
+  for (; i < size; ++i) {
+    add(0, values[i]);
+  }
+  for (std::size_t lane = 0; lane < lanes; ++lane) {
+    state.integer_sum += static_cast<__int128_t>(highs[lane]) * (int64_t(1) << 32) + lows[lane];
+    state.integer_sum -= static_cast<__int128_t>(negatives[lane]) << 64;
+    state.integer_min = std::min<__int128_t>(state.integer_min, mins[lane]);
+    state.integer_max = std::max<__int128_t>(state.integer_max, maxs[lane]);
+  }
+}
+
+void reduce_doubles(const double *values, std::size_t size, aggregate_state_t &state) {
+  if (size == 0) {
+    return;
+  }
+  double sums[lanes] = {};
+  double mins[lanes];
+  double maxs[lanes];
+  std::fill(std::begin(mins), std::end(mins), values[0]);
+  std::fill(std::begin(maxs), std::end(maxs), values[0]);
+  auto add = [&](std::size_t lane, double value) {
+    sums[lane] += value;
+    mins[lane] = value < mins[lane] ? value : mins[lane];
+    maxs[lane] = value > maxs[lane] ? value : maxs[lane];
+  };
+  std::size_t i = 0;
+  for (; i + lanes <= size; i += lanes) {
+    for (std::size_t lane = 0; lane < lanes; ++lane) {
+      add(lane, values[i + lane]);
+    }
+  }
+  for (; i < size; ++i) {
+    add(0, values[i]);
+  }
+  for (std::size_t lane = 0; lane < lanes; ++lane) {
+    state.float_sum += sums[lane];
+    state.float_min = std::min(state.float_min, mins[lane]);
+    state.float_max = std::max(state.float_max, maxs[lane]);
+  }
+}
+
+} // namespace
+
+// Values are gathered into typed blocks, integers that fit in int64_t and floating
+// point values widened to double, the few wider integers are added one by one.
+aggregate_t aggregate(const std::pmr::vector<document_ptr> &documents, std::string_view json_pointer) {
+  using simdjson::dom::element_type;
+
+  aggregate_state_t state;
+  int64_t integers[aggregate_block];
+  double doubles[aggregate_block];
+  std::size_t integer_count = 0;
+  std::size_t double_count = 0;
+  for (const auto &document : documents) {
+    bool is_exists;
+    column_reader_t::visit(*document, json_pointer, is_exists, [&](const auto &element) {
+      switch (element.type()) {
+        case element_type::INT8:
+        case element_type::INT16:
+        case element_type::INT32:
+        case element_type::INT64:
+          integers[integer_count++] = element.get_int64().value();
+          break;
+        case element_type::UINT8:
+        case element_type::UINT16:
+        case element_type::UINT32:
+          integers[integer_count++] = static_cast<int64_t>(element.get_uint64().value());
+          break;
+        case element_type::UINT64: {
+          auto value = element.get_uint64().value();
+          if (value <= uint64_t(std::numeric_limits<int64_t>::max())) {
+            integers[integer_count++] = static_cast<int64_t>(value);
+          } else {
+            state.add_integer(value);
+            return;
+          }
+          break;
+        }
+        case element_type::INT128:
+          state.add_integer(element.get_int128().value());
+          return;
+        case element_type::FLOAT:
+        case element_type::DOUBLE:
+          doubles[double_count++] = element.get_double().value();
+          break;
+        default:
+          return;
+      }
+      ++state.count;
+    });
+    if (integer_count == aggregate_block) {
+      reduce_integers(integers, integer_count, state);
+      integer_count = 0;
+    }
+    if (double_count == aggregate_block) {
+      reduce_doubles(doubles, double_count, state);
+      double_count = 0;
+    }
+  }
+  reduce_integers(integers, integer_count, state);
+  reduce_doubles(doubles, double_count, state);
+
+  return state.result();
+}
+
+} // namespace components::document
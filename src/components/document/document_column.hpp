@@ -0,0 +1,340 @@
+#pragma once
+
+#include <components/document/document.hpp>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <type_traits>
+
+namespace components::document {
+
+enum class compare_op_t {
+  EQUALS,
+  NOT_EQUALS,
+  LESS,
+  LESS_EQUALS,
+  MORE,
+  MORE_EQUALS,
+};
+
+static inline bool is_accepted(compare_op_t op, compare_t res) {
+  switch (op) {
+    case compare_op_t::EQUALS:
+      return res == compare_t::equals;
+    case compare_op_t::NOT_EQUALS:
+      return res != compare_t::equals;
+    case compare_op_t::LESS:
+      return res == compare_t::less;
+    case compare_op_t::LESS_EQUALS:
+      return res != compare_t::more;
+    case compare_op_t::MORE:
+      return res == compare_t::more;
+    case compare_op_t::MORE_EQUALS:
+      return res != compare_t::less;
+  }
+  return false;
+}
+
+// One bit per document of a batch, packed in 64-bit words. Bits past size() stay clear.
+class selection_t {
+public:
+  using allocator_type = std::pmr::memory_resource;
+
+  explicit selection_t(allocator_type *allocator);
+
+  // Resizes and clears every bit.
+  void reset(std::size_t size);
+
+  std::size_t size() const;
+
+  std::size_t count() const;
+
+  bool test(std::size_t index) const;
+
+  void set(std::size_t index);
+
+  void flip();
+
+  selection_t &operator&=(const selection_t &other);
+
+  selection_t &operator|=(const selection_t &other);
+
+  uint64_t *words();
+
+  const uint64_t *words() const;
+
+private:
+  std::size_t size_;
+  std::pmr::vector<uint64_t> words_;
+};
+
+// Reads leaves for the batch functions below.
+struct column_reader_t {
+  using node_t = document_t::json_trie_node_element;
+
+  // Lazy overlays are materialized and views follow their owner first, nullptr for
+  // an invalid document. Writes the document, see document_t on threads.
+  static const node_t *root(const document_t &document) {
+    document.sync_view_();
+    if (document.patch_ind_ != nullptr) {
+      document.materialize_();
+    }
+    return document.element_ind_.get();
+  }
+
+  // nullptr for a missing value
+  static const node_t *find(const document_t &document, std::string_view json_pointer) {
+    return document.find_node_const(json_pointer).first;
+  }
+
+  // The key document_t::append_sort_key appends for the value at node, nullptr is missing.
+  static void append_sort_key(const node_t *node, std::pmr::string &key) {
+    document_t::append_node_sort_key_(node, key);
+  }
+
+  // Calls function with the primitive element at json_pointer. Returns false for
+  // a missing value or a container, is_exists tells them apart. An invalid document
+  // has no values.
+  template<typename Function>
+  static bool visit(const document_t &document, std::string_view json_pointer, bool &is_exists, Function &&function) {
+    if (!document.is_valid()) {
+      is_exists = false;
+      return false;
+    }
+    const auto *node = document.find_node_const(json_pointer).first;
+    is_exists = node != nullptr;
+    if (node == nullptr) {
+      return false;
+    }
+    if (node->is_first()) {
+      function(*node->get_first());
+      return true;
+    }
+    if (node->is_second()) {
+      function(*node->get_second());
+      return true;
+    }
+    return false;
+  }
+};
+
+// A segment of a json pointer, unescaped, and the array index it reads. The index is
+// read the way document_t reads it, a key that is no number is 0.
+struct path_segment_t {
+  std::pmr::string key;
+  uint32_t index;
+};
+
+// Appends the segments of json_pointer. False for a pointer not starting with '/' or
+// a bad escape, the segments are incomplete then.
+bool split_json_pointer(std::string_view json_pointer, std::pmr::vector<path_segment_t> &segments);
+
+// bool is kept in bytes, std::pmr::vector<bool> has no data()
+template<typename T>
+using column_storage_t = std::conditional_t<std::is_same_v<T, bool>, uint8_t, T>;
+
+// Values at one json pointer across a batch of documents. Row i is valid if the value
+// of document i exists and converts to T, invalid rows hold T().
+template<typename T>
+struct document_column_t {
+  explicit document_column_t(std::pmr::memory_resource *allocator)
+          : values(allocator), valid(allocator) {}
+
+  std::pmr::vector<column_storage_t<T>> values;
+  selection_t valid;
+};
+
+template<typename T>
+void gather_column(
+        const std::pmr::vector<document_ptr> &documents,
+        std::string_view json_pointer,
+        document_column_t<T> &column
+) {
+  auto size = documents.size();
+  column.values.assign(size, column_storage_t<T>());
+  column.valid.reset(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    bool is_exists;
+    bool is_converted = false;
+    T value{};
+    column_reader_t::visit(*documents[i], json_pointer, is_exists, [&](const auto &element) {
+      is_converted = element.get(value) == simdjson::SUCCESS;
+    });
+    if (is_converted) {
+      column.values[i] = value;
+      column.valid.set(i);
+    }
+  }
+}
+
+// Bytes holding 0 or 1 to bits, byte i goes to bit i.
+static inline uint64_t pack_mask(const uint8_t *mask) {
+  uint64_t res = 0;
+  for (std::size_t i = 0; i < 8; ++i) {
+    uint64_t bytes;
+    std::memcpy(&bytes, mask + 8 * i, sizeof(bytes));
+    res |= ((bytes * 0x0102040810204080ULL) >> 56) << (8 * i);
+  }
+  return res;
+}
+
+// The comparisons of a block go to a byte mask first, that loop has no branches and
+// a fixed trip count so it is vectorized; the mask is then packed into a word.
+template<typename T, typename Compare>
+void select_kernel(
+        const T *values,
+        std::size_t size,
+        T value,
+        Compare compare,
+        const uint64_t *valid,
+        uint64_t *words
+) {
+  uint8_t mask[64];
+  std::size_t first = 0;
+  for (; first + 64 <= size; first += 64) {
+    for (std::size_t i = 0; i < 64; ++i) {
+      mask[i] = compare(values[first + i], value);
+    }
+    words[first / 64] = pack_mask(mask) & valid[first / 64];
+  }
+  if (first < size) {
+    std::fill(std::begin(mask), std::end(mask), uint8_t(0));
+    for (std::size_t i = 0; first + i < size; ++i) {
+      mask[i] = compare(values[first + i], value);
+    }
+    words[first / 64] = pack_mask(mask) & valid[first / 64];
+  }
+}
+
+template<typename T>
+void select_kernel(
+        const T *values,
+        std::size_t size,
+        compare_op_t op,
+        T value,
+        const uint64_t *valid,
+        uint64_t *words
+) {
+  switch (op) {
+    case compare_op_t::EQUALS:
+      return select_kernel(values, size, value, std::equal_to<T>(), valid, words);
+    case compare_op_t::NOT_EQUALS:
+      return select_kernel(values, size, value, std::not_equal_to<T>(), valid, words);
+    case compare_op_t::LESS:
+      return select_kernel(values, size, value, std::less<T>(), valid, words);
+    case compare_op_t::LESS_EQUALS:
+      return select_kernel(values, size, value, std::less_equal<T>(), valid, words);
+    case compare_op_t::MORE:
+      return select_kernel(values, size, value, std::greater<T>(), valid, words);
+    case compare_op_t::MORE_EQUALS:
+      return select_kernel(values, size, value, std::greater_equal<T>(), valid, words);
+  }
+}
+
+// Selects the valid rows whose value compares to value as op.
+template<typename T>
+void select(const document_column_t<T> &column, compare_op_t op, T value, selection_t &selection) {
+  auto size = column.values.size();
+  selection.reset(size);
+  select_kernel(
+          column.values.data(),
+          size,
+          op,
+          static_cast<column_storage_t<T>>(value),
+          column.valid.words(),
+          selection.words()
+  );
+}
+
+// Selects the documents whose value at json_pointer converts to T and compares to
+// value as op, e.g. select<int64_t>(documents, "/count", compare_op_t::MORE, 500, selection).
+template<typename T>
+void select(
+        const std::pmr::vector<document_ptr> &documents,
+        std::string_view json_pointer,
+        compare_op_t op,
+        T value,
+        selection_t &selection
+) {
+  document_column_t<T> column(documents.get_allocator().resource());
+  gather_column(documents, json_pointer, column);
+  select(column, op, value, selection);
+}
+
+// Selects the documents for which document->compare(other, json_pointer) satisfies op.
+void select_compare(
+        const std::pmr::vector<document_ptr> &documents,
+        const document_t &other,
+        std::string_view json_pointer,
+        compare_op_t op,
+        selection_t &selection
+);
+
+// Numeric values at one json pointer across a batch of documents, other values are
+// skipped. Integers of every width are summed exactly, floating point values apart.
+struct aggregate_t {
+  std::size_t count;
+  __int128_t integer_sum;
+  double float_sum;
+  // NaN without values
+  double min;
+  double max;
+
+  double sum() const;
+
+  double avg() const;
+};
+
+// Running aggregate the values are added to one by one or in blocks.
+struct aggregate_state_t {
+  std::size_t count = 0;
+  __int128_t integer_sum = 0;
+  __int128_t integer_min = std::numeric_limits<__int128_t>::max();
+  __int128_t integer_max = std::numeric_limits<__int128_t>::min();
+  double float_sum = 0;
+  double float_min = std::numeric_limits<double>::infinity();
+  double float_max = -std::numeric_limits<double>::infinity();
+
+  void add_integer(__int128_t value);
+
+  void add_double(double value);
+
+  // Returns false for an element that is no number.
+  template<typename Element>
+  bool add(const Element &element) {
+    using simdjson::dom::element_type;
+
+    switch (element.type()) {
+      case element_type::INT8:
+      case element_type::INT16:
+      case element_type::INT32:
+      case element_type::INT64:
+        add_integer(element.get_int64().value());
+        return true;
+      case element_type::UINT8:
+      case element_type::UINT16:
+      case element_type::UINT32:
+      case element_type::UINT64:
+        add_integer(element.get_uint64().value());
+        return true;
+      case element_type::INT128:
+        add_integer(element.get_int128().value());
+        return true;
+      case element_type::FLOAT:
+      case element_type::DOUBLE:
+        add_double(element.get_double().value());
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  void merge(const aggregate_state_t &other);
+
+  aggregate_t result() const;
+};
+
+aggregate_t aggregate(const std::pmr::vector<document_ptr> &documents, std::string_view json_pointer);
+
+} // namespace components::document
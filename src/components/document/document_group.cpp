@@ -0,0 +1,278 @@
+#include "document_group.hpp"
+#include <components/document/hash.hpp>
+#include <components/document/parallel.hpp>
+#include <memory_resource>
+
+namespace components::document {
+
+namespace {
+
+using node_t = column_reader_t::node_t;
+
+constexpr std::size_t min_chunk_size = 1 << 12;
+constexpr uint32_t no_parent = UINT32_MAX;
+
+// The json pointers of a query as a trie of their unescaped segments: a prefix shared
+// by several pointers is walked once per document. Step 0 is the root, a parent comes
+// before its children, a step without parent never resolves.
+class path_trie_t {
+public:
+  explicit path_trie_t(std::pmr::memory_resource *allocator)
+          : allocator_(allocator),
+            steps_(allocator) {
+    steps_.push_back({0, std::pmr::string(allocator), 0});
+  }
+
+  uint32_t add(std::string_view json_pointer) {
+    std::pmr::vector<path_segment_t> segments(allocator_);
+    if (!split_json_pointer(json_pointer, segments)) {
+      return invalid_step_();
+    }
+    uint32_t current = 0;
+    for (auto &segment : segments) {
+      current = child_(current, segment);
+    }
+    return current;
+  }
+
+  std::size_t size() const {
+    return steps_.size();
+  }
+
+  void resolve(const node_t *root, const node_t **nodes) const {
+    nodes[0] = root;
+    for (std::size_t i = 1; i < steps_.size(); ++i) {
+      const auto &step = steps_[i];
+      const auto *parent = step.parent == no_parent ? nullptr : nodes[step.parent];
+      if (parent == nullptr) {
+        nodes[i] = nullptr;
+      } else if (parent->is_object()) {
+        nodes[i] = parent->get_object()->get(step.key);
+      } else if (parent->is_array()) {
+        nodes[i] = parent->get_array()->get(step.index);
+      } else {
+        nodes[i] = nullptr;
+      }
+    }
+  }
+
+private:
+  struct step_t {
+    uint32_t parent;
+    std::pmr::string key;
+    uint32_t index;
+  };
+
+  std::pmr::memory_resource *allocator_;
+  std::pmr::vector<step_t> steps_;
+
+  uint32_t child_(uint32_t parent, path_segment_t &segment) {
+    for (std::size_t i = 1; i < steps_.size(); ++i) {
+      if (steps_[i].parent == parent && steps_[i].key == segment.key) {
+        return static_cast<uint32_t>(i);
+      }
+    }
+    steps_.push_back({parent, std::move(segment.key), segment.index});
+    return static_cast<uint32_t>(steps_.size() - 1);
+  }
+
+  uint32_t invalid_step_() {
+    for (std::size_t i = 1; i < steps_.size(); ++i) {
+      if (steps_[i].parent == no_parent) {
+        return static_cast<uint32_t>(i);
+      }
+    }
+    steps_.push_back({no_parent, std::pmr::string(allocator_), 0});
+    return static_cast<uint32_t>(steps_.size() - 1);
+  }
+};
+
+// Open addressing with linear probing over group numbers, 0 is an empty slot. Keys are
+// kept in one buffer, each group keeps its hash for probing and growing.
+class group_table_t {
+public:
+  struct entry_t {
+    std::size_t hash;
+    std::size_t key_offset;
+    std::size_t key_size;
+    std::size_t first;
+    std::size_t size;
+  };
+
+  group_table_t(std::pmr::memory_resource *allocator, std::size_t aggregates)
+          : aggregates_(aggregates),
+            keys_(allocator),
+            entries_(allocator),
+            states_(allocator),
+            slots_(64, 0, allocator) {}
+
+  // Returns the group of key, a new one starts at document first and is empty.
+  std::size_t find_or_insert(std::string_view key, std::size_t hash, std::size_t first) {
+    auto mask = slots_.size() - 1;
+    for (auto slot = hash & mask;; slot = (slot + 1) & mask) {
+      auto group = slots_[slot];
+      if (group == 0) {
+        slots_[slot] = static_cast<uint32_t>(entries_.size() + 1);
+        break;
+      }
+      const auto &entry = entries_[group - 1];
+      if (entry.hash == hash && key_(entry) == key) {
+        return group - 1;
+      }
+    }
+    entries_.push_back({hash, keys_.size(), key.size(), first, 0});
+    keys_.append(key);
+    states_.resize(states_.size() + aggregates_);
+    if (2 * entries_.size() >= slots_.size()) {
+      grow_();
+    }
+    return entries_.size() - 1;
+  }
+
+  std::size_t size() const {
+    return entries_.size();
+  }
+
+  entry_t &entry(std::size_t group) {
+    return entries_[group];
+  }
+
+  std::string_view key(std::size_t group) const {
+    return key_(entries_[group]);
+  }
+
+  aggregate_state_t *states(std::size_t group) {
+    return states_.data() + group * aggregates_;
+  }
+
+private:
+  std::size_t aggregates_;
+  std::pmr::string keys_;
+  std::pmr::vector<entry_t> entries_;
+  std::pmr::vector<aggregate_state_t> states_;
+  std::pmr::vector<uint32_t> slots_;
+
+  std::string_view key_(const entry_t &entry) const {
+    return {keys_.data() + entry.key_offset, entry.key_size};
+  }
+
+  void grow_() {
+    slots_.assign(2 * slots_.size(), 0);
+    auto mask = slots_.size() - 1;
+    for (std::size_t group = 0; group < entries_.size(); ++group) {
+      auto slot = entries_[group].hash & mask;
+      while (slots_[slot] != 0) {
+        slot = (slot + 1) & mask;
+      }
+      slots_[slot] = static_cast<uint32_t>(group + 1);
+    }
+  }
+};
+
+} // namespace
+
+std::pmr::vector<group_t> group_documents(
+        const std::pmr::vector<document_ptr> &documents,
+        const std::pmr::vector<std::string_view> &group_by,
+        const std::pmr::vector<std::string_view> &aggregated,
+        std::size_t threads
+) {
+  auto allocator = documents.get_allocator().resource();
+  auto size = documents.size();
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::max<std::size_t>(1, std::min(threads, (size + min_chunk_size - 1) / min_chunk_size));
+  // the workers share the documents, merged ones are materialized up front
+  for (const auto &document : documents) {
+    document->materialize();
+  }
+
+  path_trie_t trie(allocator);
+  std::pmr::vector<uint32_t> group_steps(allocator);
+  for (auto json_pointer : group_by) {
+    group_steps.push_back(trie.add(json_pointer));
+  }
+  std::pmr::vector<uint32_t> aggregate_steps(allocator);
+  for (auto json_pointer : aggregated) {
+    aggregate_steps.push_back(trie.add(json_pointer));
+  }
+
+  std::vector<std::pmr::unsynchronized_pool_resource> resources(threads);
+  std::vector<group_table_t> tables;
+  tables.reserve(threads);
+  for (auto &resource : resources) {
+    tables.emplace_back(&resource, aggregated.size());
+  }
+
+  run_parallel(threads, [&](std::size_t chunk) {
+    auto &table = tables[chunk];
+    std::pmr::vector<const node_t *> nodes(trie.size(), &resources[chunk]);
+    std::pmr::string key(&resources[chunk]);
+    for (auto i = size * chunk / threads; i < size * (chunk + 1) / threads; ++i) {
+      trie.resolve(column_reader_t::root(*documents[i]), nodes.data());
+      key.clear();
+      for (auto step : group_steps) {
+        column_reader_t::append_sort_key(nodes[step], key);
+      }
+      auto group = table.find_or_insert(key, hash_bytes(key), i);
+      ++table.entry(group).size;
+      auto *states = table.states(group);
+      for (std::size_t j = 0; j < aggregate_steps.size(); ++j) {
+        const auto *node = nodes[aggregate_steps[j]];
+        if (node == nullptr) {
+          continue;
+        }
+        if (node->is_first()) {
+          states[j].add(*node->get_first());
+        } else if (node->is_second()) {
+          states[j].add(*node->get_second());
+        }
+      }
+    }
+  });
+
+  // chunks are in document order, so a group of a later chunk never starts earlier
+  auto &result_table = tables.front();
+  for (std::size_t chunk = 1; chunk < threads; ++chunk) {
+    auto &table = tables[chunk];
+    for (std::size_t group = 0; group < table.size(); ++group) {
+      const auto &entry = table.entry(group);
+      auto merged = result_table.find_or_insert(table.key(group), entry.hash, entry.first);
+      result_table.entry(merged).size += entry.size;
+      auto *states = result_table.states(merged);
+      const auto *other_states = table.states(group);
+      for (std::size_t j = 0; j < aggregated.size(); ++j) {
+        states[j].merge(other_states[j]);
+      }
+    }
+  }
+
+  std::pmr::vector<std::size_t> order(result_table.size(), allocator);
+  for (std::size_t group = 0; group < order.size(); ++group) {
+    order[group] = group;
+  }
+  std::sort(order.begin(), order.end(), [&](std::size_t group1, std::size_t group2) {
+    return result_table.entry(group1).first < result_table.entry(group2).first;
+  });
+  std::pmr::vector<group_t> groups(allocator);
+  groups.reserve(order.size());
+  for (auto group : order) {
+    const auto &entry = result_table.entry(group);
+    group_t res{
+            std::pmr::string(result_table.key(group), allocator),
+            entry.first,
+            entry.size,
+            std::pmr::vector<aggregate_t>(allocator)
+    };
+    res.aggregates.reserve(aggregated.size());
+    const auto *states = result_table.states(group);
+    for (std::size_t j = 0; j < aggregated.size(); ++j) {
+      res.aggregates.push_back(states[j].result());
+    }
+    groups.push_back(std::move(res));
+  }
+  return groups;
+}
+
+} // namespace components::document
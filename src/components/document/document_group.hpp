@@ -0,0 +1,31 @@
+#pragma once
+
+#include <components/document/document_column.hpp>
+
+namespace components::document {
+
+struct group_t {
+  // the sort keys of the group values, concatenated in the order of the group pointers
+  std::pmr::string key;
+  // index of the first document of the group, the group values can be read from it
+  std::size_t first;
+  std::size_t size;
+  // one per aggregated json pointer
+  std::pmr::vector<aggregate_t> aggregates;
+};
+
+// Groups documents by the values at group_by, documents with equal values (numbers by
+// value, missing values alike) fall into one group, and aggregates the values at
+// aggregated per group. Groups are returned in the order of their first document.
+// The json pointers of a document are resolved in one walk over a trie of the pointers,
+// group keys are the concatenated sort keys hashed into an open-addressing table. With
+// threads > 1 (0 is one per core) each thread groups a chunk into a table of its own,
+// the tables are merged at the end.
+std::pmr::vector<group_t> group_documents(
+        const std::pmr::vector<document_ptr> &documents,
+        const std::pmr::vector<std::string_view> &group_by,
+        const std::pmr::vector<std::string_view> &aggregated,
+        std::size_t threads = 1
+);
+
+} // namespace components::document
@@ -0,0 +1,286 @@
+#include "document_hash_index.hpp"
+#include <components/document/hash.hpp>
+#include <algorithm>
+#include <cstring>
+#include <memory_resource>
+
+namespace components::document {
+
+namespace {
+
+constexpr uint64_t low_bits = 0x0101010101010101ULL;
+constexpr uint64_t high_bits = 0x8080808080808080ULL;
+constexpr uint8_t empty_control = 0x80;
+constexpr uint8_t deleted_control = 0xfe;
+constexpr std::size_t group_size = 8;
+
+uint64_t load_group(const uint8_t *controls) {
+  uint64_t res;
+  std::memcpy(&res, controls, sizeof(res));
+  return res;
+}
+
+// The high bit of each byte equal to control. A byte right above a match may be
+// reported too, the candidates are compared anyway.
+uint64_t match_control(uint64_t group, uint8_t control) {
+  auto bytes = group ^ (low_bits * control);
+  return (bytes - low_bits) & ~bytes & high_bits;
+}
+
+// empty is 0x80 and deleted 0xfe, they differ in bit 1
+uint64_t match_empty(uint64_t group) {
+  return group & (~group << 6) & high_bits;
+}
+
+uint64_t match_free(uint64_t group) {
+  return group & high_bits;
+}
+
+std::size_t first_byte(uint64_t mask) {
+  return static_cast<std::size_t>(__builtin_ctzll(mask)) / 8;
+}
+
+uint8_t hash_control(std::size_t hash) {
+  return static_cast<uint8_t>(hash & 0x7f);
+}
+
+std::size_t hash_group(std::size_t hash) {
+  return hash >> 7;
+}
+
+} // namespace
+
+document_hash_index_t::table_t::table_t(allocator_type *allocator)
+        : controls(allocator),
+          slots(allocator),
+          keys(allocator),
+          size(0),
+          deleted(0) {}
+
+std::size_t document_hash_index_t::table_t::groups() const {
+  return controls.size() / group_size;
+}
+
+std::string_view document_hash_index_t::table_t::key(const slot_t &slot) const {
+  return {keys.data() + slot.key_offset, slot.key_size};
+}
+
+void document_hash_index_t::table_t::reset(std::size_t groups) {
+  controls.assign(groups * group_size, empty_control);
+  slots.assign(groups * group_size, slot_t{});
+  keys.clear();
+  size = 0;
+  deleted = 0;
+}
+
+// Triangular probing over the groups visits each of them, there are a power of two.
+void document_hash_index_t::table_t::insert(std::string_view key, std::size_t hash, uint32_t list) {
+  auto mask = groups() - 1;
+  auto group = hash_group(hash) & mask;
+  for (std::size_t step = 1;; group = (group + step++) & mask) {
+    auto free = match_free(load_group(controls.data() + group * group_size));
+    if (free == 0) {
+      continue;
+    }
+    auto slot = group * group_size + first_byte(free);
+    deleted -= controls[slot] == deleted_control;
+    controls[slot] = hash_control(hash);
+    slots[slot] = {static_cast<uint32_t>(keys.size()), static_cast<uint32_t>(key.size()), list};
+    keys.append(key);
+    ++size;
+    return;
+  }
+}
+
+void document_hash_index_t::table_t::erase(std::size_t slot) {
+  controls[slot] = deleted_control;
+  --size;
+  ++deleted;
+}
+
+std::size_t document_hash_index_t::table_t::find(std::string_view key, std::size_t hash) const {
+  if (size == 0) {
+    return no_slot_;
+  }
+  auto mask = groups() - 1;
+  auto group = hash_group(hash) & mask;
+  auto control = hash_control(hash);
+  for (std::size_t step = 1;; group = (group + step++) & mask) {
+    auto word = load_group(controls.data() + group * group_size);
+    for (auto matches = match_control(word, control); matches != 0; matches &= matches - 1) {
+      auto slot = group * group_size + first_byte(matches);
+      if (controls[slot] == control && this->key(slots[slot]) == key) {
+        return slot;
+      }
+    }
+    if (match_empty(word) != 0) {
+      return no_slot_;
+    }
+  }
+}
+
+document_hash_index_t::document_hash_index_t(allocator_type *allocator, std::string_view json_pointer)
+        : allocator_(allocator),
+          json_pointer_(json_pointer, allocator),
+          table_(allocator),
+          old_table_(allocator),
+          moved_groups_(0),
+          lists_(allocator),
+          free_lists_(allocator),
+          size_(0),
+          scratch_(allocator) {}
+
+std::string_view document_hash_index_t::json_pointer() const {
+  return json_pointer_;
+}
+
+std::size_t document_hash_index_t::size() const {
+  return size_;
+}
+
+void document_hash_index_t::build(const std::pmr::vector<document_ptr> &documents) {
+  std::pmr::vector<std::pair<id_t, document_ptr>> pairs(allocator_);
+  pairs.reserve(documents.size());
+  for (std::size_t i = 0; i < documents.size(); ++i) {
+    pairs.emplace_back(i, documents[i]);
+  }
+  build(pairs);
+}
+
+void document_hash_index_t::build(const std::pmr::vector<std::pair<id_t, document_ptr>> &documents) {
+  // the number of distinct values is unknown, the table grows while it is filled
+  old_table_.reset(0);
+  moved_groups_ = 0;
+  table_.reset(min_groups_);
+  lists_.clear();
+  free_lists_.clear();
+  size_ = 0;
+  for (const auto &[id, document] : documents) {
+    scratch_.clear();
+    document->append_sort_key(json_pointer_, scratch_);
+    insert_(id, scratch_);
+  }
+  move_groups_(old_table_.groups());
+}
+
+void document_hash_index_t::insert(id_t id, const document_t &document) {
+  scratch_.clear();
+  document.append_sort_key(json_pointer_, scratch_);
+  insert_(id, scratch_);
+}
+
+void document_hash_index_t::remove(id_t id, const document_t &document) {
+  scratch_.clear();
+  document.append_sort_key(json_pointer_, scratch_);
+  auto hash = hash_bytes(scratch_);
+  for (auto *table : {&table_, &old_table_}) {
+    auto slot = table->find(scratch_, hash);
+    if (slot == no_slot_) {
+      continue;
+    }
+    auto list = table->slots[slot].list;
+    auto &ids = lists_[list];
+    auto it = std::find(ids.begin(), ids.end(), id);
+    if (it != ids.end()) {
+      *it = ids.back();
+      ids.pop_back();
+      --size_;
+      if (ids.empty()) {
+        ids.shrink_to_fit();
+        free_lists_.push_back(list);
+        table->erase(slot);
+      }
+    }
+    break;
+  }
+  move_groups_(groups_per_change_);
+}
+
+void document_hash_index_t::find(const boost::json::value &value, std::pmr::vector<id_t> &ids) const {
+  char buffer[256];
+  std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), allocator_);
+  std::pmr::string key(&resource);
+  append_sort_key(value, key);
+  auto hash = hash_bytes(key);
+  for (const auto *table : {&table_, &old_table_}) {
+    auto slot = table->find(key, hash);
+    if (slot != no_slot_) {
+      const auto &list = lists_[table->slots[slot].list];
+      ids.insert(ids.end(), list.begin(), list.end());
+      return;
+    }
+  }
+}
+
+void document_hash_index_t::insert_(id_t id, std::string_view key) {
+  grow_if_needed_();
+  auto hash = hash_bytes(key);
+  ++size_;
+  for (const auto *table : {&table_, &old_table_}) {
+    auto slot = table->find(key, hash);
+    if (slot != no_slot_) {
+      lists_[table->slots[slot].list].push_back(id);
+      return;
+    }
+  }
+  uint32_t list;
+  if (free_lists_.empty()) {
+    list = static_cast<uint32_t>(lists_.size());
+    lists_.emplace_back();
+  } else {
+    list = free_lists_.back();
+    free_lists_.pop_back();
+  }
+  lists_[list].push_back(id);
+  table_.insert(key, hash, list);
+}
+
+// Deleted slots count as used, so a probe always ends at an empty one. The old table
+// is moved in groups() / groups_per_change_ changes; with at least half its groups the
+// new table holds its entries and the changes meanwhile below the load limit.
+void document_hash_index_t::grow_if_needed_() {
+  move_groups_(groups_per_change_);
+  auto capacity = table_.groups() * group_size;
+  if (table_.size + table_.deleted + 1 <= capacity * 7 / 8) {
+    return;
+  }
+  move_groups_(old_table_.groups());
+  auto groups = std::max(min_groups_, table_.groups() / 2);
+  while (groups * group_size * 7 / 8 <= 2 * (table_.size + 1)) {
+    groups *= 2;
+  }
+  std::swap(table_, old_table_);
+  table_.reset(groups);
+  moved_groups_ = 0;
+  // a table that is mostly deleted slots is moved at once
+  if (old_table_.size < groups_per_change_ * group_size) {
+    move_groups_(old_table_.groups());
+  }
+}
+
+void document_hash_index_t::move_groups_(std::size_t count) {
+  auto groups = old_table_.groups();
+  if (groups == 0) {
+    return;
+  }
+  auto last = std::min(groups, moved_groups_ + count);
+  for (auto slot = moved_groups_ * group_size; slot < last * group_size; ++slot) {
+    if (old_table_.controls[slot] & 0x80) {
+      continue;
+    }
+    const auto &moved = old_table_.slots[slot];
+    auto key = old_table_.key(moved);
+    table_.insert(key, hash_bytes(key), moved.list);
+    old_table_.erase(slot);
+  }
+  moved_groups_ = last;
+  if (moved_groups_ == groups) {
+    old_table_.reset(0);
+    old_table_.controls.shrink_to_fit();
+    old_table_.slots.shrink_to_fit();
+    old_table_.keys.shrink_to_fit();
+    moved_groups_ = 0;
+  }
+}
+
+} // namespace components::document
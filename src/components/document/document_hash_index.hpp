@@ -0,0 +1,96 @@
+#pragma once
+
+#include <components/document/document.hpp>
+
+namespace components::document {
+
+// Equality index over the values at one json pointer, keyed like document_index_t so
+// numbers of any storage are equal by value. Open addressing in the layout of Swiss
+// tables: a control byte per slot holds 7 bits of the hash, a group of 8 is probed at
+// once as one 64-bit word. Growing moves a few groups per change into a table twice
+// the size instead of all at once, lookups search both tables meanwhile. A slot holds
+// one distinct key and the ids of its documents, so a probe ends at the first match
+// however many documents share a value.
+class document_hash_index_t {
+public:
+  using allocator_type = std::pmr::memory_resource;
+  using id_t = uint64_t;
+
+  document_hash_index_t(allocator_type *allocator, std::string_view json_pointer);
+
+  std::string_view json_pointer() const;
+
+  // number of ids
+  std::size_t size() const;
+
+  // Replaces the contents, documents[i] gets id i.
+  void build(const std::pmr::vector<document_ptr> &documents);
+
+  void build(const std::pmr::vector<std::pair<id_t, document_ptr>> &documents);
+
+  void insert(id_t id, const document_t &document);
+
+  // document must hold the value it was inserted with. Scans the ids of that value.
+  void remove(id_t id, const document_t &document);
+
+  // Appends the ids of the documents whose value equals value.
+  void find(const boost::json::value &value, std::pmr::vector<id_t> &ids) const;
+
+private:
+  struct slot_t {
+    uint32_t key_offset;
+    uint32_t key_size;
+    // in lists_
+    uint32_t list;
+  };
+
+  struct table_t {
+    explicit table_t(allocator_type *allocator);
+
+    // one per slot, groups of 8 are loaded as little-endian words
+    std::pmr::vector<uint8_t> controls;
+    std::pmr::vector<slot_t> slots;
+    std::pmr::string keys;
+    std::size_t size;
+    std::size_t deleted;
+
+    std::size_t groups() const;
+
+    std::string_view key(const slot_t &slot) const;
+
+    void reset(std::size_t groups);
+
+    // key must not be in the table yet
+    void insert(std::string_view key, std::size_t hash, uint32_t list);
+
+    void erase(std::size_t slot);
+
+    // The slot holding key or no_slot.
+    std::size_t find(std::string_view key, std::size_t hash) const;
+  };
+
+  constexpr static std::size_t no_slot_ = SIZE_MAX;
+
+  allocator_type *allocator_;
+  std::pmr::string json_pointer_;
+  table_t table_;
+  // the table being moved into table_, its groups before moved_groups_ are empty
+  table_t old_table_;
+  std::size_t moved_groups_;
+  // ids per key, emptied lists are reused
+  std::pmr::vector<std::pmr::vector<id_t>> lists_;
+  std::pmr::vector<uint32_t> free_lists_;
+  std::size_t size_;
+  std::pmr::string scratch_;
+
+  constexpr static std::size_t min_groups_ = 2;
+  constexpr static std::size_t groups_per_change_ = 4;
+
+  void insert_(id_t id, std::string_view key);
+
+  void grow_if_needed_();
+
+  void move_groups_(std::size_t count);
+};
+
+} // namespace components::document
@@ -0,0 +1,390 @@
+#include "document_index.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace components::document {
+
+namespace {
+
+std::size_t common_prefix_size(std::string_view key1, std::string_view key2) {
+  auto size = std::min(key1.size(), key2.size());
+  std::size_t res = 0;
+  while (res < size && key1[res] == key2[res]) {
+    ++res;
+  }
+  return res;
+}
+
+// Calls function(index) for the entries of two sorted runs in the order of (key, id).
+template<typename Entry, typename Key1, typename Key2, typename Function>
+void merge_runs(
+        const Entry *first1, const Entry *last1, Key1 key1,
+        const Entry *first2, const Entry *last2, Key2 key2,
+        Function &&function
+) {
+  while (first1 != last1 || first2 != last2) {
+    bool is_first;
+    if (first1 == last1) {
+      is_first = false;
+    } else if (first2 == last2) {
+      is_first = true;
+    } else {
+      auto res = key1(*first1).compare(key2(*first2));
+      is_first = res < 0 || (res == 0 && first1->id < first2->id);
+    }
+    if (is_first) {
+      function(*first1++, true);
+    } else {
+      function(*first2++, false);
+    }
+  }
+}
+
+} // namespace
+
+document_index_t::document_index_t(allocator_type *allocator, std::string_view json_pointer)
+        : allocator_(allocator),
+          json_pointer_(json_pointer, allocator),
+          keys_(allocator),
+          entries_(allocator),
+          removed_(allocator),
+          removed_count_(0),
+          common_size_(0),
+          delta_keys_(allocator),
+          delta_(allocator),
+          scratch_(allocator) {}
+
+std::string_view document_index_t::json_pointer() const {
+  return json_pointer_;
+}
+
+std::size_t document_index_t::size() const {
+  return entries_.size() - removed_count_ + delta_.size();
+}
+
+void document_index_t::build(const std::pmr::vector<document_ptr> &documents) {
+  std::pmr::vector<std::pair<id_t, document_ptr>> pairs(allocator_);
+  pairs.reserve(documents.size());
+  for (std::size_t i = 0; i < documents.size(); ++i) {
+    pairs.emplace_back(i, documents[i]);
+  }
+  build(pairs);
+}
+
+void document_index_t::build(const std::pmr::vector<std::pair<id_t, document_ptr>> &documents) {
+  std::pmr::string keys(allocator_);
+  std::pmr::vector<entry_t> entries(allocator_);
+  entries.reserve(documents.size());
+  for (const auto &[id, document] : documents) {
+    auto offset = keys.size();
+    document->append_sort_key(json_pointer_, keys);
+    assert(keys.size() <= max_key_bytes_);
+    entries.push_back({0, static_cast<uint32_t>(offset), static_cast<uint32_t>(keys.size() - offset), id});
+  }
+  auto less = [&keys](const entry_t &entry1, const entry_t &entry2) {
+    auto res = std::string_view(keys.data() + entry1.offset, entry1.size)
+            .compare(std::string_view(keys.data() + entry2.offset, entry2.size));
+    return res < 0 || (res == 0 && entry1.id < entry2.id);
+  };
+  if (!std::is_sorted(entries.begin(), entries.end(), less)) {
+    std::sort(entries.begin(), entries.end(), less);
+  }
+  delta_keys_.clear();
+  delta_.clear();
+  reset_(std::move(keys), std::move(entries));
+}
+
+void document_index_t::insert(id_t id, const document_t &document) {
+  auto offset = delta_keys_.size();
+  document.append_sort_key(json_pointer_, delta_keys_);
+  assert(delta_keys_.size() <= max_key_bytes_);
+  entry_t entry{0, static_cast<uint32_t>(offset), static_cast<uint32_t>(delta_keys_.size() - offset), id};
+  auto key = delta_key_(entry);
+  auto position = std::partition_point(delta_.begin(), delta_.end(), [&](const entry_t &other) {
+    auto res = delta_key_(other).compare(key);
+    return res < 0 || (res == 0 && other.id < id);
+  });
+  delta_.insert(position, entry);
+  // an insert moves half the delta, a merge the whole array: a multiple of sqrt(size)
+  // balances them
+  if (delta_.size() > std::max(min_delta_size_, 8 * static_cast<std::size_t>(std::sqrt(entries_.size())))) {
+    merge_();
+  }
+}
+
+void document_index_t::remove(id_t id, const document_t &document) {
+  scratch_.clear();
+  document.append_sort_key(json_pointer_, scratch_);
+  std::string_view key = scratch_;
+  auto position = delta_.begin() + static_cast<std::ptrdiff_t>(search_delta_(key, false));
+  auto last = delta_.begin() + static_cast<std::ptrdiff_t>(search_delta_(key, true));
+  position = std::partition_point(position, last, [id](const entry_t &entry) { return entry.id < id; });
+  if (position != last && position->id == id) {
+    delta_.erase(position);
+    return;
+  }
+  auto first = entries_.begin() + static_cast<std::ptrdiff_t>(search_(key, false));
+  auto end = entries_.begin() + static_cast<std::ptrdiff_t>(search_(key, true));
+  auto found = std::partition_point(first, end, [id](const entry_t &entry) { return entry.id < id; });
+  if (found == end || found->id != id) {
+    return;
+  }
+  auto &removed = removed_[static_cast<std::size_t>(found - entries_.begin())];
+  if (removed == 0) {
+    removed = 1;
+    ++removed_count_;
+  }
+  if (removed_count_ > std::max(min_delta_size_, entries_.size() / 4)) {
+    merge_();
+  }
+}
+
+void document_index_t::find(const boost::json::value &value, std::pmr::vector<id_t> &ids) const {
+  find_range(&value, true, &value, true, ids);
+}
+
+void document_index_t::find_range(
+        const boost::json::value *lower,
+        bool is_lower_inclusive,
+        const boost::json::value *upper,
+        bool is_upper_inclusive,
+        std::pmr::vector<id_t> &ids
+) const {
+  std::pmr::string lower_key(allocator_);
+  std::pmr::string upper_key(allocator_);
+  std::size_t first = 0;
+  std::size_t delta_first = 0;
+  std::size_t last = entries_.size();
+  std::size_t delta_last = delta_.size();
+  if (lower != nullptr) {
+    append_sort_key(*lower, lower_key);
+    first = search_(lower_key, !is_lower_inclusive);
+    delta_first = search_delta_(lower_key, !is_lower_inclusive);
+  }
+  if (upper != nullptr) {
+    append_sort_key(*upper, upper_key);
+    last = search_(upper_key, is_upper_inclusive);
+    delta_last = search_delta_(upper_key, is_upper_inclusive);
+  }
+  if (first >= last && delta_first >= delta_last) {
+    return;
+  }
+  last = std::max(first, last);
+  delta_last = std::max(delta_first, delta_last);
+  const auto *entries = entries_.data();
+  merge_runs(
+          entries + first, entries + last, [this](const entry_t &entry) { return key_(entry); },
+          delta_.data() + delta_first, delta_.data() + delta_last, [this](const entry_t &entry) { return delta_key_(entry); },
+          [&](const entry_t &entry, bool is_main) {
+            if (!is_main || removed_[static_cast<std::size_t>(&entry - entries)] == 0) {
+              ids.push_back(entry.id);
+            }
+          }
+  );
+}
+
+std::string_view document_index_t::key_(const entry_t &entry) const {
+  return {keys_.data() + entry.offset, entry.size};
+}
+
+std::string_view document_index_t::delta_key_(const entry_t &entry) const {
+  return {delta_keys_.data() + entry.offset, entry.size};
+}
+
+uint64_t document_index_t::prefix_(std::string_view key) const {
+  uint64_t res = 0;
+  for (std::size_t i = common_size_; i < common_size_ + sizeof(res); ++i) {
+    res = (res << 8) | (i < key.size() ? static_cast<unsigned char>(key[i]) : 0);
+  }
+  return res;
+}
+
+// Prefixes never decrease along the entries, so interpolation on them narrows the
+// range holding the first entry of the prefix of key; the entries with that prefix
+// are then found by galloping and compared in full.
+std::size_t document_index_t::search_(std::string_view key, bool is_upper) const {
+  auto size = entries_.size();
+  if (size == 0) {
+    return 0;
+  }
+  auto common = key_(entries_.front()).substr(0, common_size_);
+  auto res = key.substr(0, common_size_).compare(common);
+  if (res != 0) {
+    return res < 0 ? 0 : size;
+  }
+  auto target = prefix_(key);
+  std::size_t low = 0;
+  std::size_t high = size;
+  for (int round = 0; round < 8 && high - low > 16; ++round) {
+    auto first = entries_[low].prefix;
+    auto last = entries_[high - 1].prefix;
+    if (target <= first) {
+      high = low;
+      break;
+    }
+    if (target > last) {
+      low = high;
+      break;
+    }
+    auto guess = low + static_cast<std::size_t>(
+            static_cast<__uint128_t>(target - first) * (high - 1 - low) / (last - first)
+    );
+    if (entries_[guess].prefix < target) {
+      low = guess + 1;
+    } else {
+      high = guess;
+    }
+  }
+  const auto *entries = entries_.data();
+  auto *position = std::partition_point(entries + low, entries + high, [target](const entry_t &entry) {
+    return entry.prefix < target;
+  });
+  std::size_t step = 1;
+  auto *end = position;
+  while (end != entries + size && end->prefix == target) {
+    end = entries + std::min(size, static_cast<std::size_t>(end - entries) + step);
+    step *= 2;
+  }
+  return static_cast<std::size_t>(std::partition_point(position, end, [&](const entry_t &entry) {
+    if (entry.prefix != target) {
+      return false;
+    }
+    auto compare = key_(entry).compare(key);
+    return compare < 0 || (is_upper && compare == 0);
+  }) - entries);
+}
+
+std::size_t document_index_t::search_delta_(std::string_view key, bool is_upper) const {
+  return static_cast<std::size_t>(std::partition_point(delta_.begin(), delta_.end(), [&](const entry_t &entry) {
+    auto res = delta_key_(entry).compare(key);
+    return res < 0 || (is_upper && res == 0);
+  }) - delta_.begin());
+}
+
+void document_index_t::reset_(std::pmr::string &&keys, std::pmr::vector<entry_t> &&entries) {
+  keys_ = std::move(keys);
+  entries_ = std::move(entries);
+  common_size_ = entries_.empty() ? 0 : common_prefix_size(key_(entries_.front()), key_(entries_.back()));
+  for (auto &entry : entries_) {
+    entry.prefix = prefix_(key_(entry));
+  }
+  removed_.assign(entries_.size(), 0);
+  removed_count_ = 0;
+}
+
+void document_index_t::merge_() {
+  std::pmr::string keys(allocator_);
+  keys.reserve(keys_.size() + delta_keys_.size());
+  std::pmr::vector<entry_t> entries(allocator_);
+  entries.reserve(size());
+  const auto *main = entries_.data();
+  merge_runs(
+          main, main + entries_.size(), [this](const entry_t &entry) { return key_(entry); },
+          delta_.data(), delta_.data() + delta_.size(), [this](const entry_t &entry) { return delta_key_(entry); },
+          [&](const entry_t &entry, bool is_main) {
+            if (is_main && removed_[static_cast<std::size_t>(&entry - main)] != 0) {
+              return;
+            }
+            auto key = is_main ? key_(entry) : delta_key_(entry);
+            entries.push_back({0, static_cast<uint32_t>(keys.size()), entry.size, entry.id});
+            keys.append(key);
+          }
+  );
+  assert(keys.size() <= max_key_bytes_);
+  delta_keys_.clear();
+  delta_.clear();
+  reset_(std::move(keys), std::move(entries));
+}
+
+document_collection_t::document_collection_t(allocator_type *allocator)
+        : allocator_(allocator),
+          indexes_(allocator),
+          hash_indexes_(allocator) {}
+
+std::size_t document_collection_t::size() const {
+  return documents_.size();
+}
+
+document_ptr document_collection_t::get(id_t id) const {
+  auto it = documents_.find(id);
+  return it == documents_.end() ? nullptr : it->second;
+}
+
+void document_collection_t::set(id_t id, document_ptr document) {
+  auto &stored = documents_[id];
+  for (auto &index : indexes_) {
+    if (stored != nullptr) {
+      index->remove(id, *stored);
+    }
+    index->insert(id, *document);
+  }
+  for (auto &index : hash_indexes_) {
+    if (stored != nullptr) {
+      index->remove(id, *stored);
+    }
+    index->insert(id, *document);
+  }
+  stored = std::move(document);
+}
+
+void document_collection_t::remove(id_t id) {
+  auto it = documents_.find(id);
+  if (it == documents_.end()) {
+    return;
+  }
+  for (auto &index : indexes_) {
+    index->remove(id, *it->second);
+  }
+  for (auto &index : hash_indexes_) {
+    index->remove(id, *it->second);
+  }
+  documents_.erase(it);
+}
+
+const document_index_t *document_collection_t::create_index(std::string_view json_pointer) {
+  if (index(json_pointer) != nullptr) {
+    return nullptr;
+  }
+  indexes_.push_back(std::make_unique<document_index_t>(allocator_, json_pointer));
+  indexes_.back()->build(documents_by_id_());
+  return indexes_.back().get();
+}
+
+const document_index_t *document_collection_t::index(std::string_view json_pointer) const {
+  for (const auto &index : indexes_) {
+    if (index->json_pointer() == json_pointer) {
+      return index.get();
+    }
+  }
+  return nullptr;
+}
+
+const document_hash_index_t *document_collection_t::create_hash_index(std::string_view json_pointer) {
+  if (hash_index(json_pointer) != nullptr) {
+    return nullptr;
+  }
+  hash_indexes_.push_back(std::make_unique<document_hash_index_t>(allocator_, json_pointer));
+  hash_indexes_.back()->build(documents_by_id_());
+  return hash_indexes_.back().get();
+}
+
+const document_hash_index_t *document_collection_t::hash_index(std::string_view json_pointer) const {
+  for (const auto &index : hash_indexes_) {
+    if (index->json_pointer() == json_pointer) {
+      return index.get();
+    }
+  }
+  return nullptr;
+}
+
+std::pmr::vector<std::pair<document_collection_t::id_t, document_ptr>> document_collection_t::documents_by_id_() const {
+  std::pmr::vector<std::pair<id_t, document_ptr>> documents(allocator_);
+  documents.reserve(documents_.size());
+  for (const auto &[id, document] : documents_) {
+    documents.emplace_back(id, document);
+  }
+  return documents;
+}
+
+} // namespace components::document
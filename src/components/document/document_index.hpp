@@ -0,0 +1,126 @@
+#pragma once
+
+#include <components/document/document_hash_index.hpp>
+#include <memory>
+
+namespace components::document {
+
+// Secondary index over the values at one json pointer, ordered by their sort keys
+// (see document_t::sort_key), so numbers of any storage compare by value and every
+// type has a range of its own. Entries are kept in a sorted array searched by
+// interpolation over the first bytes after the prefix all keys share, changes go to a
+// small sorted delta that is merged in once it grows; removals from the array are
+// marked until then. A missing value is indexed too, under its own key.
+class document_index_t {
+public:
+  using allocator_type = std::pmr::memory_resource;
+  using id_t = uint64_t;
+
+  document_index_t(allocator_type *allocator, std::string_view json_pointer);
+
+  std::string_view json_pointer() const;
+
+  std::size_t size() const;
+
+  // Replaces the contents, documents[i] gets id i. A load sorted by the indexed value
+  // is not sorted again.
+  void build(const std::pmr::vector<document_ptr> &documents);
+
+  void build(const std::pmr::vector<std::pair<id_t, document_ptr>> &documents);
+
+  void insert(id_t id, const document_t &document);
+
+  // document must hold the value it was inserted with.
+  void remove(id_t id, const document_t &document);
+
+  // Appends the ids of the documents whose value equals value, ascending.
+  void find(const boost::json::value &value, std::pmr::vector<id_t> &ids) const;
+
+  // Appends the ids of the documents whose value lies between lower and upper, in the
+  // order of the values; nullptr leaves a side open.
+  void find_range(
+          const boost::json::value *lower,
+          bool is_lower_inclusive,
+          const boost::json::value *upper,
+          bool is_upper_inclusive,
+          std::pmr::vector<id_t> &ids
+  ) const;
+
+private:
+  struct entry_t {
+    uint64_t prefix;
+    uint32_t offset;
+    uint32_t size;
+    id_t id;
+  };
+
+  allocator_type *allocator_;
+  std::pmr::string json_pointer_;
+  std::pmr::string keys_;
+  std::pmr::vector<entry_t> entries_;
+  std::pmr::vector<uint8_t> removed_;
+  std::size_t removed_count_;
+  // bytes all keys of entries_ start with, prefixes are taken after them
+  std::size_t common_size_;
+  std::pmr::string delta_keys_;
+  std::pmr::vector<entry_t> delta_;
+  std::pmr::string scratch_;
+
+  // entries address their keys with 32 bits
+  constexpr static std::size_t max_key_bytes_ = UINT32_MAX;
+  constexpr static std::size_t min_delta_size_ = 256;
+
+  std::string_view key_(const entry_t &entry) const;
+
+  std::string_view delta_key_(const entry_t &entry) const;
+
+  uint64_t prefix_(std::string_view key) const;
+
+  // first entry of entries_ not less than key, or greater than key for is_upper
+  std::size_t search_(std::string_view key, bool is_upper) const;
+
+  std::size_t search_delta_(std::string_view key, bool is_upper) const;
+
+  void reset_(std::pmr::string &&keys, std::pmr::vector<entry_t> &&entries);
+
+  void merge_();
+};
+
+// Documents by id with secondary indexes kept up to date on set and remove. A document
+// must not be changed in place while it is in the collection, set it again instead.
+class document_collection_t {
+public:
+  using allocator_type = std::pmr::memory_resource;
+  using id_t = document_index_t::id_t;
+
+  explicit document_collection_t(allocator_type *allocator);
+
+  std::size_t size() const;
+
+  document_ptr get(id_t id) const;
+
+  void set(id_t id, document_ptr document);
+
+  void remove(id_t id);
+
+  // Builds an index over the documents of the collection, nullptr if it exists.
+  const document_index_t *create_index(std::string_view json_pointer);
+
+  // nullptr without an index on json_pointer
+  const document_index_t *index(std::string_view json_pointer) const;
+
+  // The same for equality lookups only.
+  const document_hash_index_t *create_hash_index(std::string_view json_pointer);
+
+  const document_hash_index_t *hash_index(std::string_view json_pointer) const;
+
+private:
+  allocator_type *allocator_;
+  absl::flat_hash_map<id_t, document_ptr> documents_;
+  std::pmr::vector<std::unique_ptr<document_index_t>> indexes_;
+  std::pmr::vector<std::unique_ptr<document_hash_index_t>> hash_indexes_;
+
+  std::pmr::vector<std::pair<id_t, document_ptr>> documents_by_id_() const;
+};
+
+} // namespace components::document
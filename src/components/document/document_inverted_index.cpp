@@ -0,0 +1,351 @@
+#include "document_inverted_index.hpp"
+#include <components/document/document_column.hpp>
+#include <components/document/varint.hpp>
+#include <algorithm>
+#include <numeric>
+
+namespace components::document {
+
+namespace {
+
+using node_t = column_reader_t::node_t;
+
+bool is_upper(char c) {
+  return c >= 'A' && c <= 'Z';
+}
+
+bool is_token_byte(char c) {
+  return static_cast<uint8_t>(c) >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || is_upper(c);
+}
+
+// Calls function(token) for each token of text, a folded token is in scratch.
+template<typename Function>
+void for_each_token(std::string_view text, std::pmr::string &scratch, Function &&function) {
+  std::size_t i = 0;
+  while (i < text.size()) {
+    if (!is_token_byte(text[i])) {
+      ++i;
+      continue;
+    }
+    auto first = i;
+    auto is_folded = false;
+    for (; i < text.size() && is_token_byte(text[i]); ++i) {
+      is_folded |= is_upper(text[i]);
+    }
+    auto token = text.substr(first, i - first);
+    if (!is_folded) {
+      function(token);
+      continue;
+    }
+    scratch.assign(token);
+    for (auto &c : scratch) {
+      if (is_upper(c)) {
+        c = static_cast<char>(c - 'A' + 'a');
+      }
+    }
+    function(std::string_view(scratch));
+  }
+}
+
+template<typename Element, typename Function>
+void visit_string(const Element &element, Function &function) {
+  if (element.is_string()) {
+    function(element.get_string().value());
+  }
+}
+
+// Calls function(string) for each string under node, the views point into the document.
+template<typename Function>
+void visit_strings(const node_t *node, Function &function) {
+  if (node == nullptr) {
+    return;
+  }
+  if (node->is_object()) {
+    for (const auto &it : *node->get_object()) {
+      visit_strings(it.second.get(), function);
+    }
+  } else if (node->is_array()) {
+    for (const auto &it : *node->get_array()) {
+      visit_strings(it.get(), function);
+    }
+  } else if (node->is_first()) {
+    visit_string(*node->get_first(), function);
+  } else if (node->is_second()) {
+    visit_string(*node->get_second(), function);
+  }
+}
+
+} // namespace
+
+// Walks the ids of a postings list. Seeking gallops over the first ids of the blocks
+// after the current one, then decodes the block holding the target.
+class document_inverted_index_t::cursor_t {
+public:
+  cursor_t(const document_inverted_index_t &index, const term_t &term)
+          : postings_(index.postings_.data()),
+            block_(nullptr),
+            end_(index.blocks_.data() + term.first_block + term.blocks),
+            data_(nullptr),
+            left_(0),
+            id_(0) {
+    enter_(index.blocks_.data() + term.first_block);
+  }
+
+  bool is_end() const {
+    return block_ == end_;
+  }
+
+  id_t id() const {
+    return id_;
+  }
+
+  void next() {
+    if (left_ != 0) {
+      id_ += read_varint(data_);
+      --left_;
+    } else {
+      enter_(block_ + 1);
+    }
+  }
+
+  // Moves to the first id not less than target.
+  void seek(id_t target) {
+    if (is_end() || id_ >= target) {
+      return;
+    }
+    auto lower = block_ + 1;
+    if (lower != end_ && lower->first_id <= target) {
+      std::size_t step = 1;
+      while (step < static_cast<std::size_t>(end_ - lower) && lower[step].first_id <= target) {
+        lower += step;
+        step *= 2;
+      }
+      auto upper = lower + std::min(step, static_cast<std::size_t>(end_ - lower));
+      enter_(std::upper_bound(lower + 1, upper, target, [](id_t id, const block_t &block) {
+        return id < block.first_id;
+      }) - 1);
+    }
+    while (!is_end() && id_ < target) {
+      next();
+    }
+  }
+
+private:
+  const char *postings_;
+  const block_t *block_;
+  const block_t *end_;
+  const char *data_;
+  std::size_t left_;
+  id_t id_;
+
+  void enter_(const block_t *block) {
+    block_ = block;
+    if (block_ == end_) {
+      return;
+    }
+    id_ = block_->first_id;
+    data_ = postings_ + block_->offset;
+    left_ = block_->size - 1;
+  }
+};
+
+document_inverted_index_t::document_inverted_index_t(
+        allocator_type *allocator,
+        const std::pmr::vector<std::string_view> &json_pointers
+)
+        : allocator_(allocator),
+          json_pointers_(allocator),
+          term_ids_(allocator),
+          terms_(allocator),
+          blocks_(allocator),
+          postings_(allocator) {
+  for (auto json_pointer : json_pointers) {
+    json_pointers_.emplace_back(json_pointer, allocator);
+  }
+}
+
+std::size_t document_inverted_index_t::size() const {
+  return terms_.size();
+}
+
+std::size_t document_inverted_index_t::postings_bytes() const {
+  return postings_.size() + blocks_.size() * sizeof(block_t);
+}
+
+void document_inverted_index_t::build(const std::pmr::vector<document_ptr> &documents) {
+  std::pmr::vector<std::pair<id_t, document_ptr>> pairs(allocator_);
+  pairs.reserve(documents.size());
+  for (std::size_t i = 0; i < documents.size(); ++i) {
+    pairs.emplace_back(i, documents[i]);
+  }
+  build(pairs);
+}
+
+// Documents are read in id order, so the ids of a term come out ascending; a stable
+// counting sort by term then lays out each postings list in one piece.
+void document_inverted_index_t::build(const std::pmr::vector<std::pair<id_t, document_ptr>> &documents) {
+  term_ids_.clear();
+  terms_.clear();
+  blocks_.clear();
+  postings_.clear();
+
+  std::pmr::vector<std::size_t> order(documents.size(), allocator_);
+  std::iota(order.begin(), order.end(), std::size_t(0));
+  std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+    return documents[lhs].first < documents[rhs].first;
+  });
+
+  std::pmr::vector<std::pair<uint32_t, id_t>> entries(allocator_);
+  std::pmr::vector<uint32_t> document_terms(allocator_);
+  std::pmr::string scratch(allocator_);
+  auto add_token = [&](std::string_view token) {
+    auto it = term_ids_.find(token);
+    if (it == term_ids_.end()) {
+      it = term_ids_.emplace(std::pmr::string(token, allocator_), static_cast<uint32_t>(term_ids_.size())).first;
+    }
+    document_terms.push_back(it->second);
+  };
+  auto add_string = [&](std::string_view string) {
+    for_each_token(string, scratch, add_token);
+  };
+  for (auto i : order) {
+    const auto &[id, document] = documents[i];
+    if (column_reader_t::root(*document) == nullptr) {
+      continue;
+    }
+    document_terms.clear();
+    for (const auto &json_pointer : json_pointers_) {
+      visit_strings(column_reader_t::find(*document, json_pointer), add_string);
+    }
+    std::sort(document_terms.begin(), document_terms.end());
+    document_terms.erase(std::unique(document_terms.begin(), document_terms.end()), document_terms.end());
+    for (auto term : document_terms) {
+      entries.emplace_back(term, id);
+    }
+  }
+
+  std::pmr::vector<std::size_t> starts(term_ids_.size() + 1, 0, allocator_);
+  for (const auto &entry : entries) {
+    ++starts[entry.first + 1];
+  }
+  std::partial_sum(starts.begin(), starts.end(), starts.begin());
+  std::pmr::vector<id_t> ids(entries.size(), allocator_);
+  {
+    std::pmr::vector<std::size_t> next(starts, allocator_);
+    for (const auto &entry : entries) {
+      ids[next[entry.first]++] = entry.second;
+    }
+  }
+
+  terms_.reserve(term_ids_.size());
+  for (std::size_t term = 0; term < term_ids_.size(); ++term) {
+    auto first_block = blocks_.size();
+    for (auto first = starts[term]; first < starts[term + 1]; first += block_size_) {
+      auto last = std::min(first + block_size_, starts[term + 1]);
+      blocks_.push_back({ids[first], static_cast<uint32_t>(postings_.size()), static_cast<uint32_t>(last - first)});
+      for (auto i = first + 1; i < last; ++i) {
+        append_varint(ids[i] - ids[i - 1], postings_);
+      }
+    }
+    terms_.push_back({
+            static_cast<uint32_t>(first_block),
+            static_cast<uint32_t>(blocks_.size() - first_block),
+            static_cast<uint32_t>(starts[term + 1] - starts[term])
+    });
+  }
+}
+
+std::size_t document_inverted_index_t::count(std::string_view token) const {
+  const auto *term = term_(token);
+  return term == nullptr ? 0 : term->count;
+}
+
+// Leapfrog over the lists from the shortest: every cursor seeks the candidate, one
+// that passes it gives the next candidate.
+void document_inverted_index_t::find_all(std::string_view text, std::pmr::vector<id_t> &ids) const {
+  char buffer[1024];
+  std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), allocator_);
+  std::pmr::vector<const term_t *> terms(&resource);
+  if (!terms_of_(text, terms) || terms.empty()) {
+    return;
+  }
+  std::sort(terms.begin(), terms.end(), [](const term_t *lhs, const term_t *rhs) {
+    return lhs->count < rhs->count;
+  });
+  std::pmr::vector<cursor_t> cursors(&resource);
+  cursors.reserve(terms.size());
+  for (const auto *term : terms) {
+    cursors.emplace_back(*this, *term);
+  }
+  while (!cursors.front().is_end()) {
+    auto candidate = cursors.front().id();
+    std::size_t i = 1;
+    for (; i < cursors.size(); ++i) {
+      cursors[i].seek(candidate);
+      if (cursors[i].is_end()) {
+        return;
+      }
+      if (cursors[i].id() != candidate) {
+        break;
+      }
+    }
+    if (i == cursors.size()) {
+      ids.push_back(candidate);
+      cursors.front().next();
+    } else {
+      cursors.front().seek(cursors[i].id());
+    }
+  }
+}
+
+// The lists are merged by scanning the cursors for the least id, queries have few tokens.
+void document_inverted_index_t::find_any(std::string_view text, std::pmr::vector<id_t> &ids) const {
+  char buffer[1024];
+  std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), allocator_);
+  std::pmr::vector<const term_t *> terms(&resource);
+  terms_of_(text, terms);
+  std::pmr::vector<cursor_t> cursors(&resource);
+  cursors.reserve(terms.size());
+  for (const auto *term : terms) {
+    cursors.emplace_back(*this, *term);
+  }
+  for (;;) {
+    const cursor_t *least = nullptr;
+    for (const auto &cursor : cursors) {
+      if (!cursor.is_end() && (least == nullptr || cursor.id() < least->id())) {
+        least = &cursor;
+      }
+    }
+    if (least == nullptr) {
+      return;
+    }
+    auto id = least->id();
+    ids.push_back(id);
+    for (auto &cursor : cursors) {
+      if (!cursor.is_end() && cursor.id() == id) {
+        cursor.next();
+      }
+    }
+  }
+}
+
+const document_inverted_index_t::term_t *document_inverted_index_t::term_(std::string_view token) const {
+  auto it = term_ids_.find(token);
+  return it == term_ids_.end() ? nullptr : &terms_[it->second];
+}
+
+bool document_inverted_index_t::terms_of_(std::string_view text, std::pmr::vector<const term_t *> &terms) const {
+  std::pmr::string scratch(terms.get_allocator().resource());
+  auto is_found = true;
+  for_each_token(text, scratch, [&](std::string_view token) {
+    const auto *term = term_(token);
+    if (term == nullptr) {
+      is_found = false;
+    } else if (std::find(terms.begin(), terms.end(), term) == terms.end()) {
+      terms.push_back(term);
+    }
+  });
+  return is_found;
+}
+
+} // namespace components::document
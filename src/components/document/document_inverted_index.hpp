@@ -0,0 +1,76 @@
+#pragma once
+
+#include <components/document/document.hpp>
+
+namespace components::document {
+
+// Token search over the string leaves under a set of json pointers, a pointer to a
+// container takes every string inside it. A token is a run of ASCII letters and digits
+// and of the bytes of multibyte UTF-8 sequences, ASCII letters are folded to lower
+// case; strings are tokenized in place, only tokens with upper case letters are copied.
+// The postings list of a token holds the ascending ids of the documents containing it
+// as varint deltas, in blocks of block_size_ ids. The first id and the offset of each
+// block are kept aside, a cursor gallops over them and decodes the block it lands in.
+class document_inverted_index_t {
+public:
+  using allocator_type = std::pmr::memory_resource;
+  using id_t = uint64_t;
+
+  document_inverted_index_t(allocator_type *allocator, const std::pmr::vector<std::string_view> &json_pointers);
+
+  // distinct tokens
+  std::size_t size() const;
+
+  // bytes of the encoded postings and of the block table
+  std::size_t postings_bytes() const;
+
+  // Replaces the contents, documents[i] gets id i.
+  void build(const std::pmr::vector<document_ptr> &documents);
+
+  // ids must be distinct.
+  void build(const std::pmr::vector<std::pair<id_t, document_ptr>> &documents);
+
+  // documents containing token, given folded
+  std::size_t count(std::string_view token) const;
+
+  // Appends the ids of the documents containing every token of text, ascending.
+  void find_all(std::string_view text, std::pmr::vector<id_t> &ids) const;
+
+  // Appends the ids of the documents containing any token of text, ascending.
+  void find_any(std::string_view text, std::pmr::vector<id_t> &ids) const;
+
+private:
+  struct block_t {
+    id_t first_id;
+    uint32_t offset;
+    uint32_t size;
+  };
+
+  struct term_t {
+    uint32_t first_block;
+    uint32_t blocks;
+    uint32_t count;
+  };
+
+  class cursor_t;
+
+  allocator_type *allocator_;
+  std::pmr::vector<std::pmr::string> json_pointers_;
+  absl::flat_hash_map<
+          std::pmr::string, uint32_t, string_view_hash, string_view_eq,
+          std::pmr::polymorphic_allocator<std::pair<const std::pmr::string, uint32_t>>
+  > term_ids_;
+  std::pmr::vector<term_t> terms_;
+  std::pmr::vector<block_t> blocks_;
+  std::pmr::string postings_;
+
+  constexpr static std::size_t block_size_ = 128;
+
+  // nullptr for a token no document contains
+  const term_t *term_(std::string_view token) const;
+
+  // The terms of the tokens of text without repeats, false if one is missing.
+  bool terms_of_(std::string_view text, std::pmr::vector<const term_t *> &terms) const;
+};
+
+} // namespace components::document
@@ -0,0 +1,101 @@
+#include "document_path_query.hpp"
+#include <components/document/string_splitter.hpp>
+
+namespace components::document {
+
+path_query_t::path_query_t(allocator_type *allocator)
+        : allocator_(allocator),
+          steps_(allocator),
+          is_valid_(false) {}
+
+error_code_t path_query_t::parse(std::string_view query) {
+  steps_.clear();
+  is_valid_ = false;
+  if (!query.empty() && query[0] != '/') {
+    return error_code_t::INVALID_JSON_POINTER;
+  }
+  if (!query.empty()) {
+    query.remove_prefix(1);
+    for (auto segment : string_splitter(query, '/')) {
+      step_t step{step_kind_t::KEY, std::pmr::string(allocator_), 0, 0, 0, 1, false, false};
+      if (segment == "*") {
+        step.kind = step_kind_t::ANY;
+      } else if (segment == "**") {
+        if (!steps_.empty() && steps_.back().kind == step_kind_t::DESCENDANTS) {
+          continue;
+        }
+        step.kind = step_kind_t::DESCENDANTS;
+      } else if (segment.size() >= 2 && segment.front() == '[' && segment.back() == ']') {
+        step.kind = step_kind_t::SLICE;
+        if (!parse_slice_(segment.substr(1, segment.size() - 2), step)) {
+          steps_.clear();
+          return error_code_t::INVALID_JSON_POINTER;
+        }
+      } else {
+        bool is_unescaped;
+        std::pmr::string unescaped_key(allocator_);
+        auto error = unescape_key_(segment, is_unescaped, unescaped_key, allocator_);
+        if (error != error_code_t::SUCCESS) {
+          steps_.clear();
+          return error;
+        }
+        step.key = is_unescaped ? std::string_view(unescaped_key) : segment;
+        // unlike a json pointer, a key that is no number matches no element: "/**/price"
+        // must not take the first element of every array on the way
+        auto res = std::from_chars(segment.data(), segment.data() + segment.size(), step.index);
+        if (res.ec != std::errc() || res.ptr != segment.data() + segment.size()) {
+          step.index = no_index_;
+        }
+      }
+      steps_.push_back(std::move(step));
+    }
+  }
+  is_valid_ = true;
+  return error_code_t::SUCCESS;
+}
+
+std::size_t path_query_t::count(const document_t &document) const {
+  std::size_t res = 0;
+  for_each(document, [&res](const path_match_t &) {
+    ++res;
+  });
+  return res;
+}
+
+// start:end or start:end:step, each part may be empty
+bool path_query_t::parse_slice_(std::string_view segment, step_t &step) {
+  int64_t *parts[] = {&step.start, &step.end, &step.step};
+  bool *is_set[] = {&step.has_start, &step.has_end, nullptr};
+  std::size_t part = 0;
+  for (auto value : string_splitter(segment, ':')) {
+    if (part == 3) {
+      return false;
+    }
+    if (!value.empty()) {
+      auto res = std::from_chars(value.data(), value.data() + value.size(), *parts[part]);
+      if (res.ec != std::errc() || res.ptr != value.data() + value.size()) {
+        return false;
+      }
+      if (is_set[part] != nullptr) {
+        *is_set[part] = true;
+      }
+    }
+    ++part;
+  }
+  return part >= 2 && step.step > 0;
+}
+
+void path_query_t::append_key_(std::pmr::string &json_pointer, std::string_view key) {
+  json_pointer.push_back('/');
+  for (auto c : key) {
+    if (c == '~') {
+      json_pointer.append("~0");
+    } else if (c == '/') {
+      json_pointer.append("~1");
+    } else {
+      json_pointer.push_back(c);
+    }
+  }
+}
+
+} // namespace components::document
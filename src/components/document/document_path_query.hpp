@@ -0,0 +1,291 @@
+#pragma once
+
+#include <components/document/document_column.hpp>
+#include <algorithm>
+#include <charconv>
+
+namespace components::document {
+
+// A node a path query matched. Valid during the callback only: the json pointer is
+// built in one buffer for the whole walk.
+class path_match_t {
+public:
+  using node_t = column_reader_t::node_t;
+
+  path_match_t(const node_t *node, std::string_view json_pointer, std::string_view key)
+          : node_(node),
+            json_pointer_(json_pointer),
+            key_(key) {}
+
+  // escaped, relative to the document the query ran on
+  std::string_view json_pointer() const {
+    return json_pointer_;
+  }
+
+  // The unescaped key of an object field, the index of an array element, empty for
+  // the root.
+  std::string_view key() const {
+    return key_;
+  }
+
+  bool is_null() const {
+    if (node_->is_first()) {
+      return node_->get_first()->is_null();
+    }
+    if (node_->is_second()) {
+      return node_->get_second()->is_null();
+    }
+    return false;
+  }
+
+  bool is_array() const {
+    return node_->is_array();
+  }
+
+  bool is_dict() const {
+    return node_->is_object();
+  }
+
+  // fields of an object, elements of an array, 0 otherwise
+  std::size_t count() const {
+    if (node_->is_object()) {
+      return node_->get_object()->size();
+    }
+    if (node_->is_array()) {
+      return node_->get_array()->size();
+    }
+    return 0;
+  }
+
+  // As document_t::is_as and document_t::get_as at json_pointer().
+  template<class T>
+  bool is_as() const {
+    if (node_->is_first()) {
+      return node_->get_first()->template is<T>();
+    }
+    if (node_->is_second()) {
+      return node_->get_second()->template is<T>();
+    }
+    return false;
+  }
+
+  template<class T>
+  T get_as() const {
+    if (node_->is_first()) {
+      auto res = node_->get_first()->template get<T>();
+      return res.error() == simdjson::error_code::SUCCESS ? res.value() : T();
+    }
+    if (node_->is_second()) {
+      auto res = node_->get_second()->template get<T>();
+      return res.error() == simdjson::error_code::SUCCESS ? res.value() : T();
+    }
+    return T();
+  }
+
+private:
+  const node_t *node_;
+  std::string_view json_pointer_;
+  std::string_view key_;
+};
+
+// A json pointer whose segments may also be "*", every field of an object and every
+// element of an array; "**", the node itself and every node below it; or an array
+// slice "[start:end]" or "[start:end:step]", where start and end may be left out or
+// count from the end when negative and step is positive. A key takes an array element
+// only if it is a number, unlike in document_t. Keys are unescaped and indexes parsed
+// once by parse(), queries walk the trie of a document and pass each match to a
+// callback without allocating. Adjacent "**" are merged, other queries with several
+// "**" may match a node more than once.
+class path_query_t {
+public:
+  using allocator_type = std::pmr::memory_resource;
+
+  explicit path_query_t(allocator_type *allocator);
+
+  // INVALID_JSON_POINTER for a query not starting with '/', a bad escape or slice.
+  error_code_t parse(std::string_view query);
+
+  // Calls function(const path_match_t &) for each match: array elements in order,
+  // fields in the order of the object, a node before the nodes below it.
+  template<typename Function>
+  void for_each(const document_t &document, Function &&function) const;
+
+  std::size_t count(const document_t &document) const;
+
+private:
+  using node_t = column_reader_t::node_t;
+
+  enum class step_kind_t {
+    KEY,
+    ANY,
+    DESCENDANTS,
+    SLICE,
+  };
+
+  struct step_t {
+    step_kind_t kind;
+    std::pmr::string key;
+    uint32_t index;
+    int64_t start;
+    int64_t end;
+    int64_t step;
+    bool has_start;
+    bool has_end;
+  };
+
+  // past the end of any array
+  constexpr static uint32_t no_index_ = UINT32_MAX;
+
+  allocator_type *allocator_;
+  std::pmr::vector<step_t> steps_;
+  bool is_valid_;
+
+  static bool parse_slice_(std::string_view segment, step_t &step);
+
+  static void append_key_(std::pmr::string &json_pointer, std::string_view key);
+
+  // json_pointer is the path of node, children append to it and cut it back.
+  template<typename Function>
+  void walk_(
+          const node_t *node,
+          std::string_view key,
+          std::size_t step,
+          std::pmr::string &json_pointer,
+          Function &function
+  ) const;
+
+  template<typename Function>
+  void walk_child_(
+          const node_t *node,
+          std::string_view key,
+          std::size_t step,
+          std::pmr::string &json_pointer,
+          Function &function
+  ) const;
+
+  template<typename Function>
+  void walk_element_(
+          const node_t *array,
+          uint32_t index,
+          std::size_t step,
+          std::pmr::string &json_pointer,
+          Function &function
+  ) const;
+};
+
+template<typename Function>
+void path_query_t::for_each(const document_t &document, Function &&function) const {
+  const auto *root = column_reader_t::root(document);
+  if (!is_valid_ || root == nullptr) {
+    return;
+  }
+  char buffer[256];
+  std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), allocator_);
+  std::pmr::string json_pointer(&resource);
+  json_pointer.reserve(sizeof(buffer) / 2);
+  walk_(root, {}, 0, json_pointer, function);
+}
+
+template<typename Function>
+void path_query_t::walk_(
+        const node_t *node,
+        std::string_view key,
+        std::size_t step,
+        std::pmr::string &json_pointer,
+        Function &function
+) const {
+  if (step == steps_.size()) {
+    function(path_match_t(node, json_pointer, key));
+    return;
+  }
+  const auto &current = steps_[step];
+  switch (current.kind) {
+    case step_kind_t::KEY:
+      if (node->is_object()) {
+        const auto *child = node->get_object()->get(std::string_view(current.key));
+        if (child != nullptr) {
+          walk_child_(child, current.key, step + 1, json_pointer, function);
+        }
+      } else if (node->is_array()) {
+        walk_element_(node, current.index, step + 1, json_pointer, function);
+      }
+      break;
+    case step_kind_t::ANY:
+    case step_kind_t::DESCENDANTS: {
+      // a descent continues below every child with the same step
+      auto next = current.kind == step_kind_t::ANY ? step + 1 : step;
+      if (current.kind == step_kind_t::DESCENDANTS) {
+        walk_(node, key, step + 1, json_pointer, function);
+      }
+      if (node->is_object()) {
+        for (const auto &it : *node->get_object()) {
+          walk_child_(it.second.get(), it.first, next, json_pointer, function);
+        }
+      } else if (node->is_array()) {
+        for (uint32_t i = 0; i < node->get_array()->size(); ++i) {
+          walk_element_(node, i, next, json_pointer, function);
+        }
+      }
+      break;
+    }
+    case step_kind_t::SLICE: {
+      if (!node->is_array()) {
+        break;
+      }
+      auto size = static_cast<int64_t>(node->get_array()->size());
+      auto bound = [size](int64_t value) {
+        return std::clamp(value < 0 ? value + size : value, int64_t(0), size);
+      };
+      auto end = current.has_end ? bound(current.end) : size;
+      // stops before the next index passes end, a large step must not overflow
+      for (auto i = current.has_start ? bound(current.start) : 0; i < end; i += current.step) {
+        walk_element_(node, static_cast<uint32_t>(i), step + 1, json_pointer, function);
+        if (end - i <= current.step) {
+          break;
+        }
+      }
+      break;
+    }
+  }
+}
+
+template<typename Function>
+void path_query_t::walk_child_(
+        const node_t *node,
+        std::string_view key,
+        std::size_t step,
+        std::pmr::string &json_pointer,
+        Function &function
+) const {
+  if (node->is_deleter()) {
+    return;
+  }
+  auto size = json_pointer.size();
+  append_key_(json_pointer, key);
+  walk_(node, key, step, json_pointer, function);
+  json_pointer.resize(size);
+}
+
+template<typename Function>
+void path_query_t::walk_element_(
+        const node_t *array,
+        uint32_t index,
+        std::size_t step,
+        std::pmr::string &json_pointer,
+        Function &function
+) const {
+  const auto *element = array->get_array()->get(index);
+  if (element == nullptr || element->is_deleter()) {
+    return;
+  }
+  auto size = json_pointer.size();
+  char digits[16];
+  auto digits_end = std::to_chars(digits, digits + sizeof(digits), index).ptr;
+  json_pointer.push_back('/');
+  json_pointer.append(digits, digits_end);
+  // the key is a view of the pointer, only read before anything is appended
+  walk_(element, std::string_view(json_pointer).substr(size + 1), step, json_pointer, function);
+  json_pointer.resize(size);
+}
+
+} // namespace components::document
@@ -0,0 +1,461 @@
+#include "document_predicate.hpp"
+#include <cmath>
+
+namespace components::document {
+
+namespace {
+
+constexpr int not_comparable = 2;
+
+template<typename T>
+int three_way(T value1, T value2) {
+  return int(value1 > value2) - int(value1 < value2);
+}
+
+template<typename Literal>
+int compare_double(double value, const Literal &literal) {
+  if (literal.type != value_type_t::NUMBER) {
+    return not_comparable;
+  }
+  auto number = literal.is_integer ? static_cast<double>(literal.integer) : literal.number;
+  if (std::isnan(value) || std::isnan(number)) {
+    return not_comparable;
+  }
+  return three_way(value, number);
+}
+
+template<typename Literal>
+int compare_integer(__int128_t value, const Literal &literal) {
+  if (literal.type != value_type_t::NUMBER) {
+    return not_comparable;
+  }
+  if (literal.is_integer) {
+    return three_way(value, literal.integer);
+  }
+  return compare_double(static_cast<double>(value), literal);
+}
+
+template<typename Element, typename Literal>
+int compare_literal(const Element &element, const Literal &literal) {
+  using simdjson::dom::element_type;
+
+  switch (element.type()) {
+    case element_type::INT8:
+    case element_type::INT16:
+    case element_type::INT32:
+    case element_type::INT64:
+      return compare_integer(element.get_int64().value(), literal);
+    case element_type::INT128:
+      return compare_integer(element.get_int128().value(), literal);
+    case element_type::UINT8:
+    case element_type::UINT16:
+    case element_type::UINT32:
+    case element_type::UINT64:
+      return compare_integer(element.get_uint64().value(), literal);
+    case element_type::FLOAT:
+    case element_type::DOUBLE:
+      return compare_double(element.get_double().value(), literal);
+    case element_type::STRING:
+      if (literal.type != value_type_t::STRING) {
+        return not_comparable;
+      }
+      return three_way(element.get_string().value(), std::string_view(literal.string));
+    case element_type::BOOL:
+      if (literal.type != value_type_t::BOOL) {
+        return not_comparable;
+      }
+      return three_way(element.get_bool().value(), literal.boolean);
+    case element_type::NULL_VALUE:
+      return literal.type == value_type_t::NULL_VALUE ? 0 : not_comparable;
+  }
+  return not_comparable;
+}
+
+template<typename Set>
+bool is_integer_in(__int128_t value, const Set &set) {
+  return std::binary_search(set.integers.begin(), set.integers.end(), value) ||
+         std::binary_search(set.doubles.begin(), set.doubles.end(), static_cast<double>(value));
+}
+
+template<typename Element, typename Set>
+bool is_in(const Element &element, const Set &set) {
+  using simdjson::dom::element_type;
+
+  switch (element.type()) {
+    case element_type::INT8:
+    case element_type::INT16:
+    case element_type::INT32:
+    case element_type::INT64:
+      return is_integer_in(element.get_int64().value(), set);
+    case element_type::INT128:
+      return is_integer_in(element.get_int128().value(), set);
+    case element_type::UINT8:
+    case element_type::UINT16:
+    case element_type::UINT32:
+    case element_type::UINT64:
+      return is_integer_in(element.get_uint64().value(), set);
+    case element_type::FLOAT:
+    case element_type::DOUBLE:
+      return std::binary_search(set.numbers.begin(), set.numbers.end(), element.get_double().value());
+    case element_type::STRING:
+      return set.strings.contains(element.get_string().value());
+    case element_type::BOOL:
+      return element.get_bool().value() ? set.has_true : set.has_false;
+    case element_type::NULL_VALUE:
+      return set.has_null;
+  }
+  return false;
+}
+
+template<typename Element>
+value_type_t type_of(const Element &element) {
+  using simdjson::dom::element_type;
+
+  switch (element.type()) {
+    case element_type::STRING:
+      return value_type_t::STRING;
+    case element_type::BOOL:
+      return value_type_t::BOOL;
+    case element_type::NULL_VALUE:
+      return value_type_t::NULL_VALUE;
+    default:
+      return value_type_t::NUMBER;
+  }
+}
+
+template<typename Node, typename Function>
+bool visit_leaf(const Node *node, Function &&function) {
+  if (node->is_first()) {
+    return function(*node->get_first());
+  }
+  if (node->is_second()) {
+    return function(*node->get_second());
+  }
+  return false;
+}
+
+} // namespace
+
+predicate_t::predicate_t(allocator_type *allocator)
+        : allocator_(allocator),
+          expressions_(allocator),
+          paths_(allocator),
+          literals_(allocator),
+          sets_(allocator),
+          program_(allocator),
+          entry_(reject_) {}
+
+predicate_t::id_t predicate_t::compare(std::string_view json_pointer, compare_op_t op, const boost::json::value &value) {
+  auto id = add_expression_(kind_t::COMPARE, json_pointer);
+  expressions_[id].op = op;
+  expressions_[id].operand = static_cast<uint32_t>(literals_.size());
+  literals_.push_back(make_literal_(value));
+  return id;
+}
+
+predicate_t::id_t predicate_t::in(std::string_view json_pointer, const boost::json::array &values) {
+  auto id = add_expression_(kind_t::IN, json_pointer);
+  expressions_[id].operand = static_cast<uint32_t>(sets_.size());
+  set_t set{
+          std::pmr::vector<__int128_t>(allocator_),
+          std::pmr::vector<double>(allocator_),
+          std::pmr::vector<double>(allocator_),
+          std::pmr::vector<std::pmr::string>(allocator_),
+          {},
+          false,
+          false,
+          false
+  };
+  set.string_values.reserve(values.size());
+  for (const auto &value : values) {
+    auto literal = make_literal_(value);
+    switch (literal.type) {
+      case value_type_t::NUMBER:
+        if (literal.is_integer) {
+          set.integers.push_back(literal.integer);
+          set.numbers.push_back(static_cast<double>(literal.integer));
+        } else if (!std::isnan(literal.number)) {
+          set.doubles.push_back(literal.number);
+          set.numbers.push_back(literal.number);
+        }
+        break;
+      case value_type_t::STRING:
+        set.string_values.push_back(std::move(literal.string));
+        set.strings.insert(set.string_values.back());
+        break;
+      case value_type_t::BOOL:
+        (literal.boolean ? set.has_true : set.has_false) = true;
+        break;
+      case value_type_t::NULL_VALUE:
+        set.has_null = true;
+        break;
+      default:
+        break;
+    }
+  }
+  std::sort(set.integers.begin(), set.integers.end());
+  std::sort(set.doubles.begin(), set.doubles.end());
+  std::sort(set.numbers.begin(), set.numbers.end());
+  sets_.push_back(std::move(set));
+  return id;
+}
+
+predicate_t::id_t predicate_t::exists(std::string_view json_pointer) {
+  return add_expression_(kind_t::EXISTS, json_pointer);
+}
+
+predicate_t::id_t predicate_t::is_type(std::string_view json_pointer, value_type_t type) {
+  auto id = add_expression_(kind_t::IS_TYPE, json_pointer);
+  expressions_[id].type = type;
+  return id;
+}
+
+predicate_t::id_t predicate_t::logical_and(const std::pmr::vector<id_t> &operands) {
+  return add_connective_(kind_t::AND, operands);
+}
+
+predicate_t::id_t predicate_t::logical_or(const std::pmr::vector<id_t> &operands) {
+  return add_connective_(kind_t::OR, operands);
+}
+
+predicate_t::id_t predicate_t::logical_not(id_t operand) {
+  return add_connective_(kind_t::NOT, std::pmr::vector<id_t>({operand}, allocator_));
+}
+
+// Steps are emitted from the last one to test to the first, so that every target
+// is known when a step is emitted, and reversed at the end.
+void predicate_t::compile(id_t root) {
+  program_.clear();
+  entry_ = compile_(root, accept_, reject_);
+  std::reverse(program_.begin(), program_.end());
+  auto last = static_cast<uint32_t>(program_.size()) - 1;
+  for (auto &step : program_) {
+    for (auto &next : step.next) {
+      if (next < reject_) {
+        next = last - next;
+      }
+    }
+  }
+  if (entry_ < reject_) {
+    entry_ = last - entry_;
+  }
+}
+
+bool predicate_t::match(const document_t &document) const {
+  std::pmr::vector<slot_t> slots(paths_.size(), allocator_);
+  return match_(column_reader_t::root(document), slots);
+}
+
+void predicate_t::filter(const std::pmr::vector<document_ptr> &documents, selection_t &selection) const {
+  std::pmr::vector<slot_t> slots(paths_.size(), allocator_);
+  selection.reset(documents.size());
+  for (std::size_t i = 0; i < documents.size(); ++i) {
+    if (match_(column_reader_t::root(*documents[i]), slots)) {
+      selection.set(i);
+    }
+  }
+}
+
+uint32_t predicate_t::add_path_(std::string_view json_pointer) {
+  for (std::size_t i = 0; i < paths_.size(); ++i) {
+    if (paths_[i].json_pointer == json_pointer) {
+      return static_cast<uint32_t>(i);
+    }
+  }
+  path_t path{
+          std::pmr::string(json_pointer, allocator_),
+          std::pmr::vector<path_segment_t>(allocator_),
+          false
+  };
+  path.is_valid = split_json_pointer(json_pointer, path.segments);
+  paths_.push_back(std::move(path));
+  return static_cast<uint32_t>(paths_.size() - 1);
+}
+
+predicate_t::literal_t predicate_t::make_literal_(const boost::json::value &value) const {
+  literal_t literal{value_type_t::NULL_VALUE, false, false, 0, 0, std::pmr::string(allocator_)};
+  switch (value.kind()) {
+    case boost::json::kind::null:
+      break;
+    case boost::json::kind::bool_:
+      literal.type = value_type_t::BOOL;
+      literal.boolean = value.get_bool();
+      break;
+    case boost::json::kind::int64:
+      literal.type = value_type_t::NUMBER;
+      literal.is_integer = true;
+      literal.integer = value.get_int64();
+      break;
+    case boost::json::kind::uint64:
+      literal.type = value_type_t::NUMBER;
+      literal.is_integer = true;
+      literal.integer = value.get_uint64();
+      break;
+    case boost::json::kind::double_:
+      literal.type = value_type_t::NUMBER;
+      literal.number = value.get_double();
+      break;
+    case boost::json::kind::string:
+      literal.type = value_type_t::STRING;
+      literal.string = std::string_view(value.get_string());
+      break;
+    case boost::json::kind::array:
+      literal.type = value_type_t::ARRAY;
+      break;
+    case boost::json::kind::object:
+      literal.type = value_type_t::DICT;
+      break;
+  }
+  return literal;
+}
+
+predicate_t::id_t predicate_t::add_expression_(kind_t kind, std::string_view json_pointer) {
+  expressions_.push_back({
+          kind,
+          compare_op_t::EQUALS,
+          value_type_t::NULL_VALUE,
+          add_path_(json_pointer),
+          0,
+          std::pmr::vector<id_t>(allocator_)
+  });
+  return static_cast<id_t>(expressions_.size() - 1);
+}
+
+predicate_t::id_t predicate_t::add_connective_(kind_t kind, const std::pmr::vector<id_t> &operands) {
+  expressions_.push_back({
+          kind,
+          compare_op_t::EQUALS,
+          value_type_t::NULL_VALUE,
+          0,
+          0,
+          std::pmr::vector<id_t>(operands, allocator_)
+  });
+  return static_cast<id_t>(expressions_.size() - 1);
+}
+
+std::size_t predicate_t::cost_(id_t id) const {
+  const auto &expression = expressions_[id];
+  switch (expression.kind) {
+    case kind_t::EXISTS:
+    case kind_t::IS_TYPE:
+      return 1;
+    case kind_t::COMPARE:
+      return 2;
+    case kind_t::IN:
+      return 3;
+    case kind_t::NOT:
+      return cost_(expression.operands.front());
+    case kind_t::AND:
+    case kind_t::OR: {
+      std::size_t res = 0;
+      for (auto operand : expression.operands) {
+        res += cost_(operand);
+      }
+      return res;
+    }
+  }
+  return 0;
+}
+
+void predicate_t::flatten_(id_t id, kind_t kind, std::pmr::vector<id_t> &operands) const {
+  for (auto operand : expressions_[id].operands) {
+    if (expressions_[operand].kind == kind) {
+      flatten_(operand, kind, operands);
+    } else {
+      operands.push_back(operand);
+    }
+  }
+}
+
+uint32_t predicate_t::compile_(id_t id, uint32_t on_true, uint32_t on_false) {
+  const auto &expression = expressions_[id];
+  switch (expression.kind) {
+    case kind_t::NOT:
+      return compile_(expression.operands.front(), on_false, on_true);
+    case kind_t::AND:
+    case kind_t::OR: {
+      auto is_and = expression.kind == kind_t::AND;
+      std::pmr::vector<id_t> operands(allocator_);
+      flatten_(id, expression.kind, operands);
+      std::stable_sort(operands.begin(), operands.end(), [this](id_t id1, id_t id2) {
+        return cost_(id1) < cost_(id2);
+      });
+      auto next = is_and ? on_true : on_false;
+      for (auto it = operands.rbegin(); it != operands.rend(); ++it) {
+        next = is_and ? compile_(*it, next, on_false) : compile_(*it, on_true, next);
+      }
+      return next;
+    }
+    default:
+      program_.push_back({id, expression.path, {on_false, on_true}});
+      return static_cast<uint32_t>(program_.size() - 1);
+  }
+}
+
+const predicate_t::node_t *predicate_t::resolve_(const node_t *root, uint32_t path) const {
+  const auto &resolved = paths_[path];
+  if (root == nullptr || !resolved.is_valid) {
+    return nullptr;
+  }
+  const auto *current = root;
+  for (const auto &segment : resolved.segments) {
+    if (current->is_object()) {
+      current = current->get_object()->get(segment.key);
+    } else if (current->is_array()) {
+      current = current->get_array()->get(segment.index);
+    } else {
+      return nullptr;
+    }
+    if (current == nullptr) {
+      return nullptr;
+    }
+  }
+  return current;
+}
+
+bool predicate_t::evaluate_(const expression_t &term, const node_t *node) const {
+  if (node == nullptr) {
+    return false;
+  }
+  switch (term.kind) {
+    case kind_t::EXISTS:
+      return true;
+    case kind_t::IS_TYPE:
+      if (node->is_array()) {
+        return term.type == value_type_t::ARRAY;
+      }
+      if (node->is_object()) {
+        return term.type == value_type_t::DICT;
+      }
+      return visit_leaf(node, [&term](const auto &element) {
+        return type_of(element) == term.type;
+      });
+    case kind_t::COMPARE:
+      return visit_leaf(node, [&](const auto &element) {
+        auto res = compare_literal(element, literals_[term.operand]);
+        return res != not_comparable && is_accepted(term.op, static_cast<compare_t>(res));
+      });
+    case kind_t::IN:
+      return visit_leaf(node, [&](const auto &element) {
+        return is_in(element, sets_[term.operand]);
+      });
+    default:
+      return false;
+  }
+}
+
+bool predicate_t::match_(const node_t *root, std::pmr::vector<slot_t> &slots) const {
+  std::fill(slots.begin(), slots.end(), slot_t{nullptr, false});
+  auto current = entry_;
+  while (current < reject_) {
+    const auto &step = program_[current];
+    auto &slot = slots[step.path];
+    if (!slot.is_resolved) {
+      slot = {resolve_(root, step.path), true};
+    }
+    current = step.next[evaluate_(expressions_[step.term], slot.node)];
+  }
+  return current == accept_;
+}
+
+} // namespace components::document
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <components/document/document_column.hpp>
+#include <absl/container/flat_hash_set.h>
+
+namespace components::document {
+
+enum class value_type_t {
+  NULL_VALUE,
+  BOOL,
+  NUMBER,
+  STRING,
+  ARRAY,
+  DICT,
+};
+
+// Filter over documents. Terms and connectives are added first, each returns an id the
+// connectives take; compile() then flattens the expression rooted at one id into a
+// program: json pointers are split into unescaped keys once, the operands of AND and OR
+// are tested cheapest first, and each step names the step to take on true and on false.
+// Terms on the same json pointer share one lookup per document.
+class predicate_t {
+public:
+  using allocator_type = std::pmr::memory_resource;
+  using id_t = uint32_t;
+
+  explicit predicate_t(allocator_type *allocator);
+
+  // Numbers compare by value whatever their storage, strings byte-wise, bools and nulls
+  // with their own kind only. Fails for a missing value or one of another kind.
+  id_t compare(std::string_view json_pointer, compare_op_t op, const boost::json::value &value);
+
+  // Equals one of values, with the rules of compare.
+  id_t in(std::string_view json_pointer, const boost::json::array &values);
+
+  id_t exists(std::string_view json_pointer);
+
+  id_t is_type(std::string_view json_pointer, value_type_t type);
+
+  id_t logical_and(const std::pmr::vector<id_t> &operands);
+
+  id_t logical_or(const std::pmr::vector<id_t> &operands);
+
+  id_t logical_not(id_t operand);
+
+  void compile(id_t root);
+
+  bool match(const document_t &document) const;
+
+  void filter(const std::pmr::vector<document_ptr> &documents, selection_t &selection) const;
+
+private:
+  using node_t = column_reader_t::node_t;
+
+  enum class kind_t {
+    COMPARE,
+    IN,
+    EXISTS,
+    IS_TYPE,
+    AND,
+    OR,
+    NOT,
+  };
+
+  struct path_t {
+    std::pmr::string json_pointer;
+    std::pmr::vector<path_segment_t> segments;
+    bool is_valid;
+  };
+
+  struct literal_t {
+    value_type_t type;
+    bool boolean;
+    bool is_integer;
+    __int128_t integer;
+    double number;
+    std::pmr::string string;
+  };
+
+  struct set_t {
+    std::pmr::vector<__int128_t> integers;
+    std::pmr::vector<double> doubles;
+    // every number of the set as a double
+    std::pmr::vector<double> numbers;
+    // views into string_values, reserved up front so that they stay put
+    std::pmr::vector<std::pmr::string> string_values;
+    absl::flat_hash_set<std::string_view> strings;
+    bool has_null;
+    bool has_false;
+    bool has_true;
+  };
+
+  struct expression_t {
+    kind_t kind;
+    compare_op_t op;
+    value_type_t type;
+    uint32_t path;
+    uint32_t operand;
+    std::pmr::vector<id_t> operands;
+  };
+
+  // next[false], next[true]: the step to take, accept_ and reject_ end the program
+  struct step_t {
+    id_t term;
+    uint32_t path;
+    uint32_t next[2];
+  };
+
+  struct slot_t {
+    const node_t *node;
+    bool is_resolved;
+  };
+
+  constexpr static uint32_t accept_ = UINT32_MAX;
+  constexpr static uint32_t reject_ = UINT32_MAX - 1;
+
+  allocator_type *allocator_;
+  std::pmr::vector<expression_t> expressions_;
+  std::pmr::vector<path_t> paths_;
+  std::pmr::vector<literal_t> literals_;
+  std::pmr::vector<set_t> sets_;
+  std::pmr::vector<step_t> program_;
+  uint32_t entry_;
+
+  uint32_t add_path_(std::string_view json_pointer);
+
+  literal_t make_literal_(const boost::json::value &value) const;
+
+  id_t add_expression_(kind_t kind, std::string_view json_pointer);
+
+  id_t add_connective_(kind_t kind, const std::pmr::vector<id_t> &operands);
+
+  std::size_t cost_(id_t id) const;
+
+  void flatten_(id_t id, kind_t kind, std::pmr::vector<id_t> &operands) const;
+
+  uint32_t compile_(id_t id, uint32_t on_true, uint32_t on_false);
+
+  const node_t *resolve_(const node_t *root, uint32_t path) const;
+
+  bool evaluate_(const expression_t &term, const node_t *node) const;
+
+  bool match_(const node_t *root, std::pmr::vector<slot_t> &slots) const;
+};
+
+} // namespace components::document
@@ -0,0 +1,429 @@
+#include "document_shredder.hpp"
+
+namespace components::document {
+
+shredded_column_t::shredded_column_t(std::pmr::memory_resource *allocator)
+        : path(allocator),
+          max_repetition_level(0),
+          repetition_levels(allocator),
+          definition_levels(allocator),
+          valid(allocator),
+          types(allocator),
+          values(allocator),
+          wide_integers(allocator),
+          string_data(allocator),
+          string_offsets(1, 0, allocator) {}
+
+double shredded_column_t::get_double(std::size_t value) const {
+  using simdjson::dom::element_type;
+
+  auto payload = values[value];
+  switch (types[value]) {
+    case element_type::INT8:
+    case element_type::INT16:
+    case element_type::INT32:
+    case element_type::INT64:
+      return static_cast<double>(static_cast<int64_t>(payload));
+    case element_type::INT128:
+      return static_cast<double>(wide_integers[payload]);
+    case element_type::FLOAT:
+    case element_type::DOUBLE: {
+      double res;
+      std::memcpy(&res, &payload, sizeof(res));
+      return res;
+    }
+    default:
+      return static_cast<double>(payload);
+  }
+}
+
+std::string_view shredded_column_t::get_string(std::size_t value) const {
+  auto index = values[value];
+  return {string_data.data() + string_offsets[index], string_offsets[index + 1] - string_offsets[index]};
+}
+
+shredded_batch_t::shredded_batch_t(std::pmr::memory_resource *allocator)
+        : size(0),
+          columns(allocator) {}
+
+namespace {
+
+using node_t = column_reader_t::node_t;
+
+constexpr uint32_t no_column = UINT32_MAX;
+
+bool kind_of(const node_t *node, shred_kind_t &kind) {
+  if (node->is_object()) {
+    kind = shred_kind_t::OBJECT;
+  } else if (node->is_array()) {
+    kind = shred_kind_t::ARRAY;
+  } else if (node->is_first() || node->is_second()) {
+    kind = shred_kind_t::VALUE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+template<typename Element>
+void append_value(const Element &element, shredded_column_t &column) {
+  using simdjson::dom::element_type;
+
+  auto type = element.type();
+  uint64_t payload = 0;
+  switch (type) {
+    case element_type::INT8:
+    case element_type::INT16:
+    case element_type::INT32:
+    case element_type::INT64:
+      payload = static_cast<uint64_t>(element.get_int64().value());
+      break;
+    case element_type::UINT8:
+    case element_type::UINT16:
+    case element_type::UINT32:
+    case element_type::UINT64:
+      payload = element.get_uint64().value();
+      break;
+    case element_type::INT128:
+      payload = column.wide_integers.size();
+      column.wide_integers.push_back(element.get_int128().value());
+      break;
+    case element_type::FLOAT:
+    case element_type::DOUBLE: {
+      auto value = element.get_double().value();
+      std::memcpy(&payload, &value, sizeof(payload));
+      break;
+    }
+    case element_type::STRING: {
+      payload = column.string_offsets.size() - 1;
+      column.string_data.append(element.get_string().value());
+      column.string_offsets.push_back(static_cast<uint32_t>(column.string_data.size()));
+      break;
+    }
+    case element_type::BOOL:
+      payload = element.get_bool().value();
+      break;
+    case element_type::NULL_VALUE:
+      break;
+  }
+  column.types.push_back(type);
+  column.values.push_back(payload);
+}
+
+// The schema is a tree of steps, the root is the document object. Columns are numbered
+// in preorder so that the columns of a step are [first_column, last_column).
+class shredder_t {
+public:
+  shredder_t(std::pmr::memory_resource *allocator, shredded_batch_t &batch)
+          : allocator_(allocator),
+            batch_(batch),
+            nodes_(allocator),
+            children_(allocator),
+            scratch_(allocator) {
+    nodes_.push_back(schema_node_t{shred_kind_t::OBJECT, std::pmr::string(allocator), 0, 0, 0, std::pmr::vector<uint32_t>(allocator), 0, 0, no_column});
+  }
+
+  void add(uint32_t schema, const node_t *node) {
+    if (node->is_object()) {
+      for (const auto &it : *node->get_object()) {
+        shred_kind_t kind;
+        if (kind_of(it.second.get(), kind)) {
+          add(child_(schema, kind, it.first), it.second.get());
+        }
+      }
+    } else if (node->is_array() && node->get_array()->size() != 0) {
+      auto element = child_(schema, shred_kind_t::ELEMENT, {});
+      for (const auto &it : *node->get_array()) {
+        shred_kind_t kind;
+        if (kind_of(it.get(), kind)) {
+          add(child_(element, kind, {}), it.get());
+        }
+      }
+    }
+  }
+
+  void number_columns(uint32_t schema) {
+    auto &node = nodes_[schema];
+    node.first_column = static_cast<uint32_t>(batch_.columns.size());
+    if (node.children.empty()) {
+      node.column = node.first_column;
+      batch_.columns.emplace_back(allocator_);
+      auto &column = batch_.columns.back();
+      column.max_repetition_level = node.repetition_level;
+      column.path.resize(node.definition_level, shred_step_t{shred_kind_t::VALUE, std::pmr::string(allocator_)});
+      for (auto step = schema; step != 0; step = nodes_[step].parent) {
+        const auto &step_node = nodes_[step];
+        column.path[step_node.definition_level - 1] = {step_node.kind, step_node.key};
+      }
+    }
+    for (std::size_t i = 0; i < nodes_[schema].children.size(); ++i) {
+      number_columns(nodes_[schema].children[i]);
+    }
+    nodes_[schema].last_column = static_cast<uint32_t>(batch_.columns.size());
+  }
+
+  // node exists and is of the kind of schema
+  void write(uint32_t schema, const node_t *node, uint16_t repetition_level) {
+    const auto &schema_node = nodes_[schema];
+    if (schema_node.column != no_column) {
+      auto &column = batch_.columns[schema_node.column];
+      column.repetition_levels.push_back(repetition_level);
+      column.definition_levels.push_back(schema_node.definition_level);
+      if (node->is_first()) {
+        append_value(*node->get_first(), column);
+      } else if (node->is_second()) {
+        append_value(*node->get_second(), column);
+      }
+      return;
+    }
+    if (schema_node.kind == shred_kind_t::OBJECT) {
+      const auto *object = node->get_object();
+      for (auto child : schema_node.children) {
+        const auto &child_node = nodes_[child];
+        const auto *field = object->get(child_node.key);
+        shred_kind_t kind;
+        if (field != nullptr && kind_of(field, kind) && kind == child_node.kind) {
+          write(child, field, repetition_level);
+        } else {
+          write_missing(child, repetition_level, schema_node.definition_level);
+        }
+      }
+      return;
+    }
+    // an array, the only child is its element
+    auto element = schema_node.children.front();
+    const auto &element_node = nodes_[element];
+    const auto *array = node->get_array();
+    if (array->size() == 0) {
+      return write_missing(element, repetition_level, schema_node.definition_level);
+    }
+    for (const auto &it : *array) {
+      for (auto child : element_node.children) {
+        shred_kind_t kind;
+        if (kind_of(it.get(), kind) && kind == nodes_[child].kind) {
+          write(child, it.get(), repetition_level);
+        } else {
+          write_missing(child, repetition_level, element_node.definition_level);
+        }
+      }
+      repetition_level = element_node.repetition_level;
+    }
+  }
+
+  void write_missing(uint32_t schema, uint16_t repetition_level, uint16_t definition_level) {
+    const auto &schema_node = nodes_[schema];
+    for (auto i = schema_node.first_column; i < schema_node.last_column; ++i) {
+      batch_.columns[i].repetition_levels.push_back(repetition_level);
+      batch_.columns[i].definition_levels.push_back(definition_level);
+    }
+  }
+
+private:
+  struct schema_node_t {
+    shred_kind_t kind;
+    std::pmr::string key;
+    uint32_t parent;
+    uint16_t definition_level;
+    uint16_t repetition_level;
+    std::pmr::vector<uint32_t> children;
+    uint32_t first_column;
+    uint32_t last_column;
+    uint32_t column;
+  };
+
+  std::pmr::memory_resource *allocator_;
+  shredded_batch_t &batch_;
+  std::pmr::vector<schema_node_t> nodes_;
+  absl::flat_hash_map<
+          std::pmr::string, uint32_t, string_view_hash, string_view_eq,
+          std::pmr::polymorphic_allocator<std::pair<const std::pmr::string, uint32_t>>
+  > children_;
+  std::pmr::string scratch_;
+
+  uint32_t child_(uint32_t parent, shred_kind_t kind, std::string_view key) {
+    scratch_.assign(reinterpret_cast<const char *>(&parent), sizeof(parent));
+    scratch_.push_back(static_cast<char>(kind));
+    scratch_.append(key);
+    auto it = children_.find(std::string_view(scratch_));
+    if (it != children_.end()) {
+      return it->second;
+    }
+    auto child = static_cast<uint32_t>(nodes_.size());
+    auto is_repeated = kind == shred_kind_t::ELEMENT;
+    nodes_.push_back({
+            kind,
+            std::pmr::string(key, allocator_),
+            parent,
+            static_cast<uint16_t>(nodes_[parent].definition_level + 1),
+            static_cast<uint16_t>(nodes_[parent].repetition_level + is_repeated),
+            std::pmr::vector<uint32_t>(allocator_),
+            0,
+            0,
+            no_column
+    });
+    nodes_[parent].children.push_back(child);
+    children_.emplace(scratch_, child);
+    return child;
+  }
+};
+
+void append_escaped_key(std::string_view key, std::pmr::string &json_pointer) {
+  json_pointer.push_back('/');
+  for (auto c : key) {
+    if (c == '~') {
+      json_pointer.append("~0");
+    } else if (c == '/') {
+      json_pointer.append("~1");
+    } else {
+      json_pointer.push_back(c);
+    }
+  }
+}
+
+void set_value(document_t &document, std::string_view json_pointer, const shredded_column_t &column, std::size_t value) {
+  using simdjson::dom::element_type;
+
+  auto payload = column.values[value];
+  switch (column.types[value]) {
+    case element_type::INT8:
+      document.set(json_pointer, static_cast<int8_t>(payload));
+      break;
+    case element_type::INT16:
+      document.set(json_pointer, static_cast<int16_t>(payload));
+      break;
+    case element_type::INT32:
+      document.set(json_pointer, static_cast<int32_t>(payload));
+      break;
+    case element_type::INT64:
+      document.set(json_pointer, static_cast<int64_t>(payload));
+      break;
+    case element_type::INT128:
+      document.set(json_pointer, column.wide_integers[payload]);
+      break;
+    case element_type::UINT8:
+      document.set(json_pointer, static_cast<uint8_t>(payload));
+      break;
+    case element_type::UINT16:
+      document.set(json_pointer, static_cast<uint16_t>(payload));
+      break;
+    case element_type::UINT32:
+      document.set(json_pointer, static_cast<uint32_t>(payload));
+      break;
+    case element_type::UINT64:
+      document.set(json_pointer, payload);
+      break;
+    case element_type::FLOAT:
+      document.set(json_pointer, static_cast<float>(column.get_double(value)));
+      break;
+    case element_type::DOUBLE:
+      document.set(json_pointer, column.get_double(value));
+      break;
+    case element_type::STRING:
+      document.set(json_pointer, column.get_string(value));
+      break;
+    case element_type::BOOL:
+      document.set(json_pointer, payload != 0);
+      break;
+    case element_type::NULL_VALUE:
+      document.set_null(json_pointer);
+      break;
+  }
+}
+
+// Replays the entries of one column. Containers are created where they do not exist
+// yet, an element whose kind another column holds gets a null until that column is
+// replayed; elements are created in order, as each column has an entry for each one.
+void assemble_column(const shredded_column_t &column, std::pmr::vector<document_ptr> &documents) {
+  auto allocator = documents.get_allocator().resource();
+  std::pmr::vector<uint32_t> indices(column.max_repetition_level + 1, 0, allocator);
+  std::pmr::string json_pointer(allocator);
+  std::size_t document = 0;
+  std::size_t value = 0;
+  for (std::size_t entry = 0; entry < column.definition_levels.size(); ++entry) {
+    auto repetition_level = column.repetition_levels[entry];
+    auto definition_level = column.definition_levels[entry];
+    if (entry != 0 && repetition_level == 0) {
+      ++document;
+    }
+    if (repetition_level != 0) {
+      ++indices[repetition_level];
+    }
+    std::fill(indices.begin() + repetition_level + 1, indices.end(), 0);
+
+    auto &target = *documents[document];
+    json_pointer.clear();
+    uint16_t element_level = 0;
+    for (std::size_t step = 0; step < definition_level; ++step) {
+      const auto &path_step = column.path[step];
+      auto is_element_kind = step != 0 && column.path[step - 1].kind == shred_kind_t::ELEMENT;
+      if (path_step.kind == shred_kind_t::ELEMENT) {
+        json_pointer.push_back('/');
+        json_pointer.append(std::to_string(indices[++element_level]));
+        if (!target.is_exists(json_pointer)) {
+          target.set_null(json_pointer);
+        }
+        continue;
+      }
+      if (!is_element_kind) {
+        append_escaped_key(path_step.key, json_pointer);
+      }
+      if (path_step.kind == shred_kind_t::OBJECT && !target.is_dict(json_pointer)) {
+        target.set_dict(json_pointer);
+      } else if (path_step.kind == shred_kind_t::ARRAY && !target.is_array(json_pointer)) {
+        target.set_array(json_pointer);
+      } else if (path_step.kind == shred_kind_t::VALUE) {
+        set_value(target, json_pointer, column, value++);
+      }
+    }
+  }
+}
+
+} // namespace
+
+void shred_documents(const std::pmr::vector<document_ptr> &documents, shredded_batch_t &batch) {
+  auto allocator = batch.columns.get_allocator().resource();
+  batch.size = documents.size();
+  batch.columns.clear();
+  shredder_t shredder(allocator, batch);
+  for (const auto &document : documents) {
+    const auto *root = column_reader_t::root(*document);
+    if (root != nullptr) {
+      shredder.add(0, root);
+    }
+  }
+  shredder.number_columns(0);
+  for (const auto &document : documents) {
+    const auto *root = column_reader_t::root(*document);
+    if (root != nullptr) {
+      shredder.write(0, root, 0);
+    } else {
+      shredder.write_missing(0, 0, 0);
+    }
+  }
+  for (auto &column : batch.columns) {
+    auto size = column.definition_levels.size();
+    column.valid.reset(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      if (column.definition_levels[i] == column.path.size()) {
+        column.valid.set(i);
+      }
+    }
+  }
+}
+
+std::pmr::vector<document_ptr> assemble_documents(
+        const shredded_batch_t &batch,
+        std::pmr::memory_resource *allocator
+) {
+  std::pmr::vector<document_ptr> documents(allocator);
+  documents.reserve(batch.size);
+  for (std::size_t i = 0; i < batch.size; ++i) {
+    documents.push_back(make_document(allocator));
+  }
+  for (const auto &column : batch.columns) {
+    assemble_column(column, documents);
+  }
+  return documents;
+}
+
+} // namespace components::document
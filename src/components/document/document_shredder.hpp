@@ -0,0 +1,70 @@
+#pragma once
+
+#include <components/document/document_column.hpp>
+
+namespace components::document {
+
+enum class shred_kind_t : uint8_t {
+  OBJECT,
+  ARRAY,
+  // an element of the enclosing array, the repeated step
+  ELEMENT,
+  VALUE,
+};
+
+// A step of a column path. After an ELEMENT step a step tells the kind of the element,
+// otherwise the kind of the value at key of the enclosing object.
+struct shred_step_t {
+  shred_kind_t kind;
+  std::pmr::string key;
+};
+
+// One leaf of the schema of a batch, the union of the documents: a primitive value, or
+// an object or array that has no fields or elements in any document. Every document has
+// an entry for each repetition of the arrays on the path, as in Dremel: the definition
+// level counts the steps of the path that exist, the repetition level is the number of
+// ELEMENT steps up to the array a new element is started in, 0 starts a document.
+struct shredded_column_t {
+  explicit shredded_column_t(std::pmr::memory_resource *allocator);
+
+  std::pmr::vector<shred_step_t> path;
+  uint16_t max_repetition_level;
+  std::pmr::vector<uint16_t> repetition_levels;
+  std::pmr::vector<uint16_t> definition_levels;
+  // entries whose definition level is path.size()
+  selection_t valid;
+
+  // One per valid entry of a VALUE column, the element type and a payload: signed and
+  // unsigned integers as 64 bits, float and double as double bits, bools as 0 or 1.
+  // int128 values and strings are indices into wide_integers and string_offsets.
+  std::pmr::vector<simdjson::dom::element_type> types;
+  std::pmr::vector<uint64_t> values;
+  std::pmr::vector<__int128_t> wide_integers;
+  std::pmr::string string_data;
+  // string i is string_data[string_offsets[i], string_offsets[i + 1])
+  std::pmr::vector<uint32_t> string_offsets;
+
+  // Numeric value i as a double.
+  double get_double(std::size_t value) const;
+
+  std::string_view get_string(std::size_t value) const;
+};
+
+struct shredded_batch_t {
+  explicit shredded_batch_t(std::pmr::memory_resource *allocator);
+
+  std::size_t size;
+  std::pmr::vector<shredded_column_t> columns;
+};
+
+// Splits documents into columns, the columns of a subtree are adjacent. Objects are
+// described by their fields, so an invalid document shreds as an empty one.
+void shred_documents(const std::pmr::vector<document_ptr> &documents, shredded_batch_t &batch);
+
+// Rebuilds the documents of a batch, values keep their element types.
+std::pmr::vector<document_ptr> assemble_documents(
+        const shredded_batch_t &batch,
+        std::pmr::memory_resource *allocator
+);
+
+} // namespace components::document
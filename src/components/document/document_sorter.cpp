@@ -0,0 +1,190 @@
+#include "document_sorter.hpp"
+#include <components/document/parallel.hpp>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace components::document {
+
+namespace {
+
+struct sort_entry_t {
+  std::uint64_t prefix;
+  const char *key;
+  std::uint32_t size;
+  std::uint32_t index;
+};
+
+constexpr std::size_t radix_threshold = 1 << 12;
+
+// the index breaks ties, so every path below gives the same stable order
+bool entry_less(const sort_entry_t &entry1, const sort_entry_t &entry2) {
+  if (entry1.prefix != entry2.prefix) {
+    return entry1.prefix < entry2.prefix;
+  }
+  auto res = std::memcmp(entry1.key, entry2.key, std::min(entry1.size, entry2.size));
+  if (res != 0) {
+    return res < 0;
+  }
+  if (entry1.size != entry2.size) {
+    return entry1.size < entry2.size;
+  }
+  return entry1.index < entry2.index;
+}
+
+// Per column: a byte placing nulls first or last, then the value key, inverted
+// for descending order. The value keys are prefix-free, so are the inverted ones.
+void append_document_key(
+        const document_ptr &document,
+        const std::pmr::vector<sort_column_t> &columns,
+        std::pmr::string &key,
+        std::pmr::string &scratch
+) {
+  for (const auto &column : columns) {
+    scratch.clear();
+    document->append_sort_key(column.json_pointer, scratch);
+    auto tag = static_cast<sort_key_tag_t>(scratch.front());
+    if (tag == sort_key_tag_t::NULL_VALUE || tag == sort_key_tag_t::MISSING) {
+      key.push_back(column.nulls == nulls_order_t::FIRST ? '\0' : '\2');
+      continue;
+    }
+    key.push_back('\1');
+    if (column.order == sort_order_t::DESCENDING) {
+      for (auto &c : scratch) {
+        c = static_cast<char>(~c);
+      }
+    }
+    key.append(scratch);
+  }
+}
+
+std::uint64_t key_prefix(const char *key, std::size_t size) {
+  std::uint64_t res = 0;
+  for (std::size_t i = 0; i < sizeof(res); ++i) {
+    res = (res << 8) | (i < size ? static_cast<unsigned char>(key[i]) : 0);
+  }
+  return res;
+}
+
+// LSD radix sort on the prefixes, bytes all entries share are skipped. Runs of
+// equal prefixes are finished by comparison.
+void radix_sort(sort_entry_t *first, sort_entry_t *last, sort_entry_t *buffer) {
+  auto size = static_cast<std::size_t>(last - first);
+  auto *from = first;
+  auto *to = buffer;
+  for (int shift = 0; shift < 64; shift += 8) {
+    std::size_t counts[256] = {};
+    for (auto it = from; it != from + size; ++it) {
+      ++counts[(it->prefix >> shift) & 0xff];
+    }
+    if (counts[(from->prefix >> shift) & 0xff] == size) {
+      continue;
+    }
+    std::size_t offset = 0;
+    for (auto &count : counts) {
+      auto next = offset + count;
+      count = offset;
+      offset = next;
+    }
+    for (auto it = from; it != from + size; ++it) {
+      to[counts[(it->prefix >> shift) & 0xff]++] = *it;
+    }
+    std::swap(from, to);
+  }
+  if (from != first) {
+    std::copy(from, from + size, first);
+  }
+  for (auto it = first; it != last;) {
+    auto run = std::find_if(it, last, [it](const sort_entry_t &entry) { return entry.prefix != it->prefix; });
+    if (run - it > 1) {
+      std::sort(it, run, entry_less);
+    }
+    it = run;
+  }
+}
+
+void sort_chunk(sort_entry_t *first, sort_entry_t *last, sort_entry_t *buffer) {
+  if (static_cast<std::size_t>(last - first) >= radix_threshold) {
+    radix_sort(first, last, buffer);
+  } else {
+    std::sort(first, last, entry_less);
+  }
+}
+
+} // namespace
+
+void sort_documents(
+        std::pmr::vector<document_ptr> &documents,
+        const std::pmr::vector<sort_column_t> &columns,
+        std::size_t threads
+) {
+  auto size = documents.size();
+  if (size < 2 || columns.empty()) {
+    return;
+  }
+  auto allocator = documents.get_allocator().resource();
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::min(threads, (size + radix_threshold - 1) / radix_threshold);
+  // reads must not materialize lazily from several threads
+  for (auto &document : documents) {
+    document->materialize();
+  }
+
+  // chunk i covers [bounds[i], bounds[i + 1]), keys go to a buffer of its own
+  std::pmr::vector<std::size_t> bounds(threads + 1, allocator);
+  for (std::size_t i = 0; i <= threads; ++i) {
+    bounds[i] = size * i / threads;
+  }
+  std::pmr::vector<sort_entry_t> entries(size, allocator);
+  std::pmr::vector<sort_entry_t> buffer(size, allocator);
+  std::vector<std::pmr::monotonic_buffer_resource> resources(threads);
+  std::vector<std::pmr::string> keys;
+  keys.reserve(threads);
+  for (auto &resource : resources) {
+    keys.emplace_back(&resource);
+  }
+
+  run_parallel(threads, [&](std::size_t chunk) {
+    auto &key = keys[chunk];
+    std::pmr::string scratch(&resources[chunk]);
+    for (auto i = bounds[chunk]; i < bounds[chunk + 1]; ++i) {
+      auto offset = key.size();
+      append_document_key(documents[i], columns, key, scratch);
+      // the offset is kept in place of the prefix until the buffer stops growing
+      entries[i] = {offset, nullptr, static_cast<std::uint32_t>(key.size() - offset), static_cast<std::uint32_t>(i)};
+    }
+    for (auto i = bounds[chunk]; i < bounds[chunk + 1]; ++i) {
+      entries[i].key = key.data() + entries[i].prefix;
+      entries[i].prefix = key_prefix(entries[i].key, entries[i].size);
+    }
+    sort_chunk(entries.data() + bounds[chunk], entries.data() + bounds[chunk + 1], buffer.data() + bounds[chunk]);
+  });
+
+  // pairwise merges of the sorted chunks, the merges of a round run in parallel
+  for (std::size_t width = 1; width < threads; width *= 2) {
+    auto merges = (threads + 2 * width - 1) / (2 * width);
+    run_parallel(merges, [&](std::size_t merge) {
+      auto first = bounds[std::min(2 * merge * width, threads)];
+      auto middle = bounds[std::min((2 * merge + 1) * width, threads)];
+      auto last = bounds[std::min((2 * merge + 2) * width, threads)];
+      std::merge(
+              entries.data() + first, entries.data() + middle,
+              entries.data() + middle, entries.data() + last,
+              buffer.data() + first,
+              entry_less
+      );
+      std::copy(buffer.data() + first, buffer.data() + last, entries.data() + first);
+    });
+  }
+
+  std::pmr::vector<document_ptr> sorted(allocator);
+  sorted.reserve(size);
+  for (const auto &entry : entries) {
+    sorted.push_back(std::move(documents[entry.index]));
+  }
+  documents = std::move(sorted);
+}
+
+} // namespace components::document
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <components/document/document.hpp>
+
+namespace components::document {
+
+enum class sort_order_t {
+  ASCENDING,
+  DESCENDING,
+};
+
+// Where documents with a null or missing value go, regardless of the order.
+enum class nulls_order_t {
+  FIRST,
+  LAST,
+};
+
+struct sort_column_t {
+  std::string_view json_pointer;
+  sort_order_t order = sort_order_t::ASCENDING;
+  nulls_order_t nulls = nulls_order_t::LAST;
+};
+
+// Stable sort by several columns. The sort key of every document is extracted
+// once into a contiguous buffer and the sort runs over fixed-size entries holding
+// the first bytes of the key; large inputs are radix sorted on them. With
+// threads > 1 (0 is one per core) extraction and sorting are split into chunks
+// that are merged at the end.
+void sort_documents(
+        std::pmr::vector<document_ptr> &documents,
+        const std::pmr::vector<sort_column_t> &columns,
+        std::size_t threads = 1
+);
+
+} // namespace components::document
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace components::document {
+
+// splitmix64 finalizer
+static inline std::size_t hash_mix(std::uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+// Order-dependent, for arrays.
+static inline std::size_t hash_combine(std::size_t seed, std::size_t value) {
+  return hash_mix(seed + 0x9e3779b97f4a7c15ULL + value);
+}
+
+static inline std::uint64_t hash_mum(std::uint64_t x, std::uint64_t y) {
+  auto product = static_cast<__uint128_t>(x) * y;
+  return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+}
+
+template<typename T>
+static inline std::uint64_t hash_read(const char *data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+// wyhash-style, 16 bytes per step, the tail is read with overlapping loads.
+static inline std::size_t hash_bytes(std::string_view bytes) {
+  constexpr std::uint64_t p0 = 0xa0761d6478bd642fULL;
+  constexpr std::uint64_t p1 = 0xe7037ed1a0b428dbULL;
+  constexpr std::uint64_t p2 = 0x8ebc6af09c88c6e3ULL;
+
+  auto data = bytes.data();
+  auto size = bytes.size();
+  std::uint64_t seed = p0 ^ size;
+  for (; size > 16; data += 16, size -= 16) {
+    seed = hash_mum(hash_read<std::uint64_t>(data) ^ p1, hash_read<std::uint64_t>(data + 8) ^ seed);
+  }
+  std::uint64_t x = 0;
+  std::uint64_t y = 0;
+  if (size >= 8) {
+    x = hash_read<std::uint64_t>(data);
+    y = hash_read<std::uint64_t>(data + size - 8);
+  } else if (size >= 4) {
+    x = hash_read<std::uint32_t>(data);
+    y = hash_read<std::uint32_t>(data + size - 4);
+  } else if (size > 0) {
+    x = (static_cast<std::uint64_t>(static_cast<unsigned char>(data[0])) << 16) |
+        (static_cast<std::uint64_t>(static_cast<unsigned char>(data[size >> 1])) << 8) |
+        static_cast<unsigned char>(data[size - 1]);
+  }
+  return hash_mum(p2 ^ bytes.size(), hash_mum(x ^ p1, y ^ seed));
+}
+
+} // namespace components::document
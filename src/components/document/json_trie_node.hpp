@@ -3,6 +3,7 @@
 #include <components/document/base.hpp>
 #include <allocator_intrusive_ref_counter.hpp>
 #include <mr_utils.hpp>
+#include <components/document/hash.hpp>
 #include "container/json_object.hpp"
 #include "container/json_array.hpp"
 
@@ -23,6 +24,10 @@ public:
 
   json_trie_node<FirstType, SecondType> *make_deep_copy() const;
 
+  json_trie_node<FirstType, SecondType> *make_shallow_copy() const;
+
+  bool is_shared() const noexcept;
+
   bool is_object() const noexcept;
 
   bool is_array() const noexcept;
@@ -45,6 +50,8 @@ public:
 
   json_object<FirstType, SecondType> *as_object();
 
+  SecondType *as_second();
+
   std::pmr::string to_json(
           std::pmr::string (*)(const FirstType *, std::pmr::memory_resource *),
           std::pmr::string (*)(const SecondType *, std::pmr::memory_resource *)
@@ -57,12 +64,35 @@ public:
           bool (*)(const FirstType *, const SecondType *)
   ) const;
 
+  // Structural hash, cached until the node is modified through as_object()/as_array().
+  // Leaf hashers flag values that compare with a tolerance (floating point), the
+  // subtrees holding them are never told apart by their hashes in equals(). The
+  // cache is written through const, concurrent calls on a shared node race.
+  std::size_t hash(
+          std::size_t (*)(const FirstType *, bool &),
+          std::size_t (*)(const SecondType *, bool &)
+  ) const;
+
+  // Marks a node held by a view. Pins do not count as sharing, a view does not
+  // make its parent copy the node on the next write.
+  void pin() noexcept;
+
+  void unpin() noexcept;
+
   static json_trie_node<FirstType, SecondType> *merge(
           json_trie_node<FirstType, SecondType> *node1,
           json_trie_node<FirstType, SecondType> *node2,
           allocator_type *allocator
   );
 
+  static json_trie_node<FirstType, SecondType> *merge(
+          json_trie_node<FirstType, SecondType> *base,
+          const std::pmr::vector<json_trie_node<FirstType, SecondType> *> &layers,
+          allocator_type *allocator
+  );
+
+  static void make_unique(boost::intrusive_ptr<json_trie_node<FirstType, SecondType>> &node);
+
   static json_trie_node<FirstType, SecondType> *create(FirstType value, allocator_type *allocator);
 
   static json_trie_node<FirstType, SecondType> *create(SecondType value, allocator_type *allocator);
@@ -107,6 +137,22 @@ private:
     DELETER,
   } type_;
 
+  enum hash_state : uint8_t {
+    NO_HASH,
+    EXACT_HASH,
+    INEXACT_HASH,
+  };
+
+  mutable std::size_t hash_value_;
+  mutable hash_state hash_state_;
+  uint32_t pins_;
+
+  std::size_t hash_(
+          std::size_t (*)(const FirstType *, bool &),
+          std::size_t (*)(const SecondType *, bool &),
+          bool &is_inexact
+  ) const;
+
   template<typename T>
   json_trie_node(allocator_type *allocator, T &&value, json_type type) noexcept;
 
@@ -122,7 +168,10 @@ json_trie_node<FirstType, SecondType>::json_trie_node(
 ) noexcept
         : allocator_(allocator),
           value_(std::forward<T>(value)),
-          type_(type) {}
+          type_(type),
+          hash_value_(0),
+          hash_state_(NO_HASH),
+          pins_(0) {}
 
 template<typename FirstType, typename SecondType>
 json_trie_node<FirstType, SecondType>::json_trie_node(
@@ -131,7 +180,10 @@ json_trie_node<FirstType, SecondType>::json_trie_node(
 ) noexcept
         : allocator_(allocator),
           value_(),
-          type_(type) {}
+          type_(type),
+          hash_value_(0),
+          hash_state_(NO_HASH),
+          pins_(0) {}
 
 template<typename FirstType, typename SecondType>
 json_trie_node<FirstType, SecondType>::~json_trie_node() {
@@ -156,7 +208,10 @@ template<typename FirstType, typename SecondType>
 json_trie_node<FirstType, SecondType>::json_trie_node(json_trie_node &&other) noexcept
         : allocator_(other.allocator_),
           value_(std::move(other.value_)),
-          type_(other.type_) {
+          type_(other.type_),
+          hash_value_(other.hash_value_),
+          hash_state_(other.hash_state_),
+          pins_(other.pins_) {
   other.allocator_ = nullptr;
 }
 
@@ -166,10 +221,29 @@ json_trie_node<FirstType, SecondType>::make_deep_copy() const {
   switch (type_) {
     case OBJECT:
       return new(allocator_->allocate(sizeof(json_trie_node)))
-      json_trie_node(allocator_, std::move(*value_.obj.make_deep_copy()), OBJECT);
+      json_trie_node(allocator_, value_.obj.make_deep_copy(), OBJECT);
+    case ARRAY:
+      return new(allocator_->allocate(sizeof(json_trie_node)))
+      json_trie_node(allocator_, value_.arr.make_deep_copy(), ARRAY);
+    case FIRST:
+      return create(value_.first, allocator_);
+    case SECOND:
+      return create(value_.second, allocator_);
+    case DELETER:
+      return create_deleter(allocator_);
+  }
+}
+
+template<typename FirstType, typename SecondType>
+json_trie_node<FirstType, SecondType> *
+json_trie_node<FirstType, SecondType>::make_shallow_copy() const {
+  switch (type_) {
+    case OBJECT:
+      return new(allocator_->allocate(sizeof(json_trie_node)))
+      json_trie_node(allocator_, value_.obj.make_copy(), OBJECT);
     case ARRAY:
       return new(allocator_->allocate(sizeof(json_trie_node)))
-      json_trie_node(allocator_, std::move(*value_.arr.make_deep_copy()), ARRAY);
+      json_trie_node(allocator_, value_.arr.make_copy(), ARRAY);
     case FIRST:
       return create(value_.first, allocator_);
     case SECOND:
@@ -179,6 +253,11 @@ json_trie_node<FirstType, SecondType>::make_deep_copy() const {
   }
 }
 
+template<typename FirstType, typename SecondType>
+bool json_trie_node<FirstType, SecondType>::is_shared() const noexcept {
+  return this->use_count() > 1 + pins_;
+}
+
 
 template<typename FirstType, typename SecondType>
 bool json_trie_node<FirstType, SecondType>::is_first() const noexcept {
@@ -239,14 +318,21 @@ const json_object<FirstType, SecondType> *json_trie_node<FirstType, SecondType>:
 
 template<typename FirstType, typename SecondType>
 json_array<FirstType, SecondType> *json_trie_node<FirstType, SecondType>::as_array() {
+  hash_state_ = NO_HASH;
   return const_cast<json_array<FirstType, SecondType> *>(get_array());
 }
 
 template<typename FirstType, typename SecondType>
 json_object<FirstType, SecondType> *json_trie_node<FirstType, SecondType>::as_object() {
+  hash_state_ = NO_HASH;
   return const_cast<json_object<FirstType, SecondType> *>(get_object());
 }
 
+template<typename FirstType, typename SecondType>
+SecondType *json_trie_node<FirstType, SecondType>::as_second() {
+  return const_cast<SecondType *>(get_second());
+}
+
 template<typename FirstType, typename SecondType>
 std::pmr::string
 json_trie_node<FirstType, SecondType>::to_json(
@@ -274,6 +360,16 @@ bool json_trie_node<FirstType, SecondType>::equals(
         bool (* second_equals_second)(const SecondType *, const SecondType *),
         bool (* first_equals_second)(const FirstType *, const SecondType *)
 ) const {
+  if (this == other) {
+    return true;
+  }
+  if (
+          hash_state_ == EXACT_HASH &&
+          other->hash_state_ == EXACT_HASH &&
+          hash_value_ != other->hash_value_
+  ) {
+    return false;
+  }
   if (type_ != other->type_) {
     if (type_ == FIRST && other->type_ == SECOND) {
       return first_equals_second(&value_.first, &other->value_.second);
@@ -297,6 +393,71 @@ bool json_trie_node<FirstType, SecondType>::equals(
   }
 }
 
+template<typename FirstType, typename SecondType>
+std::size_t json_trie_node<FirstType, SecondType>::hash(
+        std::size_t (*hash_first)(const FirstType *, bool &),
+        std::size_t (*hash_second)(const SecondType *, bool &)
+) const {
+  bool is_inexact = false;
+  return hash_(hash_first, hash_second, is_inexact);
+}
+
+template<typename FirstType, typename SecondType>
+void json_trie_node<FirstType, SecondType>::pin() noexcept {
+  ++pins_;
+}
+
+template<typename FirstType, typename SecondType>
+void json_trie_node<FirstType, SecondType>::unpin() noexcept {
+  --pins_;
+}
+
+// Object entries are summed so that the hash does not depend on the map order.
+template<typename FirstType, typename SecondType>
+std::size_t json_trie_node<FirstType, SecondType>::hash_(
+        std::size_t (*hash_first)(const FirstType *, bool &),
+        std::size_t (*hash_second)(const SecondType *, bool &),
+        bool &is_inexact
+) const {
+  using components::document::hash_combine;
+  using components::document::hash_mix;
+
+  if (hash_state_ != NO_HASH) {
+    is_inexact |= hash_state_ == INEXACT_HASH;
+    return hash_value_;
+  }
+  bool is_node_inexact = false;
+  std::size_t res = 0;
+  switch (type_) {
+    case OBJECT:
+      for (auto &it : value_.obj) {
+        auto value = it.second->hash_(hash_first, hash_second, is_node_inexact);
+        res += hash_combine(components::document::hash_bytes(it.first), value);
+      }
+      res = hash_combine(OBJECT, res);
+      break;
+    case ARRAY:
+      res = ARRAY;
+      for (auto &it : value_.arr) {
+        res = hash_combine(res, it->hash_(hash_first, hash_second, is_node_inexact));
+      }
+      break;
+    case FIRST:
+      res = hash_first(&value_.first, is_node_inexact);
+      break;
+    case SECOND:
+      res = hash_second(&value_.second, is_node_inexact);
+      break;
+    case DELETER:
+      res = hash_mix(DELETER);
+      break;
+  }
+  hash_value_ = res;
+  hash_state_ = is_node_inexact ? INEXACT_HASH : EXACT_HASH;
+  is_inexact |= is_node_inexact;
+  return res;
+}
+
 template<typename FirstType, typename SecondType>
 json_trie_node<FirstType, SecondType> *
 json_trie_node<FirstType, SecondType>::merge(
@@ -309,13 +470,61 @@ json_trie_node<FirstType, SecondType>::merge(
   }
   auto res = create_object(allocator);
   if (node1->is_object()) {
-    res->value_.obj = std::move(*json_object<FirstType, SecondType>::merge(node1->value_.obj, node2->value_.obj, allocator));
+    res->value_.obj = json_object<FirstType, SecondType>::merge(node1->value_.obj, node2->value_.obj, allocator);
   } else {
-    res->value_.obj = std::move(*node1->value_.obj.make_copy_except_deleter(allocator));
+    res->value_.obj = node2->value_.obj.make_copy_except_deleter(allocator);
   }
   return res;
 }
 
+// Same result as merging the layers on top of base one by one, nullptr when the last
+// tombstone leaves nothing. Only the trailing run of objects has to be merged, the
+// layer before it is the value they are merged onto. Nothing is built when the
+// result is one of the inputs.
+template<typename FirstType, typename SecondType>
+json_trie_node<FirstType, SecondType> *
+json_trie_node<FirstType, SecondType>::merge(
+        json_trie_node<FirstType, SecondType> *base,
+        const std::pmr::vector<json_trie_node<FirstType, SecondType> *> &layers,
+        allocator_type *allocator
+) {
+  auto first = layers.size();
+  while (first > 0 && layers[first - 1]->is_object()) {
+    --first;
+  }
+  auto res = base;
+  if (first > 0) {
+    res = layers[first - 1]->is_deleter() ? nullptr : layers[first - 1];
+  }
+  if (res == nullptr && first < layers.size()) {
+    res = layers[first++];
+  }
+  if (first == layers.size()) {
+    return res;
+  }
+  std::pmr::vector<const json_object<FirstType, SecondType> *> objects(allocator);
+  objects.reserve(layers.size() - first);
+  for (; first < layers.size(); ++first) {
+    objects.push_back(&layers[first]->value_.obj);
+  }
+  auto merged = create_object(allocator);
+  merged->value_.obj = json_object<FirstType, SecondType>::merge(
+          res->is_object() ? &res->value_.obj : nullptr,
+          objects,
+          allocator
+  );
+  return merged;
+}
+
+// Path copying: a container reachable from more than one place is replaced by
+// a private copy that still shares all of its children.
+template<typename FirstType, typename SecondType>
+void json_trie_node<FirstType, SecondType>::make_unique(boost::intrusive_ptr<json_trie_node<FirstType, SecondType>> &node) {
+  if (node->is_shared() && (node->is_object() || node->is_array())) {
+    node = node->make_shallow_copy();
+  }
+}
+
 template<typename FirstType, typename SecondType>
 json_trie_node<FirstType, SecondType> *
 json_trie_node<FirstType, SecondType>::create(FirstType value, json_trie_node::allocator_type *allocator) {
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace components::document {
+
+// Calls function(i) for i in [0, tasks), each on a thread of its own; one task runs inline.
+template<typename Function>
+static inline void run_parallel(std::size_t tasks, Function &&function) {
+  if (tasks == 1) {
+    function(0);
+    return;
+  }
+  std::vector<std::thread> workers;
+  workers.reserve(tasks);
+  for (std::size_t i = 0; i < tasks; ++i) {
+    workers.emplace_back(function, i);
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+} // namespace components::document
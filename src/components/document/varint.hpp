@@ -3,6 +3,8 @@
 #include <cmath>
 #include <cstdint>
 #include <limits>
+#include <memory_resource>
+#include <string>
 
 namespace components::document {
 
@@ -12,4 +14,25 @@ static inline bool is_equals(T x, T y) {
   return std::fabs(x - y) < std::numeric_limits<T>::epsilon();
 }
 
+// LEB128: 7 bits per byte, low groups first, the high bit marks a following byte.
+static inline void append_varint(uint64_t value, std::pmr::string &out) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+// Reads a value written by append_varint and moves data past it.
+static inline uint64_t read_varint(const char *&data) {
+  uint64_t res = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    auto byte = static_cast<uint8_t>(*data++);
+    res |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return res;
+    }
+  }
+}
+
 } // namespace components::document
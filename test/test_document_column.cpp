@@ -0,0 +1,203 @@
+#include <catch2/catch_test_macros.hpp>
+#include <components/document/document_column.hpp>
+#include <cmath>
+#include <random>
+
+using namespace components::document;
+
+TEST_CASE("select") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  for (int i = 0; i < 200; ++i) {
+    auto document = document_t::document_from_json(R"({"a": 0})", allocator);
+    if (i % 7 == 0) {
+      document->set("/count", std::string_view("none"));
+    } else if (i % 11 == 0) {
+      document->set("/count", double(i) + 0.5);
+    } else if (i % 13 != 0) {
+      document->set("/count", int32_t(i * 5));
+    }
+    documents.push_back(document);
+  }
+
+  selection_t selection(allocator);
+  select<int64_t>(documents, "/count", compare_op_t::MORE, 500, selection);
+  REQUIRE(selection.size() == 200);
+  std::size_t expected = 0;
+  for (std::size_t i = 0; i < documents.size(); ++i) {
+    auto is_selected = documents[i]->is_int("/count") && documents[i]->get_int("/count") > 500;
+    REQUIRE(selection.test(i) == is_selected);
+    expected += is_selected;
+  }
+  REQUIRE(selection.count() == expected);
+
+  document_column_t<double> column(allocator);
+  gather_column(documents, "/count", column);
+  select(column, compare_op_t::LESS_EQUALS, 11.5, selection);
+  REQUIRE(selection.count() == 3);
+  REQUIRE(selection.test(1));
+  REQUIRE(selection.test(2));
+  REQUIRE(selection.test(11));
+  select(column, compare_op_t::EQUALS, 187.5, selection);
+  REQUIRE(selection.count() == 1);
+  REQUIRE(selection.test(187));
+
+  select<std::string_view>(documents, "/count", compare_op_t::EQUALS, "none", selection);
+  REQUIRE(selection.count() == 29);
+  selection.flip();
+  REQUIRE(selection.count() == 171);
+  REQUIRE_FALSE(selection.test(0));
+  REQUIRE(selection.test(1));
+}
+
+TEST_CASE("select_compare") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  std::mt19937 random(42);
+  for (int i = 0; i < 500; ++i) {
+    auto document = document_t::document_from_json(R"({"a": 0})", allocator);
+    switch (random() % 6) {
+      case 0:
+        document->set("/value", int64_t(random() % 50));
+        break;
+      case 1:
+        document->set("/value", int32_t(random() % 50));
+        break;
+      case 2:
+        document->set("/value", double(random() % 50) / 2);
+        break;
+      case 3:
+        document->set("/value", std::to_string(random() % 50));
+        break;
+      case 4:
+        document->set_null("/value");
+        break;
+      default:
+        break;
+    }
+    documents.push_back(document);
+  }
+
+  std::pmr::vector<document_ptr> others(allocator);
+  for (auto json : {
+          R"({"value": 25})",
+          R"({"value": 12.5})",
+          R"({"value": "3"})",
+          R"({"value": null})",
+          R"({"value": [1]})",
+          R"({"b": 1})"
+  }) {
+    others.push_back(document_t::document_from_json(json, allocator));
+  }
+  others.push_back(documents[0]);
+  others.push_back(documents[1]);
+  others.push_back(documents[2]);
+
+  selection_t selection(allocator);
+  for (const auto &other : others) {
+    for (auto op : {
+            compare_op_t::EQUALS,
+            compare_op_t::NOT_EQUALS,
+            compare_op_t::LESS,
+            compare_op_t::LESS_EQUALS,
+            compare_op_t::MORE,
+            compare_op_t::MORE_EQUALS
+    }) {
+      select_compare(documents, *other, "/value", op, selection);
+      for (std::size_t i = 0; i < documents.size(); ++i) {
+        auto res = documents[i]->compare(*other, "/value");
+        auto is_selected = (op == compare_op_t::EQUALS && res == compare_t::equals) ||
+                           (op == compare_op_t::NOT_EQUALS && res != compare_t::equals) ||
+                           (op == compare_op_t::LESS && res == compare_t::less) ||
+                           (op == compare_op_t::LESS_EQUALS && res != compare_t::more) ||
+                           (op == compare_op_t::MORE && res == compare_t::more) ||
+                           (op == compare_op_t::MORE_EQUALS && res != compare_t::less);
+        REQUIRE(selection.test(i) == is_selected);
+      }
+    }
+  }
+}
+
+TEST_CASE("aggregate") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  std::mt19937_64 random(42);
+  __int128_t integer_sum = 0;
+  double float_sum = 0;
+  double min = std::numeric_limits<double>::infinity();
+  double max = -min;
+  std::size_t count = 0;
+  for (int i = 0; i < 5000; ++i) {
+    auto document = document_t::document_from_json(R"({"a": 0})", allocator);
+    switch (random() % 8) {
+      case 0:
+        document->set("/value", uint8_t(random() % 200));
+        break;
+      case 1:
+        document->set("/value", int32_t(random() % 100000));
+        break;
+      case 2:
+        document->set("/value", static_cast<int64_t>(random()));
+        break;
+      case 3:
+        document->set("/value", uint64_t(random()) | (uint64_t(1) << 63));
+        break;
+      case 4:
+        document->set("/value", float(random() % 1000) / 8);
+        break;
+      case 5:
+        document->set("/value", double(int64_t(random() % 2000) - 1000) / 3);
+        break;
+      case 6:
+        document->set("/value", std::string_view("1"));
+        break;
+      default:
+        break;
+    }
+    documents.push_back(document);
+    if (document->is_long("/value") || document->is_int("/value")) {
+      integer_sum += document->get_long("/value");
+    } else if (document->is_ulong("/value") || document->is_utinyint("/value")) {
+      integer_sum += document->get_ulong("/value");
+    } else if (document->is_float("/value") || document->is_double("/value")) {
+      float_sum += document->get_double("/value");
+    } else {
+      continue;
+    }
+    auto value = document->is_ulong("/value") ? double(document->get_ulong("/value")) : document->get_double("/value");
+    min = std::min(min, value);
+    max = std::max(max, value);
+    ++count;
+  }
+
+  auto res = aggregate(documents, "/value");
+  REQUIRE(res.count == count);
+  REQUIRE(res.integer_sum == integer_sum);
+  REQUIRE(std::abs(res.float_sum - float_sum) < 1e-6);
+  REQUIRE(res.min == min);
+  REQUIRE(res.max == max);
+  REQUIRE(res.avg() == res.sum() / double(count));
+
+  auto empty = aggregate(documents, "/a/b");
+  REQUIRE(empty.count == 0);
+  REQUIRE(std::isnan(empty.min));
+  REQUIRE(std::isnan(empty.avg()));
+  REQUIRE(aggregate(documents, "/a").integer_sum == 0);
+}
+
+TEST_CASE("split_json_pointer") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<path_segment_t> segments(allocator);
+  REQUIRE(split_json_pointer("", segments));
+  REQUIRE(segments.empty());
+  REQUIRE(split_json_pointer("/a~1b/12/c~0", segments));
+  REQUIRE(segments.size() == 3);
+  REQUIRE(segments[0].key == "a/b");
+  REQUIRE(segments[0].index == 0);
+  REQUIRE(segments[1].key == "12");
+  REQUIRE(segments[1].index == 12);
+  REQUIRE(segments[2].key == "c~");
+  segments.clear();
+  REQUIRE_FALSE(split_json_pointer("a", segments));
+  REQUIRE_FALSE(split_json_pointer("/a~2", segments));
+}
@@ -0,0 +1,95 @@
+#include <catch2/catch_test_macros.hpp>
+#include <components/document/document_group.hpp>
+#include <cmath>
+#include <map>
+#include <random>
+
+using namespace components::document;
+
+TEST_CASE("group_documents") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  for (auto json : {
+          R"({"id": 0, "a": 2, "b": {"c": "x"}, "v": 10})",
+          R"({"id": 1, "a": 2.0, "b": {"c": "x"}, "v": 1.5})",
+          R"({"id": 2, "b": {"c": "x"}, "v": "text"})",
+          R"({"id": 3, "a": 1, "b": {"c": "y"}, "v": -4})",
+          R"({"id": 4, "a": 2, "b": {"c": "x"}})",
+          R"({"id": 5, "b": {"c": "x"}, "v": 3})",
+          R"({"id": 6, "a": null, "b": {"c": "x"}, "v": 3})"
+  }) {
+    documents.push_back(document_t::document_from_json(json, allocator));
+  }
+
+  std::pmr::vector<std::string_view> group_by({"/a", "/b/c"}, allocator);
+  std::pmr::vector<std::string_view> aggregated({"/v", "/id", "/b"}, allocator);
+  auto groups = group_documents(documents, group_by, aggregated);
+  REQUIRE(groups.size() == 4);
+  REQUIRE(groups[0].first == 0);
+  REQUIRE(groups[0].size == 3);
+  REQUIRE(groups[0].key == documents[0]->sort_key("/a") + documents[0]->sort_key("/b/c"));
+  REQUIRE(groups[0].aggregates.size() == 3);
+  REQUIRE(groups[0].aggregates[0].count == 2);
+  REQUIRE(groups[0].aggregates[0].sum() == 11.5);
+  REQUIRE(groups[0].aggregates[0].min == 1.5);
+  REQUIRE(groups[0].aggregates[0].max == 10);
+  REQUIRE(groups[0].aggregates[1].integer_sum == 5);
+  REQUIRE(groups[0].aggregates[2].count == 0);
+  REQUIRE(std::isnan(groups[0].aggregates[2].avg()));
+  // a missing value is a group value of its own
+  REQUIRE(groups[1].first == 2);
+  REQUIRE(groups[1].size == 2);
+  REQUIRE(groups[1].aggregates[0].count == 1);
+  REQUIRE(groups[1].aggregates[0].integer_sum == 3);
+  REQUIRE(groups[2].first == 3);
+  REQUIRE(groups[2].aggregates[0].integer_sum == -4);
+  REQUIRE(groups[3].first == 6);
+
+  group_by = std::pmr::vector<std::string_view>({"a"}, allocator);
+  groups = group_documents(documents, group_by, aggregated);
+  REQUIRE(groups.size() == 1);
+  REQUIRE(groups[0].size == documents.size());
+  REQUIRE(groups[0].aggregates[1].integer_sum == 21);
+
+  groups = group_documents(std::pmr::vector<document_ptr>(allocator), group_by, aggregated);
+  REQUIRE(groups.empty());
+}
+
+TEST_CASE("group_documents parallel") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  std::mt19937 random(42);
+  struct expected_t {
+    std::size_t first;
+    std::size_t size = 0;
+    int64_t sum = 0;
+  };
+  std::map<std::pair<int64_t, std::string>, expected_t> expected;
+  for (std::size_t i = 0; i < 20000; ++i) {
+    auto document = document_t::document_from_json(R"({"nested": {}})", allocator);
+    auto count = int64_t(random() % 300);
+    auto name = std::string(1, char('a' + random() % 4));
+    document->set("/count", count);
+    document->set("/nested/name", name);
+    document->set("/nested/value", int64_t(random() % 1000));
+    documents.push_back(document);
+    auto &group = expected.try_emplace({count, name}, expected_t{i}).first->second;
+    ++group.size;
+    group.sum += document->get_long("/nested/value");
+  }
+
+  std::pmr::vector<std::string_view> group_by({"/count", "/nested/name"}, allocator);
+  std::pmr::vector<std::string_view> aggregated({"/nested/value"}, allocator);
+  auto groups = group_documents(documents, group_by, aggregated, 4);
+  REQUIRE(groups.size() == expected.size());
+  std::size_t previous = 0;
+  for (const auto &group : groups) {
+    const auto &document = documents[group.first];
+    const auto &res = expected.at({document->get_long("/count"), std::string(document->get_string("/nested/name"))});
+    REQUIRE(res.first == group.first);
+    REQUIRE(res.size == group.size);
+    REQUIRE(group.aggregates[0].integer_sum == res.sum);
+    REQUIRE(group.first >= previous);
+    previous = group.first;
+  }
+}
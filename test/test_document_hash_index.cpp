@@ -0,0 +1,229 @@
+#include <catch2/catch_test_macros.hpp>
+#include <components/document/document_index.hpp>
+#include <algorithm>
+#include <random>
+
+using namespace components::document;
+
+namespace {
+
+using row_id_t = document_hash_index_t::id_t;
+
+// ids in no particular order, sorted for the comparison
+std::pmr::vector<row_id_t> find(const document_hash_index_t &index, const boost::json::value &value) {
+  std::pmr::vector<row_id_t> ids;
+  index.find(value, ids);
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+} // namespace
+
+TEST_CASE("document_hash_index_t equal by value") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  for (int i = 0; i < 6; ++i) {
+    documents.push_back(document_t::document_from_json("{}", allocator));
+  }
+  documents[0]->set("/key", int64_t(7));
+  documents[1]->set("/key", uint8_t(7));
+  documents[2]->set("/key", 7.0);
+  documents[3]->set("/key", std::string_view("7"));
+  documents[4]->set_null("/key");
+
+  document_hash_index_t index(allocator, "/key");
+  index.build(documents);
+  REQUIRE(index.size() == documents.size());
+  REQUIRE(find(index, 7) == std::pmr::vector<row_id_t>({0, 1, 2}));
+  REQUIRE(find(index, 7.0) == std::pmr::vector<row_id_t>({0, 1, 2}));
+  REQUIRE(find(index, "7") == std::pmr::vector<row_id_t>({3}));
+  REQUIRE(find(index, nullptr) == std::pmr::vector<row_id_t>({4}));
+  REQUIRE(find(index, 7.5).empty());
+}
+
+TEST_CASE("document_hash_index_t collisions") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  // 40 copies of one key share a slot, 1000 distinct keys share the 128 control
+  // bytes many times over
+  for (int64_t i = 0; i < 1040; ++i) {
+    auto document = document_t::document_from_json("{}", allocator);
+    document->set("/key", i < 40 ? int64_t(-1) : i);
+    documents.push_back(document);
+  }
+  document_hash_index_t index(allocator, "/key");
+  index.build(documents);
+
+  std::pmr::vector<row_id_t> expected;
+  for (row_id_t id = 0; id < 40; ++id) {
+    expected.push_back(id);
+  }
+  REQUIRE(find(index, -1) == expected);
+  for (int64_t key = 40; key < 1040; ++key) {
+    REQUIRE(find(index, key) == std::pmr::vector<row_id_t>({row_id_t(key)}));
+  }
+  REQUIRE(find(index, 1040).empty());
+}
+
+TEST_CASE("document_hash_index_t tombstones") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  for (int64_t i = 0; i < 200; ++i) {
+    auto document = document_t::document_from_json("{}", allocator);
+    document->set("/key", i < 20 ? int64_t(-1) : i % 10);
+    documents.push_back(document);
+  }
+  document_hash_index_t index(allocator, "/key");
+  index.build(documents);
+
+  // the other ids of a value stay
+  for (row_id_t id = 0; id < 10; ++id) {
+    index.remove(id, *documents[id]);
+  }
+  std::pmr::vector<row_id_t> expected;
+  for (row_id_t id = 10; id < 20; ++id) {
+    expected.push_back(id);
+  }
+  REQUIRE(find(index, -1) == expected);
+  REQUIRE(index.size() == 190);
+
+  // removing an id twice or one never inserted changes nothing
+  index.remove(0, *documents[0]);
+  index.remove(500, *documents[0]);
+  REQUIRE(index.size() == 190);
+
+  // values without ids leave deleted slots, lookups go on past them and inserts
+  // reuse them
+  for (row_id_t id = 0; id < 10; ++id) {
+    index.insert(id, *documents[id]);
+  }
+  for (row_id_t id = 20; id < 200; id += 2) {
+    index.remove(id, *documents[id]);
+  }
+  REQUIRE(index.size() == 110);
+  REQUIRE(find(index, -1).size() == 20);
+  for (int64_t key = 0; key < 10; ++key) {
+    expected.clear();
+    for (auto id = row_id_t(20 + key); id < 200; id += 10) {
+      if (id % 2 == 1) {
+        expected.push_back(id);
+      }
+    }
+    REQUIRE(find(index, key) == expected);
+  }
+}
+
+TEST_CASE("document_hash_index_t few values") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  // most documents lack the field, all of them share the key of a missing value
+  for (int64_t i = 0; i < 100000; ++i) {
+    auto document = document_t::document_from_json("{}", allocator);
+    if (i % 50 == 0) {
+      document->set("/key", i % 200 == 0);
+    }
+    documents.push_back(document);
+  }
+  document_hash_index_t index(allocator, "/key");
+  index.build(documents);
+  REQUIRE(index.size() == documents.size());
+  REQUIRE(find(index, true).size() == 500);
+  REQUIRE(find(index, false).size() == 1500);
+
+  for (row_id_t id = 100000; id < 200000; ++id) {
+    index.insert(id, *documents[id - 100000]);
+  }
+  REQUIRE(index.size() == 200000);
+  REQUIRE(find(index, true).size() == 1000);
+  REQUIRE(find(index, false).size() == 3000);
+  for (row_id_t id : {row_id_t(0), row_id_t(1), row_id_t(50), row_id_t(100001), row_id_t(150)}) {
+    index.remove(id, *documents[id % 100000]);
+  }
+  REQUIRE(index.size() == 200000 - 5);
+  REQUIRE(find(index, true).size() == 999);
+  REQUIRE(find(index, false).size() == 2998);
+  REQUIRE(find(index, 1).empty());
+}
+
+TEST_CASE("document_hash_index_t grows") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  for (int64_t i = 0; i < 5000; ++i) {
+    auto document = document_t::document_from_json("{}", allocator);
+    document->set("/key", i % 1700);
+    documents.push_back(document);
+  }
+  document_hash_index_t index(allocator, "/key");
+  // every insert may move groups between two tables
+  for (row_id_t id = 0; id < documents.size(); ++id) {
+    index.insert(id, *documents[id]);
+    if (id % 97 == 0) {
+      auto key = int64_t(id % 1700);
+      std::pmr::vector<row_id_t> expected;
+      for (auto i = row_id_t(key); i <= id; i += 1700) {
+        expected.push_back(i);
+      }
+      REQUIRE(find(index, key) == expected);
+    }
+  }
+  REQUIRE(index.size() == documents.size());
+  for (row_id_t id = 0; id < documents.size(); id += 2) {
+    index.remove(id, *documents[id]);
+  }
+  REQUIRE(index.size() == documents.size() / 2);
+  for (int64_t key = 0; key < 1700; ++key) {
+    std::pmr::vector<row_id_t> expected;
+    for (auto id = row_id_t(key); id < documents.size(); id += 1700) {
+      if (id % 2 == 1) {
+        expected.push_back(id);
+      }
+    }
+    REQUIRE(find(index, key) == expected);
+  }
+}
+
+TEST_CASE("document_collection_t hash index") {
+  auto allocator = std::pmr::new_delete_resource();
+  document_collection_t collection(allocator);
+  std::mt19937 random(7);
+  auto make = [&](int64_t count) {
+    auto document = document_t::document_from_json("{}", allocator);
+    document->set("/count", count);
+    document->set("/_id", std::to_string(count));
+    return document;
+  };
+  for (row_id_t id = 0; id < 1000; ++id) {
+    collection.set(id, make(int64_t(random() % 300)));
+  }
+  const auto *count_index = collection.create_hash_index("/count");
+  REQUIRE(count_index != nullptr);
+  REQUIRE(collection.create_hash_index("/count") == nullptr);
+  REQUIRE(collection.hash_index("/count") == count_index);
+  REQUIRE(collection.hash_index("/_id") == nullptr);
+  REQUIRE(collection.index("/count") == nullptr);
+  const auto *id_index = collection.create_hash_index("/_id");
+
+  for (int i = 0; i < 20000; ++i) {
+    auto id = row_id_t(random() % 6000);
+    if (random() % 4 == 0) {
+      collection.remove(id);
+    } else {
+      collection.set(id, make(int64_t(random() % 300)));
+    }
+  }
+  REQUIRE(count_index->size() == collection.size());
+  REQUIRE(id_index->size() == collection.size());
+
+  for (int64_t value = 0; value < 310; ++value) {
+    std::pmr::vector<row_id_t> expected;
+    for (row_id_t id = 0; id < 6000; ++id) {
+      auto document = collection.get(id);
+      if (document != nullptr && document->get_long("/count") == value) {
+        expected.push_back(id);
+      }
+    }
+    REQUIRE(find(*count_index, value) == expected);
+    auto key = std::to_string(value);
+    REQUIRE(find(*id_index, boost::json::value(std::string_view(key))) == expected);
+  }
+}
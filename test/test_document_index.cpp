@@ -0,0 +1,139 @@
+#include <catch2/catch_test_macros.hpp>
+#include <components/document/document_index.hpp>
+#include <algorithm>
+#include <random>
+
+using namespace components::document;
+
+namespace {
+
+using row_id_t = document_index_t::id_t;
+
+std::pmr::vector<row_id_t> find(const document_index_t &index, const boost::json::value &value) {
+  std::pmr::vector<row_id_t> ids;
+  index.find(value, ids);
+  return ids;
+}
+
+std::pmr::vector<row_id_t> find_range(
+        const document_index_t &index,
+        const boost::json::value *lower,
+        bool is_lower_inclusive,
+        const boost::json::value *upper,
+        bool is_upper_inclusive
+) {
+  std::pmr::vector<row_id_t> ids;
+  index.find_range(lower, is_lower_inclusive, upper, is_upper_inclusive, ids);
+  return ids;
+}
+
+} // namespace
+
+TEST_CASE("document_index_t") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  for (auto json : {
+          R"({"count": 5})",
+          R"({"count": "5"})",
+          R"({"count": 2.5})",
+          R"({"other": 1})",
+          R"({"count": 5.0})",
+          R"({"count": 10})",
+          R"({"count": null})",
+          R"({"count": "abc"})"
+  }) {
+    documents.push_back(document_t::document_from_json(json, allocator));
+  }
+  documents[5]->set("/count", uint8_t(10));
+
+  document_index_t index(allocator, "/count");
+  index.build(documents);
+  REQUIRE(index.size() == documents.size());
+  REQUIRE(find(index, 5) == std::pmr::vector<row_id_t>({0, 4}));
+  REQUIRE(find(index, "5") == std::pmr::vector<row_id_t>({1}));
+  REQUIRE(find(index, nullptr) == std::pmr::vector<row_id_t>({6}));
+  REQUIRE(find(index, 7).empty());
+
+  boost::json::value lower = 2.5;
+  boost::json::value upper = 10;
+  REQUIRE(find_range(index, &lower, true, &upper, true) == std::pmr::vector<row_id_t>({2, 0, 4, 5}));
+  REQUIRE(find_range(index, &lower, false, &upper, false) == std::pmr::vector<row_id_t>({0, 4}));
+  // numbers sort before strings, a missing value after every value
+  REQUIRE(find_range(index, &upper, false, nullptr, false) == std::pmr::vector<row_id_t>({1, 7, 3}));
+  REQUIRE(find_range(index, nullptr, false, &lower, false) == std::pmr::vector<row_id_t>({6}));
+  REQUIRE(find_range(index, &upper, true, &lower, true).empty());
+
+  index.remove(0, *documents[0]);
+  index.insert(8, *documents[0]);
+  index.insert(9, *documents[5]);
+  REQUIRE(index.size() == documents.size() + 1);
+  REQUIRE(find(index, 5) == std::pmr::vector<row_id_t>({4, 8}));
+  REQUIRE(find_range(index, &lower, false, nullptr, false).front() == 4);
+  REQUIRE(find(index, 10) == std::pmr::vector<row_id_t>({5, 9}));
+}
+
+TEST_CASE("document_collection_t") {
+  auto allocator = std::pmr::new_delete_resource();
+  document_collection_t collection(allocator);
+  std::mt19937 random(42);
+  auto make = [&](int64_t count) {
+    auto document = document_t::document_from_json(R"({"tags": {}})", allocator);
+    document->set("/count", count);
+    document->set("/_id", std::string(24 - std::to_string(count).size(), '0') + std::to_string(count));
+    return document;
+  };
+  for (row_id_t id = 0; id < 3000; ++id) {
+    collection.set(id, make(int64_t(random() % 500)));
+  }
+  const auto *count_index = collection.create_index("/count");
+  REQUIRE(count_index != nullptr);
+  REQUIRE(collection.create_index("/count") == nullptr);
+  const auto *id_index = collection.create_index("/_id");
+  REQUIRE(collection.index("/_id") == id_index);
+  REQUIRE(collection.index("/missing") == nullptr);
+
+  for (int i = 0; i < 20000; ++i) {
+    auto id = row_id_t(random() % 4000);
+    if (random() % 3 == 0) {
+      collection.remove(id);
+    } else {
+      collection.set(id, make(int64_t(random() % 500)));
+    }
+  }
+  REQUIRE(count_index->size() == collection.size());
+  REQUIRE(id_index->size() == collection.size());
+
+  for (int i = 0; i < 200; ++i) {
+    auto value1 = int64_t(random() % 520);
+    auto value2 = int64_t(random() % 520);
+    auto min = std::min(value1, value2);
+    auto max = std::max(value1, value2);
+    boost::json::value lower = min;
+    boost::json::value upper = max;
+    std::vector<std::pair<int64_t, row_id_t>> expected;
+    std::pmr::vector<row_id_t> equal;
+    for (row_id_t id = 0; id < 4000; ++id) {
+      auto document = collection.get(id);
+      if (document == nullptr) {
+        continue;
+      }
+      auto count = document->get_long("/count");
+      if (count >= min && count < max) {
+        expected.emplace_back(count, id);
+      }
+      if (count == value1) {
+        equal.push_back(id);
+      }
+    }
+    std::sort(expected.begin(), expected.end());
+    auto ids = find_range(*count_index, &lower, true, &upper, false);
+    REQUIRE(ids.size() == expected.size());
+    for (std::size_t j = 0; j < ids.size(); ++j) {
+      REQUIRE(ids[j] == expected[j].second);
+    }
+    REQUIRE(find(*count_index, value1) == equal);
+    auto key = std::to_string(value1);
+    key.insert(0, 24 - key.size(), '0');
+    REQUIRE(find(*id_index, boost::json::value(std::string_view(key))) == equal);
+  }
+}
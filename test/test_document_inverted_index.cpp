@@ -0,0 +1,106 @@
+#include <catch2/catch_test_macros.hpp>
+#include <components/document/document_inverted_index.hpp>
+#include <algorithm>
+#include <iterator>
+#include <random>
+
+using namespace components::document;
+
+namespace {
+
+using row_id_t = document_inverted_index_t::id_t;
+
+std::pmr::vector<row_id_t> find_all(const document_inverted_index_t &index, std::string_view text) {
+  std::pmr::vector<row_id_t> ids;
+  index.find_all(text, ids);
+  return ids;
+}
+
+std::pmr::vector<row_id_t> find_any(const document_inverted_index_t &index, std::string_view text) {
+  std::pmr::vector<row_id_t> ids;
+  index.find_any(text, ids);
+  return ids;
+}
+
+} // namespace
+
+TEST_CASE("document_inverted_index_t") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  for (auto json : {
+          R"({"title": "The quick brown fox", "tags": ["animal", "Fast"]})",
+          R"({"title": "A lazy dog", "tags": ["animal"], "body": "quick"})",
+          R"({"title": "quick-quick, QUICK!", "tags": {"color": "brown"}})",
+          R"({"title": 5, "tags": [1, null, "héllo wörld"]})",
+          R"({"other": "quick"})"
+  }) {
+    documents.push_back(document_t::document_from_json(json, allocator));
+  }
+
+  document_inverted_index_t index(allocator, {"/title", "/tags"});
+  index.build(documents);
+  REQUIRE(index.count("quick") == 2);
+  REQUIRE(index.count("animal") == 2);
+  REQUIRE(index.count("fast") == 1);
+  REQUIRE(index.count("Fast") == 0);
+  REQUIRE(index.count("body") == 0);
+  REQUIRE(index.count("héllo") == 1);
+
+  REQUIRE(find_all(index, "Quick") == std::pmr::vector<row_id_t>({0, 2}));
+  REQUIRE(find_all(index, "quick brown") == std::pmr::vector<row_id_t>({0, 2}));
+  REQUIRE(find_all(index, "quick animal") == std::pmr::vector<row_id_t>({0}));
+  REQUIRE(find_all(index, "quick cat").empty());
+  REQUIRE(find_all(index, " ,").empty());
+  REQUIRE(find_any(index, "dog fox cat") == std::pmr::vector<row_id_t>({0, 1}));
+  REQUIRE(find_any(index, "wörld, brown") == std::pmr::vector<row_id_t>({0, 2, 3}));
+  REQUIRE(find_any(index, "cat").empty());
+}
+
+TEST_CASE("document_inverted_index_t long postings") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<std::pair<row_id_t, document_ptr>> documents(allocator);
+  std::mt19937 random(3);
+  // ids out of order and with gaps, words spread so that lists span many blocks
+  for (row_id_t i = 0; i < 20000; ++i) {
+    auto id = (i * 7919) % 20000 * 3;
+    std::string text;
+    for (int word = 2; word <= 7; ++word) {
+      if (id % word == 0) {
+        text += "w" + std::to_string(word) + " ";
+      }
+    }
+    text += random() % 100 == 0 ? "rare" : "common";
+    auto document = document_t::document_from_json("{}", allocator);
+    document->set("/text", std::string_view(text));
+    documents.emplace_back(id, document);
+  }
+  document_inverted_index_t index(allocator, {"/text"});
+  index.build(documents);
+  REQUIRE(index.count("w2") == 10000);
+  REQUIRE(index.postings_bytes() < 3 * 20000 * sizeof(row_id_t));
+
+  auto expected = [&](auto predicate) {
+    std::pmr::vector<row_id_t> ids;
+    for (row_id_t id = 0; id < 60000; id += 3) {
+      if (predicate(id)) {
+        ids.push_back(id);
+      }
+    }
+    return ids;
+  };
+  REQUIRE(find_all(index, "w2 w3") == expected([](row_id_t id) { return id % 6 == 0; }));
+  REQUIRE(find_all(index, "w7 w5 w2") == expected([](row_id_t id) { return id % 70 == 0; }));
+  REQUIRE(find_any(index, "w5 w7") == expected([](row_id_t id) { return id % 5 == 0 || id % 7 == 0; }));
+
+  std::pmr::vector<row_id_t> rare;
+  for (const auto &[id, document] : documents) {
+    if (document->get_string("/text").find("rare") != std::pmr::string::npos) {
+      rare.push_back(id);
+    }
+  }
+  std::sort(rare.begin(), rare.end());
+  std::pmr::vector<row_id_t> rare_even;
+  std::copy_if(rare.begin(), rare.end(), std::back_inserter(rare_even), [](row_id_t id) { return id % 2 == 0; });
+  REQUIRE(find_all(index, "rare w2") == rare_even);
+  REQUIRE(find_all(index, "w2 rare w2") == rare_even);
+}
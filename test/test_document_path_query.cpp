@@ -0,0 +1,97 @@
+#include <catch2/catch_test_macros.hpp>
+#include <components/document/document_path_query.hpp>
+#include <algorithm>
+
+using namespace components::document;
+
+namespace {
+
+using pointers_t = std::pmr::vector<std::pmr::string>;
+
+pointers_t match(const document_ptr &document, std::string_view query) {
+  path_query_t path_query(std::pmr::new_delete_resource());
+  REQUIRE(path_query.parse(query) == error_code_t::SUCCESS);
+  pointers_t json_pointers;
+  path_query.for_each(*document, [&](const path_match_t &match) {
+    json_pointers.emplace_back(match.json_pointer());
+  });
+  // fields come in the order of the object
+  std::sort(json_pointers.begin(), json_pointers.end());
+  return json_pointers;
+}
+
+} // namespace
+
+TEST_CASE("path_query_t") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = document_t::document_from_json(R"({
+    "store": {
+      "books": [
+        {"title": "a", "price": 8},
+        {"title": "b", "price": 12},
+        {"title": "c", "price": 9, "tags": {"price": 1}}
+      ],
+      "a/b": {"c~d": true}
+    },
+    "price": 5
+  })", allocator);
+
+  REQUIRE(match(doc, "") == pointers_t({""}));
+  REQUIRE(match(doc, "/price") == pointers_t({"/price"}));
+  REQUIRE(match(doc, "/store/books/1/title") == pointers_t({"/store/books/1/title"}));
+  REQUIRE(match(doc, "/store/books/*/title") == pointers_t({
+          "/store/books/0/title",
+          "/store/books/1/title",
+          "/store/books/2/title"
+  }));
+  REQUIRE(match(doc, "/store/a~1b/*") == pointers_t({"/store/a~1b/c~0d"}));
+  REQUIRE(match(doc, "/store/books/[1:]/price") == pointers_t({"/store/books/1/price", "/store/books/2/price"}));
+  REQUIRE(match(doc, "/store/books/[-1:]/title") == pointers_t({"/store/books/2/title"}));
+  REQUIRE(match(doc, "/store/books/[::2]/title") == pointers_t({"/store/books/0/title", "/store/books/2/title"}));
+  REQUIRE(match(doc, "/store/books/[5:]").empty());
+  REQUIRE(match(doc, "/store/books/[1::9223372036854775807]/title") == pointers_t({"/store/books/1/title"}));
+  REQUIRE(match(doc, "/store/books/[-9223372036854775807::9223372036854775807]/title") == pointers_t({"/store/books/0/title"}));
+  REQUIRE(match(doc, "/store/[0:1]").empty());
+  REQUIRE(match(doc, "/**/price") == pointers_t({
+          "/price",
+          "/store/books/0/price",
+          "/store/books/1/price",
+          "/store/books/2/price",
+          "/store/books/2/tags/price"
+  }));
+  REQUIRE(match(doc, "/**/**/price").size() == 5);
+  REQUIRE(match(doc, "/store/books/**").size() == 12);
+  REQUIRE(match(doc, "/missing/*").empty());
+  REQUIRE(match(doc, "/store/books/x").empty());
+
+  path_query_t path_query(allocator);
+  REQUIRE(path_query.parse("price") == error_code_t::INVALID_JSON_POINTER);
+  REQUIRE(path_query.count(*doc) == 0);
+  REQUIRE(path_query.parse("/store/books/[1:2:0]") == error_code_t::INVALID_JSON_POINTER);
+  REQUIRE(path_query.parse("/store/books/[x:]") == error_code_t::INVALID_JSON_POINTER);
+  REQUIRE(path_query.parse("/store/books/[1]") == error_code_t::INVALID_JSON_POINTER);
+
+  REQUIRE(path_query.parse("/store/books/*") == error_code_t::SUCCESS);
+  REQUIRE(path_query.count(*doc) == 3);
+  int64_t sum = 0;
+  REQUIRE(path_query.parse("/**/price") == error_code_t::SUCCESS);
+  path_query.for_each(*doc, [&](const path_match_t &match) {
+    REQUIRE(match.key() == "price");
+    REQUIRE(match.is_as<int64_t>());
+    sum += match.get_as<int64_t>();
+  });
+  REQUIRE(sum == 8 + 12 + 9 + 1 + 5);
+
+  REQUIRE(path_query.parse("/store/books/*") == error_code_t::SUCCESS);
+  pointers_t keys;
+  path_query.for_each(*doc, [&](const path_match_t &match) {
+    REQUIRE(match.is_dict());
+    keys.emplace_back(match.key());
+  });
+  REQUIRE(keys == pointers_t({"0", "1", "2"}));
+
+  REQUIRE(path_query.parse("/store/*") == error_code_t::SUCCESS);
+  path_query.for_each(*doc, [&](const path_match_t &match) {
+    REQUIRE((match.key() == "books" ? match.is_array() && match.count() == 3 : match.key() == "a/b"));
+  });
+}
@@ -0,0 +1,124 @@
+#include <catch2/catch_test_macros.hpp>
+#include <components/document/document_predicate.hpp>
+#include <random>
+
+using namespace components::document;
+
+TEST_CASE("predicate_t") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto document = document_t::document_from_json(
+          R"({"count": 600, "small": 7, "ratio": 0.5, "name": "bob", "flag": true, "none": null,)"
+          R"( "list": [1, "two", 3.5], "dict": {"a/b": 1, "m~n": 2}})",
+          allocator
+  );
+  document->set("/big", uint64_t(18000000000000000000ULL));
+
+  auto match = [&](auto build) {
+    predicate_t predicate(allocator);
+    predicate.compile(build(predicate));
+    return predicate.match(*document);
+  };
+
+  SECTION("compare") {
+    REQUIRE(match([](predicate_t &p) { return p.compare("/count", compare_op_t::MORE, 500); }));
+    REQUIRE_FALSE(match([](predicate_t &p) { return p.compare("/count", compare_op_t::LESS, 500); }));
+    REQUIRE(match([](predicate_t &p) { return p.compare("/count", compare_op_t::EQUALS, 600.0); }));
+    REQUIRE(match([](predicate_t &p) { return p.compare("/small", compare_op_t::LESS_EQUALS, 7); }));
+    REQUIRE(match([](predicate_t &p) { return p.compare("/ratio", compare_op_t::LESS, 1); }));
+    REQUIRE(match([](predicate_t &p) { return p.compare("/big", compare_op_t::MORE, int64_t(1) << 62); }));
+    REQUIRE(match([](predicate_t &p) { return p.compare("/name", compare_op_t::MORE_EQUALS, "bob"); }));
+    REQUIRE(match([](predicate_t &p) { return p.compare("/name", compare_op_t::NOT_EQUALS, "alice"); }));
+    REQUIRE(match([](predicate_t &p) { return p.compare("/flag", compare_op_t::EQUALS, true); }));
+    REQUIRE(match([](predicate_t &p) { return p.compare("/none", compare_op_t::EQUALS, nullptr); }));
+    REQUIRE(match([](predicate_t &p) { return p.compare("/list/1", compare_op_t::EQUALS, "two"); }));
+    REQUIRE(match([](predicate_t &p) { return p.compare("/dict/a~1b", compare_op_t::EQUALS, 1); }));
+    REQUIRE(match([](predicate_t &p) { return p.compare("/dict/m~0n", compare_op_t::EQUALS, 2); }));
+    // another kind or a missing value fails every op
+    REQUIRE_FALSE(match([](predicate_t &p) { return p.compare("/name", compare_op_t::NOT_EQUALS, 1); }));
+    REQUIRE_FALSE(match([](predicate_t &p) { return p.compare("/missing", compare_op_t::NOT_EQUALS, 1); }));
+    REQUIRE_FALSE(match([](predicate_t &p) { return p.compare("/dict", compare_op_t::NOT_EQUALS, 1); }));
+    REQUIRE_FALSE(match([](predicate_t &p) { return p.compare("count", compare_op_t::EQUALS, 600); }));
+  }
+
+  SECTION("in, exists and types") {
+    REQUIRE(match([](predicate_t &p) { return p.in("/count", boost::json::array{1, 600, "x"}); }));
+    REQUIRE(match([](predicate_t &p) { return p.in("/count", boost::json::array{600.0}); }));
+    REQUIRE(match([](predicate_t &p) { return p.in("/ratio", boost::json::array{0.5, 2}); }));
+    REQUIRE(match([](predicate_t &p) { return p.in("/name", boost::json::array{"alice", "bob"}); }));
+    REQUIRE(match([](predicate_t &p) { return p.in("/none", boost::json::array{nullptr}); }));
+    REQUIRE_FALSE(match([](predicate_t &p) { return p.in("/flag", boost::json::array{false, "true"}); }));
+    REQUIRE_FALSE(match([](predicate_t &p) { return p.in("/name", boost::json::array{}); }));
+
+    REQUIRE(match([](predicate_t &p) { return p.exists("/none"); }));
+    REQUIRE(match([](predicate_t &p) { return p.exists(""); }));
+    REQUIRE_FALSE(match([](predicate_t &p) { return p.exists("/list/3"); }));
+    REQUIRE(match([](predicate_t &p) { return p.is_type("/list", value_type_t::ARRAY); }));
+    REQUIRE(match([](predicate_t &p) { return p.is_type("/dict", value_type_t::DICT); }));
+    REQUIRE(match([](predicate_t &p) { return p.is_type("/big", value_type_t::NUMBER); }));
+    REQUIRE(match([](predicate_t &p) { return p.is_type("/list/2", value_type_t::NUMBER); }));
+    REQUIRE(match([](predicate_t &p) { return p.is_type("/none", value_type_t::NULL_VALUE); }));
+    REQUIRE_FALSE(match([](predicate_t &p) { return p.is_type("/name", value_type_t::BOOL); }));
+  }
+
+  SECTION("connectives") {
+    REQUIRE(match([](predicate_t &p) {
+      return p.logical_and({p.exists("/count"), p.compare("/count", compare_op_t::MORE, 500), p.is_type("/name", value_type_t::STRING)});
+    }));
+    REQUIRE_FALSE(match([](predicate_t &p) {
+      return p.logical_and({p.compare("/count", compare_op_t::MORE, 500), p.logical_not(p.exists("/name"))});
+    }));
+    REQUIRE(match([](predicate_t &p) {
+      return p.logical_or({p.compare("/count", compare_op_t::LESS, 500), p.logical_and({p.exists("/flag"), p.logical_or({p.exists("/x"), p.exists("/ratio")})})});
+    }));
+    REQUIRE_FALSE(match([](predicate_t &p) {
+      return p.logical_not(p.logical_or({p.exists("/x"), p.logical_not(p.exists("/y"))}));
+    }));
+    REQUIRE(match([](predicate_t &p) { return p.logical_and({}); }));
+    REQUIRE_FALSE(match([](predicate_t &p) { return p.logical_or({}); }));
+  }
+}
+
+TEST_CASE("predicate_t::filter") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  std::mt19937 random(42);
+  for (int i = 0; i < 1000; ++i) {
+    auto document = document_t::document_from_json(R"({"nested": {}})", allocator);
+    if (random() % 4 != 0) {
+      document->set("/count", int64_t(random() % 1000));
+    }
+    if (random() % 2 != 0) {
+      document->set("/nested/name", std::string(1, char('a' + random() % 5)));
+    } else {
+      document->set("/nested/name", int32_t(random() % 5));
+    }
+    document->set("/flag", random() % 2 != 0);
+    documents.push_back(document);
+  }
+
+  predicate_t predicate(allocator);
+  auto count = predicate.compare("/count", compare_op_t::MORE, 500);
+  auto name = predicate.in("/nested/name", boost::json::array{"a", "c", 3});
+  auto flag = predicate.compare("/flag", compare_op_t::EQUALS, true);
+  predicate.compile(predicate.logical_or({
+          predicate.logical_and({count, predicate.logical_not(flag)}),
+          predicate.logical_and({name, predicate.logical_not(predicate.exists("/count"))})
+  }));
+
+  selection_t selection(allocator);
+  predicate.filter(documents, selection);
+  std::size_t expected = 0;
+  for (std::size_t i = 0; i < documents.size(); ++i) {
+    const auto &document = documents[i];
+    auto is_count = document->is_exists("/count") && document->get_long("/count") > 500;
+    auto is_name = document->is_string("/nested/name")
+                   ? document->get_string("/nested/name") == "a" || document->get_string("/nested/name") == "c"
+                   : document->get_int("/nested/name") == 3;
+    auto is_selected = (is_count && !document->get_bool("/flag")) || (is_name && !document->is_exists("/count"));
+    REQUIRE(selection.test(i) == is_selected);
+    REQUIRE(predicate.match(*document) == is_selected);
+    expected += is_selected;
+  }
+  REQUIRE(selection.count() == expected);
+  REQUIRE(expected > 0);
+}
@@ -0,0 +1,106 @@
+#include <catch2/catch_test_macros.hpp>
+#include <components/document/document_shredder.hpp>
+#include <random>
+
+using namespace components::document;
+
+namespace {
+
+const shredded_column_t &find_column(const shredded_batch_t &batch, std::initializer_list<std::string_view> keys) {
+  for (const auto &column : batch.columns) {
+    if (column.path.size() != keys.size()) {
+      continue;
+    }
+    auto it = keys.begin();
+    std::size_t step = 0;
+    for (; step < column.path.size() && column.path[step].key == *it; ++step, ++it) {}
+    if (step == column.path.size() && column.path.back().kind == shred_kind_t::VALUE) {
+      return column;
+    }
+  }
+  FAIL("no column");
+  return batch.columns.front();
+}
+
+} // namespace
+
+TEST_CASE("shred_documents") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  for (auto json : {
+          R"({"name": "a", "links": [{"url": "x", "tags": [1, 2]}, {"url": "y", "tags": []}]})",
+          R"({"name": "b", "links": []})",
+          R"({"links": [{"tags": [3]}, 5, [6, {"deep": null}]]})"
+  }) {
+    documents.push_back(document_t::document_from_json(json, allocator));
+  }
+  documents.back()->set("/name", int64_t(7));
+
+  shredded_batch_t batch(allocator);
+  shred_documents(documents, batch);
+  REQUIRE(batch.size == 3);
+
+  const auto &names = find_column(batch, {"name"});
+  REQUIRE(names.repetition_levels == std::pmr::vector<uint16_t>({0, 0, 0}));
+  REQUIRE(names.definition_levels == std::pmr::vector<uint16_t>({1, 1, 1}));
+  REQUIRE(names.valid.count() == 3);
+  REQUIRE(names.get_string(0) == "a");
+  REQUIRE(names.get_string(1) == "b");
+  // one column holds the primitives of every type at a path
+  REQUIRE(names.types[2] == simdjson::dom::element_type::INT64);
+  REQUIRE(names.get_double(2) == 7);
+
+  // links -> element -> object -> tags -> element -> value
+  const auto &tags = find_column(batch, {"links", "", "", "tags", "", ""});
+  REQUIRE(tags.max_repetition_level == 2);
+  REQUIRE(tags.repetition_levels == std::pmr::vector<uint16_t>({0, 2, 1, 0, 0, 1, 1}));
+  REQUIRE(tags.definition_levels == std::pmr::vector<uint16_t>({6, 6, 4, 1, 6, 2, 2}));
+  REQUIRE(tags.types.size() == 3);
+  REQUIRE(tags.get_double(0) == 1);
+  REQUIRE(tags.get_double(1) == 2);
+  REQUIRE(tags.get_double(2) == 3);
+
+  auto assembled = assemble_documents(batch, allocator);
+  REQUIRE(assembled.size() == documents.size());
+  for (std::size_t i = 0; i < documents.size(); ++i) {
+    REQUIRE(document_t::is_equals_documents(assembled[i], documents[i]));
+  }
+}
+
+TEST_CASE("shred_documents round trip") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  for (auto json : {
+          R"({})",
+          R"({"a": {}, "b": [], "c": [[], [[]], {}], "d": null})",
+          R"({"a": {"x": 1.5, "y": [true, false]}, "b": [null, "s"], "c": 3})",
+          R"({"a": [1, {"x": "q"}], "b": {"a/b": {"m~n": -1}}, "d": [{"e": [{}, {"f": 2}]}]})",
+          R"({"a": "text", "d": [{"e": []}, {"e": [{"f": 3}]}, {}]})"
+  }) {
+    documents.push_back(document_t::document_from_json(json, allocator));
+  }
+  documents[2]->set("/wide", __int128_t(1) << 100);
+  documents[2]->set("/small", uint8_t(200));
+  documents[3]->set("/wide", float(0.25));
+  documents[3]->set("/small", std::string_view("\0x", 2));
+
+  shredded_batch_t batch(allocator);
+  shred_documents(documents, batch);
+  for (const auto &column : batch.columns) {
+    REQUIRE(column.repetition_levels.size() == column.definition_levels.size());
+    REQUIRE(column.valid.size() == column.definition_levels.size());
+    REQUIRE(column.repetition_levels.front() == 0);
+  }
+  auto assembled = assemble_documents(batch, allocator);
+  REQUIRE(assembled.size() == documents.size());
+  for (std::size_t i = 0; i < documents.size(); ++i) {
+    REQUIRE(document_t::is_equals_documents(assembled[i], documents[i]));
+  }
+  REQUIRE(assembled[2]->get_ulong("/small") == 200);
+  REQUIRE(assembled[3]->get_string("/small") == std::string_view("\0x", 2));
+
+  shredded_batch_t empty(allocator);
+  shred_documents(std::pmr::vector<document_ptr>(allocator), empty);
+  REQUIRE(empty.size == 0);
+  REQUIRE(assemble_documents(empty, allocator).empty());
+}
@@ -0,0 +1,70 @@
+#include <catch2/catch_test_macros.hpp>
+#include <components/document/document_sorter.hpp>
+#include <random>
+
+using namespace components::document;
+
+TEST_CASE("sort_documents") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  for (auto json : {
+          R"({"id": 0, "a": 2, "b": "x"})",
+          R"({"id": 1, "a": 1.5, "b": "y"})",
+          R"({"id": 2, "b": "z"})",
+          R"({"id": 3, "a": 2, "b": "y"})",
+          R"({"id": 4, "a": null, "b": "y"})",
+          R"({"id": 5, "a": 1, "b": "x"})",
+          R"({"id": 6, "a": 2, "b": "y"})"
+  }) {
+    documents.push_back(document_t::document_from_json(json, allocator));
+  }
+  auto ids = [&]() {
+    std::vector<int64_t> res;
+    for (auto &document : documents) {
+      res.push_back(document->get_long("/id"));
+    }
+    return res;
+  };
+
+  std::pmr::vector<sort_column_t> columns({{"/a"}, {"/b", sort_order_t::DESCENDING}}, allocator);
+  sort_documents(documents, columns);
+  REQUIRE(ids() == std::vector<int64_t>{5, 1, 3, 6, 0, 2, 4});
+
+  columns = std::pmr::vector<sort_column_t>({{"/a", sort_order_t::DESCENDING, nulls_order_t::FIRST}}, allocator);
+  sort_documents(documents, columns);
+  REQUIRE(ids() == std::vector<int64_t>{2, 4, 3, 6, 0, 1, 5});
+}
+
+TEST_CASE("sort_documents parallel") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_ptr> documents(allocator);
+  std::mt19937_64 random(42);
+  for (int i = 0; i < 20000; ++i) {
+    auto document = document_t::document_from_json(R"({"a": 0})", allocator);
+    document->set("/id", int64_t(i));
+    document->set("/a", int64_t(random() % 1000) - 500);
+    if (i % 3 == 0) {
+      document->set("/b", double(random() % 100) / 4);
+    }
+    documents.push_back(document);
+  }
+  std::pmr::vector<sort_column_t> columns({{"/b", sort_order_t::ASCENDING, nulls_order_t::FIRST}, {"/a", sort_order_t::DESCENDING}}, allocator);
+  auto expected = documents;
+  std::stable_sort(expected.begin(), expected.end(), [](const document_ptr &doc1, const document_ptr &doc2) {
+    auto exists1 = doc1->is_exists("/b");
+    auto exists2 = doc2->is_exists("/b");
+    if (exists1 != exists2) {
+      return !exists1;
+    }
+    if (exists1 && doc1->get_double("/b") != doc2->get_double("/b")) {
+      return doc1->get_double("/b") < doc2->get_double("/b");
+    }
+    return doc1->get_long("/a") > doc2->get_long("/a");
+  });
+
+  auto sequential = documents;
+  sort_documents(sequential, columns);
+  REQUIRE(sequential == expected);
+  sort_documents(documents, columns, 4);
+  REQUIRE(documents == expected);
+}
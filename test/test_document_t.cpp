@@ -1,10 +1,12 @@
 #include <catch2/catch_test_macros.hpp>
 #include "../components/generaty/generaty.hpp"
 #include "../src/components/document/varint.hpp"
+#include "../src/components/document/document_column.hpp"
 
 using components::document::document_t;
 using components::document::compare_t;
 using components::document::error_code_t;
+using components::document::column_reader_t;
 
 TEST_CASE("document_t::is/get value") {
   auto allocator = std::pmr::new_delete_resource();
@@ -388,6 +390,371 @@ TEST_CASE("document_t::merge") {
   REQUIRE(res->get_string("/phoneNumber") == "+01-123-456-7890");
 }
 
+class counting_resource final : public std::pmr::memory_resource {
+public:
+  size_t allocations = 0;
+
+private:
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    ++allocations;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+TEST_CASE("document_t::merge lazy") {
+  auto target = R"(
+{
+  "title": "Goodbye!",
+  "author" : {
+    "givenName" : "John",
+    "familyName" : "Doe",
+    "address": {"city": "Paris"}
+  },
+  "tags":[ "example", "sample" ],
+  "content": "This will be unchanged",
+  "scalar": 1
+}
+  )";
+
+  auto patch = R"(
+{
+  "title": "Hello!",
+  "author": {"address": {"zip": 75001}},
+  "tags": [ "example" ],
+  "scalar": {"a": 1, "b": 2}
+}
+  )";
+  counting_resource allocator;
+  auto target_doc = document_t::document_from_json(target, &allocator);
+  auto patch_doc = document_t::document_from_json(patch, &allocator);
+  patch_doc->set_deleter("/author/familyName");
+  patch_doc->set_deleter("/scalar/b");
+
+  auto res = document_t::merge(target_doc, patch_doc, &allocator, components::document::merge_mode_t::LAZY);
+  auto eager = document_t::merge(target_doc, patch_doc, &allocator);
+
+  allocator.allocations = 0;
+  REQUIRE(res->is_string("/title"));
+  REQUIRE(res->is_string("/content"));
+  REQUIRE(res->is_string("/author/givenName"));
+  REQUIRE_FALSE(res->is_exists("/author/familyName"));
+  REQUIRE(res->is_exists("/author/address/city"));
+  REQUIRE(res->get_long("/author/address/zip") == 75001);
+  REQUIRE(res->is_exists("/tags/0"));
+  REQUIRE_FALSE(res->is_exists("/tags/1"));
+  REQUIRE(res->get_long("/scalar/a") == 1);
+  REQUIRE_FALSE(res->is_exists("/scalar/b"));
+  REQUIRE(allocator.allocations == 0);
+
+  REQUIRE(res->count("/author") == 2);
+  REQUIRE(allocator.allocations > 0);
+  REQUIRE(res->get_string("/title") == "Hello!");
+  REQUIRE(document_t::is_equals_documents(res, eager));
+}
+
+TEST_CASE("document_t::merge chain") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::vector<document_t::ptr> chain(allocator);
+  chain.push_back(document_t::document_from_json(R"({"a": 1, "b": {"c": 1, "d": 1}, "e": [1], "f": 1})", allocator));
+  chain.push_back(document_t::document_from_json(R"({"a": 2, "b": {"c": 2}, "f": {"g": 1}})", allocator));
+  chain.push_back(document_t::document_from_json(R"({"b": {"h": 3}, "f": {"i": 3}, "j": {"k": 3}})", allocator));
+  chain.push_back(document_t::document_from_json(R"({"b": {}, "e": {"l": 4}, "f": {}, "j": {"m": 4}})", allocator));
+  chain.back()->set_deleter("/b/c");
+  chain.back()->set_deleter("/f/g");
+  chain.back()->set_deleter("/a");
+
+  auto folded = chain.front();
+  for (size_t i = 1; i < chain.size(); ++i) {
+    folded = document_t::merge(folded, chain[i], allocator);
+  }
+  auto res = document_t::merge(chain, allocator);
+
+  REQUIRE(document_t::is_equals_documents(res, folded));
+  REQUIRE_FALSE(res->is_exists("/a"));
+  REQUIRE_FALSE(res->is_exists("/b/c"));
+  REQUIRE(res->get_long("/b/d") == 1);
+  REQUIRE(res->get_long("/b/h") == 3);
+  REQUIRE(res->is_dict("/e"));
+  REQUIRE(res->get_long("/e/l") == 4);
+  REQUIRE_FALSE(res->is_exists("/f/g"));
+  REQUIRE(res->get_long("/f/i") == 3);
+  REQUIRE(res->count("/j") == 2);
+
+  std::pmr::vector<document_t::ptr> single({chain.front()}, allocator);
+  REQUIRE(document_t::is_equals_documents(document_t::merge(single, allocator), chain.front()));
+}
+
+TEST_CASE("document_t::diff") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto base = document_t::document_from_json(
+          R"({"a": 1, "b": {"c": 1, "d": {"e": 1}}, "f": [1, 2], "g": "1", "h": {"i": 1}})",
+          allocator
+  );
+  auto target = base->snapshot();
+  target->set("/a", int64_t(2));
+  target->set("/b/c", int64_t(1));
+  target->remove("/g");
+  target->set("/j", std::string("3"));
+  target->set("/f/1", int64_t(3));
+
+  auto patch = document_t::diff(base, target, allocator);
+  REQUIRE(patch->count() == 4);
+  REQUIRE(patch->get_long("/a") == 2);
+  REQUIRE_FALSE(patch->is_exists("/b"));
+  REQUIRE_FALSE(patch->is_exists("/h"));
+  REQUIRE(patch->is_array("/f"));
+  REQUIRE(patch->get_string("/j") == "3");
+  REQUIRE(document_t::is_equals_documents(document_t::merge(base, patch, allocator), target));
+
+  auto other = document_t::document_from_json(R"({"a": {"k": 1}, "b": 2, "h": {"i": 1}})", allocator);
+  patch = document_t::diff(base, other, allocator);
+  REQUIRE_FALSE(patch->is_exists("/h"));
+  REQUIRE(document_t::is_equals_documents(document_t::merge(base, patch, allocator), other));
+  patch = document_t::diff(other, base, allocator);
+  REQUIRE(document_t::is_equals_documents(document_t::merge(other, patch, allocator), base));
+
+  REQUIRE(document_t::diff(base, base, allocator)->count() == 0);
+}
+
+TEST_CASE("document_t::project") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = document_t::document_from_json(
+          R"({"a": 1, "b": {"c": "x", "d": {"e": 2}, "f": 3}, "g": [{"h": 1}, 2], "i~j": true, "k": "y"})",
+          allocator
+  );
+  doc->set("/b/l", std::string("z"));
+
+  auto projection = document_t::project(
+          doc,
+          {"/a", "/b/d/e", "/b/l", "/g/0/h", "/i~0j", "/missing", "/a/x", "/b/d"},
+          allocator
+  );
+  REQUIRE(projection->count() == 4);
+  REQUIRE(projection->get_long("/a") == 1);
+  REQUIRE(projection->count("/b") == 2);
+  REQUIRE(projection->get_long("/b/d/e") == 2);
+  REQUIRE(projection->get_string("/b/l") == "z");
+  REQUIRE(projection->count("/g") == 2);
+  REQUIRE(projection->get_bool("/i~0j"));
+  REQUIRE_FALSE(projection->is_exists("/b/c"));
+  REQUIRE_FALSE(projection->is_exists("/k"));
+  // nothing is copied to the tape of the projection
+  REQUIRE(projection->compaction_stats().tape_bytes == 0);
+
+  // writes to either side do not show through the shared subtrees
+  doc->set("/b/d/e", int64_t(5));
+  projection->set("/b/l", std::string("w"));
+  REQUIRE(projection->get_long("/b/d/e") == 2);
+  REQUIRE(doc->get_string("/b/l") == "z");
+  REQUIRE(doc->get_long("/b/d/e") == 5);
+
+  auto whole = document_t::project(doc, {"/a", ""}, allocator);
+  REQUIRE(document_t::is_equals_documents(whole, doc));
+  REQUIRE(document_t::project(doc, {}, allocator)->count() == 0);
+}
+
+TEST_CASE("document_t::apply_patch") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = document_t::document_from_json(
+          R"({"a": {"b": 1, "c": [1, 2, 3]}, "d": "x", "e": {"f": {"g": true}}})",
+          allocator
+  );
+  auto snapshot = doc->snapshot();
+
+  REQUIRE(doc->apply_patch(R"([
+    {"op": "test", "path": "/d", "value": "x"},
+    {"op": "replace", "path": "/a/b", "value": 2},
+    {"op": "add", "path": "/a/c/1", "value": 10},
+    {"op": "add", "path": "/a/c/-", "value": {"h": [1]}},
+    {"op": "remove", "path": "/a/c/0"},
+    {"op": "copy", "from": "/e/f", "path": "/a/f"},
+    {"op": "add", "path": "/a/f/i", "value": null},
+    {"op": "move", "from": "/d", "path": "/e/d"},
+    {"op": "add", "path": "/a~1b", "value": 1}
+  ])") == error_code_t::SUCCESS);
+  REQUIRE(doc->get_long("/a/b") == 2);
+  REQUIRE(doc->count("/a/c") == 4);
+  REQUIRE(doc->get_long("/a/c/0") == 10);
+  REQUIRE(doc->get_long("/a/c/1") == 2);
+  REQUIRE(doc->get_long("/a/c/3/h/0") == 1);
+  REQUIRE(doc->is_null("/a/f/i"));
+  REQUIRE_FALSE(doc->is_exists("/e/f/i"));
+  REQUIRE(doc->get_string("/e/d") == "x");
+  REQUIRE_FALSE(doc->is_exists("/d"));
+  REQUIRE(doc->get_long("/a~1b") == 1);
+  REQUIRE(doc->get_long("/a/c/0") == 10);
+  REQUIRE(snapshot->get_long("/a/b") == 1);
+
+  auto before = doc->snapshot();
+  REQUIRE(doc->apply_patch(R"([
+    {"op": "replace", "path": "/a/b", "value": 3},
+    {"op": "remove", "path": "/e"},
+    {"op": "test", "path": "/a/b", "value": 2}
+  ])") == error_code_t::TEST_FAILED);
+  REQUIRE(document_t::is_equals_documents(doc, before));
+  REQUIRE(doc->get_long("/a/b") == 2);
+  REQUIRE(doc->is_exists("/e/d"));
+
+  REQUIRE(doc->apply_patch(R"([{"op": "remove", "path": "/a/x"}])") == error_code_t::NO_SUCH_ELEMENT);
+  REQUIRE(doc->apply_patch(R"([{"op": "replace", "path": "/a/c/9", "value": 1}])") == error_code_t::NO_SUCH_ELEMENT);
+  REQUIRE(doc->apply_patch(R"([{"op": "add", "path": "/x/y", "value": 1}])") == error_code_t::NO_SUCH_CONTAINER);
+  REQUIRE(doc->apply_patch(R"([{"op": "move", "from": "/a", "path": "/a/b/c"}])") == error_code_t::INVALID_PATCH);
+  REQUIRE(doc->apply_patch(R"([{"op": "jump", "path": "/a"}])") == error_code_t::INVALID_PATCH);
+  REQUIRE(doc->apply_patch(R"({"op": "add"})") == error_code_t::INVALID_PATCH);
+  REQUIRE(doc->apply_patch(R"([{"op": )") == error_code_t::INVALID_JSON);
+  REQUIRE(document_t::is_equals_documents(doc, before));
+
+  REQUIRE(doc->apply_patch(R"([{"op": "copy", "from": "", "path": "/self"}])") == error_code_t::SUCCESS);
+  REQUIRE(doc->get_long("/self/a/b") == 2);
+  REQUIRE_FALSE(doc->is_exists("/self/self"));
+
+  // numbers compare by value, indexes have no leading zeros
+  REQUIRE(doc->apply_patch(R"([{"op": "test", "path": "/a/b", "value": 2.0}])") == error_code_t::SUCCESS);
+  REQUIRE(doc->apply_patch(R"([{"op": "test", "path": "/a/c/0", "value": 10.5}])") == error_code_t::TEST_FAILED);
+  REQUIRE(doc->apply_patch(R"([{"op": "test", "path": "/a/c", "value": [10.0, 2, 3, {"h": [1]}]}])") == error_code_t::SUCCESS);
+  REQUIRE(doc->apply_patch(R"([{"op": "remove", "path": "/a/c/01"}])") == error_code_t::INVALID_INDEX);
+  REQUIRE(doc->count("/a/c") == 4);
+}
+
+TEST_CASE("document_t::apply_patch view") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = document_t::document_from_json(R"({"a": {"b": 1, "c": {"d": [1, 2]}}, "e": 2})", allocator);
+  auto before = doc->snapshot();
+  auto view = doc->get_dict("/a");
+  auto nested = view->get_dict("/c");
+
+  REQUIRE(view->apply_patch(R"([
+    {"op": "replace", "path": "/b", "value": 3},
+    {"op": "add", "path": "/c/x", "value": 1},
+    {"op": "remove", "path": "/c/d/0"},
+    {"op": "test", "path": "/b", "value": 1}
+  ])") == error_code_t::TEST_FAILED);
+  REQUIRE(document_t::is_equals_documents(doc, before));
+  REQUIRE(view->get_long("/b") == 1);
+  REQUIRE_FALSE(nested->is_exists("/x"));
+  REQUIRE(nested->count("/d") == 2);
+
+  REQUIRE(nested->apply_patch(R"([
+    {"op": "add", "path": "/x", "value": 1},
+    {"op": "remove", "path": "/y"}
+  ])") == error_code_t::NO_SUCH_ELEMENT);
+  REQUIRE(document_t::is_equals_documents(doc, before));
+  REQUIRE_FALSE(nested->is_exists("/x"));
+
+  REQUIRE(view->apply_patch(R"([{"op": "replace", "path": "/b", "value": 3}])") == error_code_t::SUCCESS);
+  REQUIRE(doc->get_long("/a/b") == 3);
+  REQUIRE(before->get_long("/a/b") == 1);
+}
+
+TEST_CASE("document_t::apply_patch merged") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc1 = document_t::document_from_json(R"({"a": 1, "b": {"c": 2}})", allocator);
+  auto doc2 = document_t::document_from_json(R"({"d": 3})", allocator);
+  auto merged = document_t::merge(doc1, doc2, allocator);
+
+  REQUIRE(merged->apply_patch(R"([{"op": "add", "path": "/b/e", "value": "x"}])") == error_code_t::SUCCESS);
+  REQUIRE(merged->get_string("/b/e") == "x");
+  REQUIRE(merged->get_long("/d") == 3);
+  REQUIRE_FALSE(doc1->is_exists("/b/e"));
+}
+
+TEST_CASE("document_t::apply_merge_patch") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = document_t::document_from_json(
+          R"({"a": "b", "c": {"d": "e", "f": "g"}, "h": [1, 2], "i": 1, "j": {"k": 1}})",
+          allocator
+  );
+  auto snapshot = doc->snapshot();
+
+  REQUIRE(doc->apply_merge_patch(
+          R"({"a": "z", "c": {"f": null, "x": {"y": null, "w": 1}}, "h": [null, {"n": null}], "i": {"m": null}, "j": null, "l": "\u0041"})"
+  ) == error_code_t::SUCCESS);
+  auto expected = document_t::document_from_json(
+          R"({"a": "z", "c": {"d": "e", "x": {"w": 1}}, "h": [null, {"n": null}], "i": {}, "l": "A"})",
+          allocator
+  );
+  REQUIRE(document_t::is_equals_documents(doc, expected));
+  REQUIRE(snapshot->get_string("/c/f") == "g");
+
+  REQUIRE(doc->apply_merge_patch(R"({"a": 1, "c": {"d": [1, )") == error_code_t::INVALID_JSON);
+  REQUIRE(doc->apply_merge_patch(R"([1])") == error_code_t::INVALID_PATCH);
+  REQUIRE(doc->apply_merge_patch(R"(null)") == error_code_t::INVALID_PATCH);
+  REQUIRE(document_t::is_equals_documents(doc, expected));
+
+  REQUIRE(doc->apply_merge_patch(R"({})") == error_code_t::SUCCESS);
+  REQUIRE(document_t::is_equals_documents(doc, expected));
+}
+
+TEST_CASE("document_t::apply_merge_patch merged") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc1 = document_t::document_from_json(R"({"a": 1, "b": {"c": 2}})", allocator);
+  auto doc2 = document_t::document_from_json(R"({"d": 3})", allocator);
+  auto merged = document_t::merge(doc1, doc2, allocator);
+
+  REQUIRE(merged->apply_merge_patch(R"({"b": {"c": null, "e": "x"}})") == error_code_t::SUCCESS);
+  REQUIRE(merged->get_string("/b/e") == "x");
+  REQUIRE_FALSE(merged->is_exists("/b/c"));
+  REQUIRE(doc1->get_long("/b/c") == 2);
+}
+
+TEST_CASE("document_t::apply_merge_patch view") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = document_t::document_from_json(R"({"a": {"b": 1, "c": {"d": 2}}})", allocator);
+  auto before = doc->snapshot();
+  auto view = doc->get_dict("/a");
+
+  REQUIRE(view->apply_merge_patch(R"({"b": null, "c": {"d": [1, )") == error_code_t::INVALID_JSON);
+  REQUIRE(document_t::is_equals_documents(doc, before));
+  REQUIRE(view->get_long("/b") == 1);
+
+  REQUIRE(view->apply_merge_patch(R"({"b": null})") == error_code_t::SUCCESS);
+  REQUIRE_FALSE(doc->is_exists("/a/b"));
+  REQUIRE(before->get_long("/a/b") == 1);
+}
+
+TEST_CASE("document_t::sort_key") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = document_t::document_from_json(
+          R"({"null": null, "false": false, "true": true, "str": "ab", "prefix": "a", "arr": [1, "a"], "obj": {}})",
+          allocator
+  );
+  doc->set("/int8", int8_t(4));
+  doc->set("/int16", int16_t(5));
+  doc->set("/int32", int32_t(5));
+  doc->set("/int64", int64_t(5));
+  doc->set("/uint64", uint64_t(1) << 63);
+  doc->set("/big", (uint64_t(1) << 53) + 1);
+  doc->set("/double", 5.5);
+  doc->set("/float", -5.25f);
+  doc->set("/zero", -0.0);
+  doc->set("/hugeint", -(__int128_t(1) << 100));
+  doc->set("/double_five", 5.0);
+  doc->set("/double_big", double(uint64_t(1) << 53));
+  doc->set("/zeros", std::string_view("a\0b", 3));
+
+  auto key = [&](std::string_view json_pointer) { return doc->sort_key(json_pointer); };
+  REQUIRE(key("/int16") == key("/int64"));
+  REQUIRE(key("/int32") == key("/int64"));
+  REQUIRE(key("/int64") == key("/double_five"));
+
+  std::vector<std::string_view> ordered = {
+          "/null", "/false", "/true", "/hugeint", "/float", "/zero", "/int8", "/int64", "/double", "/double_big",
+          "/big", "/uint64", "/prefix", "/zeros", "/str", "/arr", "/obj", "/missing"
+  };
+  for (size_t i = 1; i < ordered.size(); ++i) {
+    INFO(ordered[i - 1] << " < " << ordered[i]);
+    REQUIRE(key(ordered[i - 1]) < key(ordered[i]));
+  }
+}
+
 TEST_CASE("document_t::is_equals_documents") {
   auto json = R"(
 {
@@ -417,6 +784,82 @@ TEST_CASE("document_t::is_equals_documents") {
   REQUIRE(document_t::is_equals_documents(doc1, doc2));
 }
 
+TEST_CASE("document_t::is_equals_documents after writes") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto json = R"({"a": 1, "b": {"c": "1", "d": [1, 2]}, "e": true})";
+  auto doc1 = document_t::document_from_json(json, allocator);
+  auto doc2 = document_t::document_from_json(json, allocator);
+  REQUIRE(document_t::is_equals_documents(doc1, doc2));
+
+  doc2->set("/a", int64_t(2));
+  REQUIRE_FALSE(document_t::is_equals_documents(doc1, doc2));
+  doc2->set("/a", int64_t(1));
+  REQUIRE(document_t::is_equals_documents(doc1, doc2));
+
+  auto dict = doc2->get_dict("/b");
+  dict->set("/d/1", int64_t(3));
+  REQUIRE_FALSE(document_t::is_equals_documents(doc1, doc2));
+  dict->set("/d/1", int64_t(2));
+  REQUIRE(document_t::is_equals_documents(doc1, doc2));
+
+  doc1->set("/f", 0.1);
+  doc2->set("/f", 0.1 + std::numeric_limits<double>::epsilon() / 4);
+  REQUIRE(document_t::is_equals_documents(doc1, doc2));
+
+  auto snapshot = doc2->snapshot();
+  REQUIRE(document_t::is_equals_documents(snapshot, doc2));
+  snapshot->set("/b/c", std::string("2"));
+  REQUIRE_FALSE(document_t::is_equals_documents(snapshot, doc2));
+  REQUIRE(document_t::is_equals_documents(doc1, doc2));
+}
+
+namespace {
+
+std::size_t leaf_hashes = 0;
+
+template<typename T>
+std::size_t count_leaf_hash(const T *, bool &) {
+  ++leaf_hashes;
+  return 0;
+}
+
+} // namespace
+
+TEST_CASE("document_t::hash") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc1 = document_t::document_from_json(R"({"a": 1, "b": {"c": "long string value", "d": [1, 2]}})", allocator);
+  auto doc2 = document_t::document_from_json(R"({"b": {"d": [1, 2], "c": "long string value"}, "a": 1})", allocator);
+  REQUIRE(doc1->hash() == doc2->hash());
+
+  auto doc3 = document_t::document_from_json(R"({"b": {"d": []}})", allocator);
+  doc3->set("/a", int64_t(1));
+  doc3->set("/b/c", std::string("long string value"));
+  doc3->set("/b/d/0", int64_t(1));
+  doc3->set("/b/d/1", int64_t(2));
+  REQUIRE(doc1->hash() == doc3->hash());
+  REQUIRE(doc1->get_dict("/b")->hash() == doc3->get_dict("/b")->hash());
+
+  doc3->set("/b/c", std::string("long string valuf"));
+  REQUIRE(doc1->hash() != doc3->hash());
+  doc3->set("/b/c", std::string("long string value"));
+  REQUIRE(doc1->hash() == doc3->hash());
+  doc3->set("/b/d/1", int64_t(1));
+  doc3->set("/b/d/0", int64_t(2));
+  REQUIRE(doc1->hash() != doc3->hash());
+
+  // a view keeps no hash from being cached, its writes reset them through the owner
+  auto view = doc1->get_dict("/b");
+  auto hash = doc1->hash();
+  leaf_hashes = 0;
+  REQUIRE(column_reader_t::root(*doc1)->hash(count_leaf_hash, count_leaf_hash) == hash);
+  REQUIRE(leaf_hashes == 0);
+  view->set("/c", std::string("long string valuf"));
+  REQUIRE(doc1->hash() != hash);
+  view->set("/c", std::string("long string value"));
+  REQUIRE(doc1->hash() == hash);
+  REQUIRE(view->hash() == doc2->get_dict("/b")->hash());
+}
+
 TEST_CASE("document_t::is_equals_documents fail when different types") {
   auto json = R"(
 {
@@ -707,6 +1150,307 @@ TEST_CASE("document_t::copy independent") {
   REQUIRE(document_t::is_equals_documents(doc, res_doc));
 }
 
+TEST_CASE("document_t::copy shares until written") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = gen_doc(1, allocator);
+
+  REQUIRE(doc->copy("/mixedDict", "/copiedDict") == error_code_t::SUCCESS);
+  REQUIRE(doc->copy("/nestedArray", "/copiedArray") == error_code_t::SUCCESS);
+
+  REQUIRE(doc->set("/copiedDict/1/odd", false) == error_code_t::SUCCESS);
+  REQUIRE(doc->set("/mixedDict/2/extra", true) == error_code_t::SUCCESS);
+  REQUIRE(doc->remove("/copiedArray/0/0") == error_code_t::SUCCESS);
+
+  REQUIRE(doc->get_bool("/mixedDict/1/odd"));
+  REQUIRE_FALSE(doc->get_bool("/copiedDict/1/odd"));
+  REQUIRE(doc->is_exists("/mixedDict/2/extra"));
+  REQUIRE_FALSE(doc->is_exists("/copiedDict/2/extra"));
+  REQUIRE(doc->count("/nestedArray/0") == 5);
+  REQUIRE(doc->count("/copiedArray/0") == 4);
+  REQUIRE(doc->count("/copiedArray/1") == 5);
+
+  REQUIRE(doc->copy("/countDict", "/countDict/self") == error_code_t::SUCCESS);
+  REQUIRE(doc->count("/countDict") == 5);
+  REQUIRE(doc->count("/countDict/self") == 4);
+}
+
+TEST_CASE("document_t::set doc independent") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = gen_doc(1, allocator);
+  auto nested_doc = gen_doc(2, allocator);
+
+  REQUIRE(doc->set("/nestedDoc", nested_doc) == error_code_t::SUCCESS);
+  REQUIRE(doc->set("/nestedDoc/countDict/odd", true) == error_code_t::SUCCESS);
+  REQUIRE(nested_doc->set("/count", 5) == error_code_t::SUCCESS);
+
+  REQUIRE(doc->get_bool("/nestedDoc/countDict/odd"));
+  REQUIRE_FALSE(nested_doc->get_bool("/countDict/odd"));
+  REQUIRE(doc->get_long("/nestedDoc/count") == 2);
+  REQUIRE(nested_doc->get_long("/count") == 5);
+}
+
+TEST_CASE("document_t::snapshot") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = gen_doc(1, allocator);
+  auto snapshot = doc->snapshot();
+
+  REQUIRE(doc->set("/count", 2) == error_code_t::SUCCESS);
+  REQUIRE(doc->remove("/countDict/odd") == error_code_t::SUCCESS);
+  REQUIRE(snapshot->set("/countArray/0", 10) == error_code_t::SUCCESS);
+
+  REQUIRE(snapshot->get_long("/count") == 1);
+  REQUIRE(snapshot->is_exists("/countDict/odd"));
+  REQUIRE(snapshot->get_long("/countArray/0") == 10);
+  REQUIRE(doc->get_long("/count") == 2);
+  REQUIRE_FALSE(doc->is_exists("/countDict/odd"));
+  REQUIRE(doc->get_long("/countArray/0") == 1);
+}
+
+TEST_CASE("document_t::snapshot after view") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = gen_doc(1, allocator);
+  auto dict = doc->get_dict("/countDict");
+  auto array = doc->get_array("/nestedArray/0");
+  auto snapshot = doc->snapshot();
+
+  REQUIRE(dict->set("/odd", false) == error_code_t::SUCCESS);
+  REQUIRE(dict->set("/extra", 1) == error_code_t::SUCCESS);
+  REQUIRE(array->remove("/0") == error_code_t::SUCCESS);
+
+  REQUIRE(snapshot->get_bool("/countDict/odd"));
+  REQUIRE_FALSE(snapshot->is_exists("/countDict/extra"));
+  REQUIRE(snapshot->count("/nestedArray/0") == 5);
+  REQUIRE_FALSE(doc->get_bool("/countDict/odd"));
+  REQUIRE(doc->get_long("/countDict/extra") == 1);
+  REQUIRE(doc->count("/nestedArray/0") == 4);
+  REQUIRE_FALSE(dict->get_bool("/odd"));
+  REQUIRE(array->count() == 4);
+}
+
+TEST_CASE("document_t::view follows parent") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = gen_doc(1, allocator);
+  auto dict = doc->get_dict("/countDict");
+  auto snapshot = doc->snapshot();
+
+  // the write copies /countDict off the snapshot, the view reads the copy
+  REQUIRE(doc->set("/countDict/odd", false) == error_code_t::SUCCESS);
+  REQUIRE_FALSE(dict->get_bool("/odd"));
+  REQUIRE(dict->set("/extra", 1) == error_code_t::SUCCESS);
+  REQUIRE(doc->get_long("/countDict/extra") == 1);
+  REQUIRE(snapshot->get_bool("/countDict/odd"));
+  REQUIRE_FALSE(snapshot->is_exists("/countDict/extra"));
+
+  auto copy = doc->get_dict("/mixedDict/1");
+  REQUIRE(doc->copy("/mixedDict", "/copiedDict") == error_code_t::SUCCESS);
+  REQUIRE(doc->set("/mixedDict/1/odd", false) == error_code_t::SUCCESS);
+  REQUIRE_FALSE(copy->get_bool("/odd"));
+  REQUIRE(copy->set("/extra", 1) == error_code_t::SUCCESS);
+  REQUIRE(doc->is_exists("/mixedDict/1/extra"));
+  REQUIRE(doc->get_bool("/copiedDict/1/odd"));
+  REQUIRE_FALSE(doc->is_exists("/copiedDict/1/extra"));
+}
+
+TEST_CASE("document_t::large objects") {
+  // enough keys for the HAMT object storage to move leaves into sub-tries, on
+  // several levels
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = make_document(allocator);
+  REQUIRE(doc->set_dict("/big") == error_code_t::SUCCESS);
+  auto view = doc->get_dict("/big");
+  for (int i = 0; i < 3000; ++i) {
+    REQUIRE(view->set("/" + std::to_string(i), i) == error_code_t::SUCCESS);
+  }
+  auto snapshot = doc->snapshot();
+  for (int i = 0; i < 3000; i += 2) {
+    REQUIRE(doc->remove("/big/" + std::to_string(i)) == error_code_t::SUCCESS);
+  }
+  REQUIRE(doc->remove("/big/0") == error_code_t::NO_SUCH_ELEMENT);
+  REQUIRE(doc->set("/big/1", std::string("one")) == error_code_t::SUCCESS);
+  REQUIRE(snapshot->set("/big/extra", true) == error_code_t::SUCCESS);
+
+  REQUIRE(doc->count("/big") == 1500);
+  REQUIRE(view->count() == 1500);
+  REQUIRE(snapshot->count("/big") == 3001);
+  for (int i = 0; i < 3000; ++i) {
+    auto key = "/big/" + std::to_string(i);
+    REQUIRE(doc->is_exists(key) == (i % 2 == 1));
+    REQUIRE(snapshot->get_long(key) == i);
+  }
+  REQUIRE(doc->get_string("/big/1") == "one");
+  REQUIRE(view->get_string("/1") == "one");
+  REQUIRE_FALSE(doc->is_exists("/big/extra"));
+  REQUIRE_FALSE(view->is_exists("/extra"));
+}
+
+TEST_CASE("document_t::compact") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = gen_doc(1, allocator);
+  doc->set_compaction_threshold(0);
+  std::string long_value(100, 'a');
+  for (int i = 0; i < 100; ++i) {
+    REQUIRE(doc->set("/countStr", std::string_view(long_value)) == error_code_t::SUCCESS);
+    REQUIRE(doc->set("/countArray/1", i) == error_code_t::SUCCESS);
+  }
+  REQUIRE(doc->copy("/countStr", "/copy") == error_code_t::SUCCESS);
+
+  auto before = doc->compaction_stats();
+  REQUIRE(before.dead_string_bytes > 0);
+  REQUIRE(before.dead_tape_bytes > 0);
+
+  auto snapshot = doc->snapshot();
+  REQUIRE_FALSE(doc->compact());
+  snapshot = nullptr;
+
+  REQUIRE(doc->compact());
+  auto after = doc->compaction_stats();
+  REQUIRE(after.dead_string_bytes == 0);
+  REQUIRE(after.dead_tape_bytes == 0);
+  REQUIRE(after.string_bytes == before.string_bytes - before.dead_string_bytes);
+  REQUIRE(doc->get_string("/countStr") == std::string_view(long_value));
+  REQUIRE(doc->get_string("/copy") == std::string_view(long_value));
+  REQUIRE(doc->get_long("/countArray/1") == 99);
+  REQUIRE(doc->get_long("/count") == 1);
+}
+
+TEST_CASE("document_t::compact automatically") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = gen_doc(1, allocator);
+  std::string long_value(100, 'a');
+  for (int i = 0; i < 10000; ++i) {
+    REQUIRE(doc->set("/countStr", std::string_view(long_value)) == error_code_t::SUCCESS);
+  }
+  auto stats = doc->compaction_stats();
+  REQUIRE(stats.string_bytes < 10000);
+  REQUIRE(doc->get_string("/countStr") == std::string_view(long_value));
+}
+
+TEST_CASE("document_t::consolidate") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc1 = document_t::document_from_json(R"({"a": 1, "b": {"c": "one", "d": [1, 2]}})", allocator);
+  auto doc2 = gen_doc(2, allocator);
+  doc2->set("/b", 2);
+  doc2->set_deleter("/null");
+  auto merged = document_t::merge(doc1, doc2, allocator);
+  doc1 = nullptr;
+  doc2 = nullptr;
+
+  REQUIRE(merged->consolidate());
+  REQUIRE(merged->get_long("/a") == 1);
+  REQUIRE(merged->get_long("/b") == 2);
+  REQUIRE(merged->get_long("/count") == 2);
+  REQUIRE(merged->get_string("/countStr") == "2");
+  REQUIRE(merged->get_long("/countArray/1") == 3);
+  REQUIRE(merged->get_long("/dictArray/4/number") == 6);
+  REQUIRE_FALSE(merged->is_exists("/null"));
+
+  auto nested = gen_doc(3, allocator);
+  auto doc = make_document(allocator);
+  doc->set("/nested", nested);
+  nested = nullptr;
+  REQUIRE(doc->consolidate());
+  REQUIRE(doc->set("/nested/count", 4) == error_code_t::SUCCESS);
+  REQUIRE(doc->get_long("/nested/count") == 4);
+  REQUIRE(doc->get_bool("/nested/countDict/odd"));
+  REQUIRE_FALSE(doc->get_array("/nested/countArray")->consolidate());
+}
+
+TEST_CASE("document_t::consolidate automatically") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto big = make_document(allocator);
+  for (int i = 0; i < 10000; ++i) {
+    big->set("/" + std::to_string(i), std::to_string(i));
+  }
+  big->set_dict("/small");
+  big->get_dict("/small")->set("/a", 1);
+
+  auto doc = make_document(allocator);
+  doc->set("/small", big->get_dict("/small"));
+  // the ancestors were dropped, only the test holds big
+  REQUIRE(big->use_count() == 1);
+  REQUIRE(doc->compaction_stats().tape_bytes > 0);
+  REQUIRE(doc->get_long("/small/a") == 1);
+
+  // a document using most of what it pins keeps its ancestors
+  auto whole = make_document(allocator);
+  whole->set("/big", big);
+  REQUIRE(big->use_count() == 2);
+  REQUIRE(whole->get_string("/big/9999") == "9999");
+}
+
+TEST_CASE("document_t::clone_into") {
+  auto allocator = std::pmr::new_delete_resource();
+  std::pmr::unsynchronized_pool_resource other_allocator;
+  auto doc = document_t::document_from_json(R"({"a": 1, "b": {"c": "one", "d": [1, 2.5, null]}})", allocator);
+  doc->set("/e", gen_doc(1, allocator));
+  doc->set("/a", 2);
+  REQUIRE(doc->copy("/b", "/f") == error_code_t::SUCCESS);
+
+  auto clone = doc->clone_into(&other_allocator);
+  REQUIRE(document_t::is_equals_documents(doc, clone));
+  auto stats = clone->compaction_stats();
+  REQUIRE(stats.dead_tape_bytes == 0);
+  REQUIRE(stats.dead_string_bytes == 0);
+
+  REQUIRE(clone->set("/b/c", std::string_view("two")) == error_code_t::SUCCESS);
+  REQUIRE(doc->get_string("/b/c") == "one");
+  REQUIRE(clone->get_string("/f/c") == "one");
+  doc = nullptr;
+  REQUIRE(clone->get_long("/a") == 2);
+  REQUIRE(clone->get_double("/b/d/1") == 2.5);
+  REQUIRE(clone->is_null("/b/d/2"));
+  REQUIRE(clone->get_long("/e/countArray/4") == 5);
+}
+
+TEST_CASE("document_t::build_path_filter") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = document_t::document_from_json(R"({"a": 1, "b": {"c": "one", "d": [1, {"e": 2}]}, "f~g": {"h/i": 3}})", allocator);
+  REQUIRE(doc->path_filter_bytes() == 0);
+  REQUIRE(doc->may_contain("/x"));
+
+  doc->build_path_filter();
+  REQUIRE(doc->path_filter_bytes() > 0);
+  for (auto json_pointer : {"/a", "/b", "/b/c", "/b/d", "/b/d/1/e", "/b/d/01", "/f~0g", "/f~0g/h~1i"}) {
+    REQUIRE(doc->may_contain(json_pointer));
+    REQUIRE(doc->is_exists(json_pointer));
+  }
+  REQUIRE(doc->get_long("/b/d/1/e") == 2);
+  REQUIRE(doc->get_long("/f~0g/h~1i") == 3);
+  REQUIRE(doc->may_contain("/b/d/7"));
+  REQUIRE_FALSE(doc->is_exists("/b/d/7"));
+  REQUIRE(doc->may_contain("a"));
+
+  std::size_t ruled_out = 0;
+  for (int i = 0; i < 1000; ++i) {
+    auto json_pointer = "/b/missing" + std::to_string(i);
+    ruled_out += !doc->may_contain(json_pointer);
+    REQUIRE_FALSE(doc->is_exists(json_pointer));
+    REQUIRE(doc->get_long(json_pointer) == 0);
+  }
+  REQUIRE(ruled_out > 900);
+  REQUIRE(doc->get_dict("/missing") == nullptr);
+  REQUIRE(doc->path_filter_bytes() > 0);
+
+  REQUIRE(doc->set("/b/missing1", 1) == error_code_t::SUCCESS);
+  REQUIRE(doc->path_filter_bytes() == 0);
+  REQUIRE(doc->get_long("/b/missing1") == 1);
+}
+
+TEST_CASE("document_t::build_path_filter with views") {
+  auto allocator = std::pmr::new_delete_resource();
+  auto doc = document_t::document_from_json(R"({"a": 1, "b": {"c": "one"}})", allocator);
+  auto dict = doc->get_dict("/b");
+  doc->build_path_filter();
+
+  // a view keeps the filter until it writes
+  REQUIRE(doc->get_dict("/b") != nullptr);
+  REQUIRE(doc->path_filter_bytes() > 0);
+  REQUIRE(dict->set("/new", 1) == error_code_t::SUCCESS);
+  REQUIRE(doc->path_filter_bytes() == 0);
+  REQUIRE(doc->is_exists("/b/new"));
+  REQUIRE(doc->get_long("/b/new") == 1);
+}
+
 TEST_CASE("document_t:: json pointer escape /") {
   auto allocator = std::pmr::new_delete_resource();
 
@@ -0,0 +1,59 @@
+#include <catch2/catch_test_macros.hpp>
+#include <memory_resource>
+#include <components/document/container/hamt_map.hpp>
+
+TEST_CASE("hamt_map::set/get/remove") {
+  auto allocator = std::pmr::new_delete_resource();
+  hamt_map<int> map(allocator);
+
+  for (int i = 0; i < 10000; ++i) {
+    map[std::to_string(i)] = i;
+  }
+  REQUIRE(map.size() == 10000);
+  for (int i = 0; i < 10000; ++i) {
+    auto it = map.find(std::to_string(i));
+    REQUIRE(it != map.end());
+    REQUIRE(it->second == i);
+  }
+  REQUIRE(map.find("other") == map.end());
+
+  size_t visited = 0;
+  for (auto &it : map) {
+    REQUIRE(std::to_string(it.second) == std::string_view(it.first));
+    ++visited;
+  }
+  REQUIRE(visited == 10000);
+
+  for (int i = 0; i < 10000; i += 2) {
+    REQUIRE(map.erase(std::to_string(i)) == 1);
+  }
+  REQUIRE(map.erase("0") == 0);
+  REQUIRE(map.size() == 5000);
+  for (int i = 0; i < 10000; ++i) {
+    REQUIRE((map.find(std::to_string(i)) != map.end()) == (i % 2 == 1));
+  }
+}
+
+TEST_CASE("hamt_map::copies are independent") {
+  auto allocator = std::pmr::new_delete_resource();
+  hamt_map<int> map(allocator);
+  for (int i = 0; i < 1000; ++i) {
+    map[std::to_string(i)] = i;
+  }
+
+  auto copy = map;
+  copy["0"] = -1;
+  copy.erase("1");
+  copy["new"] = 1;
+  map.find("2")->second = -2;
+
+  REQUIRE(map.size() == 1000);
+  REQUIRE(copy.size() == 1000);
+  REQUIRE(map.find("0")->second == 0);
+  REQUIRE(copy.find("0")->second == -1);
+  REQUIRE(map.find("1") != map.end());
+  REQUIRE(copy.find("1") == copy.end());
+  REQUIRE(map.find("new") == map.end());
+  REQUIRE(map.find("2")->second == -2);
+  REQUIRE(copy.find("2")->second == 2);
+}